@@ -323,12 +323,11 @@ static av_cold void exponent_init(AC3EncodeContext *s)
 
 
 /*
- * Extract exponents from the MDCT coefficients.
+ * Extract exponents from the MDCT coefficients of 1 channel.
  */
-static void extract_exponents(AC3EncodeContext *s)
+static void extract_exponents(AC3EncodeContext *s, int ch)
 {
-    int ch        = !s->cpl_on;
-    int chan_size = AC3_MAX_COEFS * s->num_blocks * (s->channels - ch + 1);
+    int chan_size = AC3_MAX_COEFS * s->num_blocks;
     AC3Block *block = &s->blocks[0];
 
     s->ac3dsp.extract_exponents(block->exp[ch], block->fixed_coef[ch], chan_size);
@@ -352,64 +351,57 @@ static const uint8_t exp_strategy_reuse_tab[4][6] = {
 };
 
 /*
- * Calculate exponent strategies for all channels.
+ * Calculate exponent strategies for 1 channel.
  * Array arrangement is reversed to simplify the per-channel calculation.
  */
-static void compute_exp_strategy(AC3EncodeContext *s)
+static void compute_exp_strategy(AC3EncodeContext *s, int ch)
 {
-    int ch, blk, blk1;
-
-    for (ch = !s->cpl_on; ch <= s->fbw_channels; ch++) {
-        uint8_t *exp_strategy = s->exp_strategy[ch];
-        uint8_t *exp          = s->blocks[0].exp[ch];
-        int exp_diff;
-
-        /* estimate if the exponent variation & decide if they should be
-           reused in the next frame */
-        exp_strategy[0] = EXP_NEW;
-        exp += AC3_MAX_COEFS;
-        for (blk = 1; blk < s->num_blocks; blk++, exp += AC3_MAX_COEFS) {
-            if (ch == CPL_CH) {
-                if (!s->blocks[blk-1].cpl_in_use) {
-                    exp_strategy[blk] = EXP_NEW;
-                    continue;
-                } else if (!s->blocks[blk].cpl_in_use) {
-                    exp_strategy[blk] = EXP_REUSE;
-                    continue;
-                }
-            } else if (s->blocks[blk].channel_in_cpl[ch] != s->blocks[blk-1].channel_in_cpl[ch]) {
+    uint8_t *exp_strategy = s->exp_strategy[ch];
+    uint8_t *exp          = s->blocks[0].exp[ch];
+    int blk, blk1, exp_diff;
+
+    if (s->lfe_on && ch == s->lfe_channel) {
+        exp_strategy[0] = EXP_D15;
+        for (blk = 1; blk < s->num_blocks; blk++)
+            exp_strategy[blk] = EXP_REUSE;
+        return;
+    }
+
+    /* estimate if the exponent variation & decide if they should be
+       reused in the next frame */
+    exp_strategy[0] = EXP_NEW;
+    exp += AC3_MAX_COEFS;
+    for (blk = 1; blk < s->num_blocks; blk++, exp += AC3_MAX_COEFS) {
+        if (ch == CPL_CH) {
+            if (!s->blocks[blk-1].cpl_in_use) {
                 exp_strategy[blk] = EXP_NEW;
                 continue;
+            } else if (!s->blocks[blk].cpl_in_use) {
+                exp_strategy[blk] = EXP_REUSE;
+                continue;
             }
-            exp_diff = s->mecc.sad[0](NULL, exp, exp - AC3_MAX_COEFS, 16, 16);
-            exp_strategy[blk] = EXP_REUSE;
-            if (ch == CPL_CH && exp_diff > (EXP_DIFF_THRESHOLD * (s->blocks[blk].end_freq[ch] - s->start_freq[ch]) / AC3_MAX_COEFS))
-                exp_strategy[blk] = EXP_NEW;
-            else if (ch > CPL_CH && exp_diff > EXP_DIFF_THRESHOLD)
-                exp_strategy[blk] = EXP_NEW;
-        }
-
-        /* now select the encoding strategy type : if exponents are often
-           recoded, we use a coarse encoding */
-        blk = 0;
-        while (blk < s->num_blocks) {
-            blk1 = blk + 1;
-            while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE)
-                blk1++;
-            exp_strategy[blk] = exp_strategy_reuse_tab[s->num_blks_code][blk1-blk-1];
-            blk = blk1;
+        } else if (s->blocks[blk].channel_in_cpl[ch] != s->blocks[blk-1].channel_in_cpl[ch]) {
+            exp_strategy[blk] = EXP_NEW;
+            continue;
         }
-    }
-    if (s->lfe_on) {
-        ch = s->lfe_channel;
-        s->exp_strategy[ch][0] = EXP_D15;
-        for (blk = 1; blk < s->num_blocks; blk++)
-            s->exp_strategy[ch][blk] = EXP_REUSE;
+        exp_diff = s->mecc.sad[0](NULL, exp, exp - AC3_MAX_COEFS, 16, 16);
+        exp_strategy[blk] = EXP_REUSE;
+        if (ch == CPL_CH && exp_diff > (EXP_DIFF_THRESHOLD * (s->blocks[blk].end_freq[ch] - s->start_freq[ch]) / AC3_MAX_COEFS))
+            exp_strategy[blk] = EXP_NEW;
+        else if (ch > CPL_CH && exp_diff > EXP_DIFF_THRESHOLD)
+            exp_strategy[blk] = EXP_NEW;
     }
 
-    /* for E-AC-3, determine frame exponent strategy */
-    if (CONFIG_EAC3_ENCODER && s->eac3)
-        ff_eac3_get_frame_exp_strategy(s);
+    /* now select the encoding strategy type : if exponents are often
+       recoded, we use a coarse encoding */
+    blk = 0;
+    while (blk < s->num_blocks) {
+        blk1 = blk + 1;
+        while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE)
+            blk1++;
+        exp_strategy[blk] = exp_strategy_reuse_tab[s->num_blks_code][blk1-blk-1];
+        blk = blk1;
+    }
 }
 
 
@@ -489,55 +481,49 @@ static void encode_exponents_blk_ch(uint8_t *exp, int nb_exps, int exp_strategy,
 
 
 /*
- * Encode exponents from original extracted form to what the decoder will see.
+ * Encode exponents of 1 channel from original extracted form to what the
+ * decoder will see.
  * This copies and groups exponents based on exponent strategy and reduces
  * deltas between adjacent exponent groups so that they can be differentially
  * encoded.
  */
-static void encode_exponents(AC3EncodeContext *s)
+static void encode_exponents(AC3EncodeContext *s, int ch)
 {
-    int blk, blk1, ch, cpl;
-    uint8_t *exp, *exp_strategy;
+    int blk, blk1;
+    uint8_t *exp         = s->blocks[0].exp[ch] + s->start_freq[ch];
+    uint8_t *exp_strategy = s->exp_strategy[ch];
+    int cpl              = (ch == CPL_CH);
     int nb_coefs, num_reuse_blocks;
 
-    for (ch = !s->cpl_on; ch <= s->channels; ch++) {
-        exp          = s->blocks[0].exp[ch] + s->start_freq[ch];
-        exp_strategy = s->exp_strategy[ch];
+    blk = 0;
+    while (blk < s->num_blocks) {
+        AC3Block *block = &s->blocks[blk];
+        if (cpl && !block->cpl_in_use) {
+            exp += AC3_MAX_COEFS;
+            blk++;
+            continue;
+        }
+        nb_coefs = block->end_freq[ch] - s->start_freq[ch];
+        blk1 = blk + 1;
 
-        cpl = (ch == CPL_CH);
-        blk = 0;
-        while (blk < s->num_blocks) {
-            AC3Block *block = &s->blocks[blk];
-            if (cpl && !block->cpl_in_use) {
-                exp += AC3_MAX_COEFS;
-                blk++;
-                continue;
-            }
-            nb_coefs = block->end_freq[ch] - s->start_freq[ch];
-            blk1 = blk + 1;
-
-            /* count the number of EXP_REUSE blocks after the current block
-               and set exponent reference block numbers */
-            s->exp_ref_block[ch][blk] = blk;
-            while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE) {
-                s->exp_ref_block[ch][blk1] = blk;
-                blk1++;
-            }
-            num_reuse_blocks = blk1 - blk - 1;
+        /* count the number of EXP_REUSE blocks after the current block
+           and set exponent reference block numbers */
+        s->exp_ref_block[ch][blk] = blk;
+        while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE) {
+            s->exp_ref_block[ch][blk1] = blk;
+            blk1++;
+        }
+        num_reuse_blocks = blk1 - blk - 1;
 
-            /* for the EXP_REUSE case we select the min of the exponents */
-            s->ac3dsp.ac3_exponent_min(exp-s->start_freq[ch], num_reuse_blocks,
-                                       AC3_MAX_COEFS);
+        /* for the EXP_REUSE case we select the min of the exponents */
+        s->ac3dsp.ac3_exponent_min(exp-s->start_freq[ch], num_reuse_blocks,
+                                   AC3_MAX_COEFS);
 
-            encode_exponents_blk_ch(exp, nb_coefs, exp_strategy[blk], cpl);
+        encode_exponents_blk_ch(exp, nb_coefs, exp_strategy[blk], cpl);
 
-            exp += AC3_MAX_COEFS * (num_reuse_blocks + 1);
-            blk = blk1;
-        }
+        exp += AC3_MAX_COEFS * (num_reuse_blocks + 1);
+        blk = blk1;
     }
-
-    /* reference block numbers have been changed, so reset ref_bap_set */
-    s->ref_bap_set = 0;
 }
 
 
@@ -634,15 +620,34 @@ void ff_ac3_group_exponents(AC3EncodeContext *s)
  *
  * @param s  AC-3 encoder private context
  */
-void ff_ac3_process_exponents(AC3EncodeContext *s)
+static int process_exponents_ch(AVCodecContext *avctx, void *arg, int jobnr,
+                                int threadnr)
 {
-    extract_exponents(s);
+    AC3EncodeContext *s = avctx->priv_data;
+    int ch = jobnr + !s->cpl_on;
 
-    compute_exp_strategy(s);
+    extract_exponents(s, ch);
 
-    encode_exponents(s);
+    compute_exp_strategy(s, ch);
+
+    encode_exponents(s, ch);
 
     emms_c();
+    return 0;
+}
+
+void ff_ac3_process_exponents(AC3EncodeContext *s)
+{
+    /* channels are independent up to the frame exponent strategy */
+    s->avctx->execute2(s->avctx, process_exponents_ch, NULL, NULL,
+                       s->channels + s->cpl_on);
+
+    /* for E-AC-3, determine frame exponent strategy */
+    if (CONFIG_EAC3_ENCODER && s->eac3)
+        ff_eac3_get_frame_exp_strategy(s);
+
+    /* reference block numbers have been changed, so reset ref_bap_set */
+    s->ref_bap_set = 0;
 }
 
 
@@ -1033,24 +1038,61 @@ static void count_mantissa_bits_update_ch(AC3EncodeContext *s, int ch,
 
 
 /*
- * Count the number of mantissa bits in the frame based on the bap values.
+ * Count the number of mantissa bits in the frame based on the per-channel
+ * bap value counts.
  */
 static int count_mantissa_bits(AC3EncodeContext *s)
 {
-    int ch, max_end_freq;
+    int blk, ch, i;
     LOCAL_ALIGNED_16(uint16_t, mant_cnt, [AC3_MAX_BLOCKS], [16]);
 
     count_mantissa_bits_init(mant_cnt);
 
-    max_end_freq = s->bandwidth_code * 3 + 73;
     for (ch = !s->cpl_enabled; ch <= s->channels; ch++)
-        count_mantissa_bits_update_ch(s, ch, mant_cnt, s->start_freq[ch],
-                                      max_end_freq);
+        for (blk = 0; blk < s->num_blocks; blk++)
+            for (i = 0; i < 16; i++)
+                mant_cnt[blk][i] += s->ch_mant_cnt[ch][blk][i];
 
     return s->ac3dsp.compute_mantissa_size(mant_cnt);
 }
 
 
+/*
+ * Run the bit allocation for 1 channel and count its bap values.
+ */
+static int bit_alloc_ch(AVCodecContext *avctx, void *arg, int jobnr,
+                        int threadnr)
+{
+    AC3EncodeContext *s = avctx->priv_data;
+    int ch = jobnr + !s->cpl_enabled;
+    int blk;
+
+    for (blk = 0; blk < s->num_blocks; blk++) {
+        AC3Block *block = &s->blocks[blk];
+
+        if (ch == CPL_CH && !block->cpl_in_use)
+            continue;
+        /* Currently the only bit allocation parameters which vary across
+           blocks within a frame are the exponent values.  We can take
+           advantage of that by reusing the bit allocation pointers
+           whenever we reuse exponents. */
+        if (s->exp_strategy[ch][blk] != EXP_REUSE) {
+            s->ac3dsp.bit_alloc_calc_bap(block->mask[ch], block->psd[ch],
+                                         s->start_freq[ch], block->end_freq[ch],
+                                         s->bap_snr_offset, s->bit_alloc.floor,
+                                         ff_ac3_bap_tab, s->ref_bap[ch][blk]);
+        }
+    }
+
+    memset(s->ch_mant_cnt[ch], 0, sizeof(s->ch_mant_cnt[ch]));
+    count_mantissa_bits_update_ch(s, ch, s->ch_mant_cnt[ch], s->start_freq[ch],
+                                  s->bandwidth_code * 3 + 73);
+
+    emms_c();
+    return 0;
+}
+
+
 /**
  * Run the bit allocation with a given SNR offset.
  * This calculates the bit allocation pointers that will be used to determine
@@ -1063,27 +1105,12 @@ static int count_mantissa_bits(AC3EncodeContext *s)
  */
 static int bit_alloc(AC3EncodeContext *s, int snr_offset)
 {
-    int blk, ch;
-
-    snr_offset = (snr_offset - 240) << 2;
+    s->bap_snr_offset = (snr_offset - 240) << 2;
 
     reset_block_bap(s);
-    for (blk = 0; blk < s->num_blocks; blk++) {
-        AC3Block *block = &s->blocks[blk];
+    s->avctx->execute2(s->avctx, bit_alloc_ch, NULL, NULL,
+                       s->channels + s->cpl_enabled);
 
-        for (ch = !block->cpl_in_use; ch <= s->channels; ch++) {
-            /* Currently the only bit allocation parameters which vary across
-               blocks within a frame are the exponent values.  We can take
-               advantage of that by reusing the bit allocation pointers
-               whenever we reuse exponents. */
-            if (s->exp_strategy[ch][blk] != EXP_REUSE) {
-                s->ac3dsp.bit_alloc_calc_bap(block->mask[ch], block->psd[ch],
-                                             s->start_freq[ch], block->end_freq[ch],
-                                             snr_offset, s->bit_alloc.floor,
-                                             ff_ac3_bap_tab, s->ref_bap[ch][blk]);
-            }
-        }
-    }
     return count_mantissa_bits(s);
 }
 
@@ -2051,7 +2078,9 @@ av_cold int ff_ac3_encode_close(AVCodecContext *avctx)
         av_freep(&block->cpl_coord_mant);
     }
 
-    s->mdct_end(s);
+    if (s->mdct_end)
+        s->mdct_end(s);
+    av_freep(&s->mdct);
 
     return 0;
 }
@@ -2474,6 +2503,12 @@ av_cold int ff_ac3_encode_init(AVCodecContext *avctx)
 
     bit_alloc_init(s);
 
+    s->thread_count = FFMAX(avctx->thread_count, 1);
+    s->mdct = av_mallocz_array(s->thread_count, sizeof(*s->mdct));
+    if (!s->mdct) {
+        ret = AVERROR(ENOMEM);
+        goto init_fail;
+    }
     ret = s->mdct_init(s);
     if (ret)
         goto init_fail;
@@ -168,7 +168,7 @@ typedef struct AC3EncodeContext {
     AVFloatDSPContext *fdsp;
     MECmpContext mecc;
     AC3DSPContext ac3dsp;                   ///< AC-3 optimized functions
-    FFTContext mdct;                        ///< FFT context for MDCT calculation
+    FFTContext *mdct;                       ///< FFT contexts for MDCT calculation, one per thread
     const SampleType *mdct_window;          ///< MDCT window function array
 
     AC3Block blocks[AC3_MAX_BLOCKS];        ///< per-block info
@@ -232,6 +232,10 @@ typedef struct AC3EncodeContext {
     int frame_bits_fixed;                   ///< number of non-coefficient bits for fixed parameters
     int frame_bits;                         ///< all frame bits except exponents and mantissas
     int exponent_bits;                      ///< number of bits used for exponents
+    int bap_snr_offset;                     ///< SNR offset being tried by the bit allocation search
+    uint16_t ch_mant_cnt[AC3_MAX_CHANNELS][AC3_MAX_BLOCKS][16]; ///< per-channel mantissa counts for each bap value
+
+    int thread_count;                       ///< number of per-thread MDCT contexts and buffers
 
     SampleType *windowed_samples;
     SampleType **planar_samples;
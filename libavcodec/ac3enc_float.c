@@ -96,7 +96,10 @@ static void sum_square_butterfly(AC3EncodeContext *s, float sum[4],
  */
 av_cold void ff_ac3_float_mdct_end(AC3EncodeContext *s)
 {
-    ff_mdct_end(&s->mdct);
+    int i;
+
+    for (i = 0; s->mdct && i < s->thread_count; i++)
+        ff_mdct_end(&s->mdct[i]);
     av_freep(&s->mdct_window);
 }
 
@@ -110,7 +113,7 @@ av_cold void ff_ac3_float_mdct_end(AC3EncodeContext *s)
 av_cold int ff_ac3_float_mdct_init(AC3EncodeContext *s)
 {
     float *window;
-    int i, n, n2;
+    int i, n, n2, ret;
 
     n  = 1 << 9;
     n2 = n >> 1;
@@ -125,7 +128,12 @@ av_cold int ff_ac3_float_mdct_init(AC3EncodeContext *s)
         window[n-1-i] = window[i];
     s->mdct_window = window;
 
-    return ff_mdct_init(&s->mdct, 9, 0, -2.0 / n);
+    for (i = 0; i < s->thread_count; i++) {
+        ret = ff_mdct_init(&s->mdct[i], 9, 0, -2.0 / n);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
 }
 
 
@@ -151,5 +159,6 @@ AVCodec ff_ac3_encoder = {
                                                       AV_SAMPLE_FMT_NONE },
     .priv_class      = &ac3enc_class,
     .channel_layouts = ff_ac3_channel_layouts,
+    .capabilities    = AV_CODEC_CAP_SLICE_THREADS,
     .defaults        = ac3_defaults,
 };
@@ -271,6 +271,8 @@ static av_cold int dnxhd_init_qmat(DNXHDEncContext *ctx, int lbias, int cbias)
     const uint8_t *luma_weight_table   = ctx->cid_table->luma_weight;
     const uint8_t *chroma_weight_table = ctx->cid_table->chroma_weight;
 
+    ctx->rd_qmax = ctx->m.avctx->qmax;
+
     FF_ALLOCZ_ARRAY_OR_GOTO(ctx->m.avctx, ctx->qmatrix_l,
                       (ctx->m.avctx->qmax + 1), 64 * sizeof(int), fail);
     FF_ALLOCZ_ARRAY_OR_GOTO(ctx->m.avctx, ctx->qmatrix_c,
@@ -298,6 +300,19 @@ static av_cold int dnxhd_init_qmat(DNXHDEncContext *ctx, int lbias, int cbias)
                           weight_matrix, ctx->intra_quant_bias, 1,
                           ctx->m.avctx->qmax, 1);
 
+        /* The 16-bit matrices of the SIMD quantiser saturate at large
+         * qscales, the coefficients come back and their size estimate is
+         * meaningless. Keep those qscales out of the RD search. */
+        for (qscale = 1; qscale < ctx->rd_qmax; qscale++) {
+            for (i = 1; i < 64; i++) {
+                if (ctx->qmatrix_l16[qscale][0][i] == 128 * 256 - 1 ||
+                    ctx->qmatrix_c16[qscale][0][i] == 128 * 256 - 1) {
+                    ctx->rd_qmax = qscale;
+                    break;
+                }
+            }
+        }
+
         for (qscale = 1; qscale <= ctx->m.avctx->qmax; qscale++) {
             for (i = 0; i < 64; i++) {
                 ctx->qmatrix_l[qscale][i]      <<= 2;
@@ -517,7 +532,7 @@ static av_cold int dnxhd_encode_init(AVCodecContext *avctx)
     FF_ALLOCZ_OR_GOTO(ctx->m.avctx, ctx->mb_bits,
                       ctx->m.mb_num * sizeof(uint16_t), fail);
     FF_ALLOCZ_OR_GOTO(ctx->m.avctx, ctx->mb_qscale,
-                      ctx->m.mb_num * sizeof(uint8_t), fail);
+                      ctx->m.mb_num * sizeof(uint16_t), fail);
 
 #if FF_API_CODED_FRAME
 FF_DISABLE_DEPRECATION_WARNINGS
@@ -846,13 +861,60 @@ int dnxhd_switch_matrix(DNXHDEncContext *ctx, int i)
     return x;
 }
 
+/**
+ * Compute the size and distortion of the current macroblock at qscale.
+ * @return 1 if any AC coefficient is left after quantisation, 0 otherwise
+ */
+static av_always_inline
+int dnxhd_calc_mb_rc(AVCodecContext *avctx, DNXHDEncContext *ctx,
+                     unsigned mb, int qscale)
+{
+    LOCAL_ALIGNED_16(int16_t, block, [64]);
+    int ssd     = 0;
+    int ac_bits = 0;
+    int dc_bits = 0;
+    int i;
+
+    for (i = 0; i < 8 + 4 * ctx->is_444; i++) {
+        int16_t *src_block = ctx->blocks[i];
+        int overflow, nbits, diff, last_index;
+        int n = dnxhd_switch_matrix(ctx, i);
+
+        memcpy(block, src_block, 64 * sizeof(*block));
+        last_index = ctx->m.dct_quantize(&ctx->m, block,
+                                         ctx->is_444 ? 4 * (n > 0): 4 & (2*i),
+                                         qscale, &overflow);
+        ac_bits   += dnxhd_calc_ac_bits(ctx, block, last_index);
+
+        diff = block[0] - ctx->m.last_dc[n];
+        if (diff < 0)
+            nbits = av_log2_16bit(-2 * diff);
+        else
+            nbits = av_log2_16bit(2 * diff);
+
+        av_assert1(nbits < ctx->bit_depth + 4);
+        dc_bits += ctx->cid_table->dc_bits[nbits] + nbits;
+
+        ctx->m.last_dc[n] = block[0];
+
+        if (avctx->mb_decision == FF_MB_DECISION_RD || !RC_VARIANCE) {
+            dnxhd_unquantize_c(ctx, block, i, qscale, last_index);
+            ctx->m.idsp.idct(block);
+            ssd += dnxhd_ssd_block(block, src_block);
+        }
+    }
+    ctx->mb_rc[(qscale * ctx->m.mb_num) + mb].ssd  = ssd;
+    ctx->mb_rc[(qscale * ctx->m.mb_num) + mb].bits = ac_bits + dc_bits + 12 +
+                                 (1 + ctx->is_444) * 8 * ctx->vlc_bits[0];
+    return ac_bits > 0;
+}
+
 static int dnxhd_calc_bits_thread(AVCodecContext *avctx, void *arg,
                                   int jobnr, int threadnr)
 {
     DNXHDEncContext *ctx = avctx->priv_data;
     int mb_y = jobnr, mb_x;
     int qscale = ctx->qscale;
-    LOCAL_ALIGNED_16(int16_t, block, [64]);
     ctx = ctx->thread[threadnr];
 
     ctx->m.last_dc[0] =
@@ -861,44 +923,46 @@ static int dnxhd_calc_bits_thread(AVCodecContext *avctx, void *arg,
 
     for (mb_x = 0; mb_x < ctx->m.mb_width; mb_x++) {
         unsigned mb = mb_y * ctx->m.mb_width + mb_x;
-        int ssd     = 0;
-        int ac_bits = 0;
-        int dc_bits = 0;
-        int i;
 
         dnxhd_get_blocks(ctx, mb_x, mb_y);
+        dnxhd_calc_mb_rc(avctx, ctx, mb, qscale);
+    }
+    return 0;
+}
 
-        for (i = 0; i < 8 + 4 * ctx->is_444; i++) {
-            int16_t *src_block = ctx->blocks[i];
-            int overflow, nbits, diff, last_index;
-            int n = dnxhd_switch_matrix(ctx, i);
-
-            memcpy(block, src_block, 64 * sizeof(*block));
-            last_index = ctx->m.dct_quantize(&ctx->m, block,
-                                             ctx->is_444 ? 4 * (n > 0): 4 & (2*i),
-                                             qscale, &overflow);
-            ac_bits   += dnxhd_calc_ac_bits(ctx, block, last_index);
-
-            diff = block[0] - ctx->m.last_dc[n];
-            if (diff < 0)
-                nbits = av_log2_16bit(-2 * diff);
-            else
-                nbits = av_log2_16bit(2 * diff);
+/**
+ * Compute the size and distortion of a macroblock row for every qscale.
+ * The quantised coefficients only shrink as qscale grows and the DC does
+ * not depend on it, so the search stops at the first qscale that leaves
+ * no AC coefficient. The entry after it is marked with zero bits, which
+ * ends the candidates of the macroblock for the RD search.
+ */
+static int dnxhd_calc_bits_all_thread(AVCodecContext *avctx, void *arg,
+                                      int jobnr, int threadnr)
+{
+    DNXHDEncContext *ctx = avctx->priv_data;
+    int mb_y = jobnr, mb_x, q;
+    ctx = ctx->thread[threadnr];
+
+    ctx->m.last_dc[0] =
+    ctx->m.last_dc[1] =
+    ctx->m.last_dc[2] = 1 << (ctx->bit_depth + 2);
 
-            av_assert1(nbits < ctx->bit_depth + 4);
-            dc_bits += ctx->cid_table->dc_bits[nbits] + nbits;
+    for (mb_x = 0; mb_x < ctx->m.mb_width; mb_x++) {
+        unsigned mb = mb_y * ctx->m.mb_width + mb_x;
+        int last_dc[3];
 
-            ctx->m.last_dc[n] = block[0];
+        memcpy(last_dc, ctx->m.last_dc, sizeof(last_dc));
+        dnxhd_get_blocks(ctx, mb_x, mb_y);
 
-            if (avctx->mb_decision == FF_MB_DECISION_RD || !RC_VARIANCE) {
-                dnxhd_unquantize_c(ctx, block, i, qscale, last_index);
-                ctx->m.idsp.idct(block);
-                ssd += dnxhd_ssd_block(block, src_block);
+        for (q = 1; q < ctx->rd_qmax; q++) {
+            memcpy(ctx->m.last_dc, last_dc, sizeof(last_dc));
+            if (!dnxhd_calc_mb_rc(avctx, ctx, mb, q)) {
+                if (q + 1 < ctx->rd_qmax)
+                    ctx->mb_rc[((q + 1) * ctx->m.mb_num) + mb].bits = 0;
+                break;
             }
         }
-        ctx->mb_rc[(qscale * ctx->m.mb_num) + mb].ssd  = ssd;
-        ctx->mb_rc[(qscale * ctx->m.mb_num) + mb].bits = ac_bits + dc_bits + 12 +
-                                     (1 + ctx->is_444) * 8 * ctx->vlc_bits[0];
     }
     return 0;
 }
@@ -1035,11 +1099,8 @@ static int dnxhd_encode_rdo(AVCodecContext *avctx, DNXHDEncContext *ctx)
     int last_lower = INT_MAX, last_higher = 0;
     int x, y, q;
 
-    for (q = 1; q < avctx->qmax; q++) {
-        ctx->qscale = q;
-        avctx->execute2(avctx, dnxhd_calc_bits_thread,
-                        NULL, NULL, ctx->m.mb_height);
-    }
+    avctx->execute2(avctx, dnxhd_calc_bits_all_thread,
+                    NULL, NULL, ctx->m.mb_height);
     up_step = down_step = 2 << LAMBDA_FRAC_BITS;
     lambda  = ctx->lambda;
 
@@ -1056,10 +1117,13 @@ static int dnxhd_encode_rdo(AVCodecContext *avctx, DNXHDEncContext *ctx)
                 int qscale = 1;
                 int mb     = y * ctx->m.mb_width + x;
                 int rc = 0;
-                for (q = 1; q < avctx->qmax; q++) {
+                for (q = 1; q < ctx->rd_qmax; q++) {
                     int i = (q*ctx->m.mb_num) + mb;
-                    unsigned score = ctx->mb_rc[i].bits * lambda +
-                                     ((unsigned) ctx->mb_rc[i].ssd << LAMBDA_FRAC_BITS);
+                    unsigned score;
+                    if (!ctx->mb_rc[i].bits)
+                        break;
+                    score = ctx->mb_rc[i].bits * lambda +
+                            ((unsigned) ctx->mb_rc[i].ssd << LAMBDA_FRAC_BITS);
                     if (score < min) {
                         min    = score;
                         qscale = q;
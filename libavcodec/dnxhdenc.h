@@ -97,9 +97,10 @@ typedef struct DNXHDEncContext {
     unsigned slice_bits;
     unsigned qscale;
     unsigned lambda;
+    int rd_qmax; ///< qscales below this one are searched by the RD path
 
     uint16_t *mb_bits;
-    uint8_t  *mb_qscale;
+    uint16_t *mb_qscale;
 
     RCCMPEntry *mb_cmp;
     RCCMPEntry *mb_cmp_tmp;
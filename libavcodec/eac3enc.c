@@ -264,5 +264,6 @@ AVCodec ff_eac3_encoder = {
                                                       AV_SAMPLE_FMT_NONE },
     .priv_class      = &eac3enc_class,
     .channel_layouts = ff_ac3_channel_layouts,
+    .capabilities    = AV_CODEC_CAP_SLICE_THREADS,
     .defaults        = ac3_defaults,
 };
@@ -138,6 +138,11 @@ typedef struct FFV1Context {
     int slice_coding_mode;
     int slice_rct_by_coef;
     int slice_rct_ry_coef;
+
+    int adaptive_slices;
+    int adaptive_slice_count;
+    int64_t max_slice_area;
+    int64_t slice_cost;                  ///< coding cost of the slice since the last layout change
 } FFV1Context;
 
 int ff_ffv1_common_init(AVCodecContext *avctx);
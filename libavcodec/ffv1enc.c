@@ -505,6 +505,120 @@ static int sort_stt(FFV1Context *s, uint8_t stt[256])
     return print;
 }
 
+#define SLICE_ROW_Y(f, row) ((f)->height * (row) / (f)->num_v_slices)
+
+static int slice_rows_fit(FFV1Context *f, int start, int end)
+{
+    int64_t height = SLICE_ROW_Y(f, end) - SLICE_ROW_Y(f, start);
+    return (int64_t)f->width * height <= f->max_slice_area;
+}
+
+/**
+ * Choose the number of slices and the grid of rows they are made of.
+ * Slices are horizontal bands of consecutive grid rows, their height is
+ * chosen at every keyframe by update_slice_layout().
+ */
+static av_cold int init_adaptive_slices(FFV1Context *s, int plane_count)
+{
+    AVCodecContext *avctx = s->avctx;
+    int count = avctx->slices ? avctx->slices : 2 * FFMAX(avctx->thread_count, 1);
+    int rows, i;
+
+    /* slices must stay below 16 MiB, see the slice size field */
+    s->max_slice_area = (8LL << 24) / ((s->bits_per_raw_sample + 1) * plane_count);
+    if (s->max_slice_area < s->width) {
+        av_log(avctx, AV_LOG_ERROR, "Frame too wide for adaptive slices\n");
+        return AVERROR(EINVAL);
+    }
+
+    /* The grid rows are kept at least two lines high so that the slice
+     * positions can be coded exactly. */
+    rows = FFMIN(MAX_SLICES, FFMAX(1, avctx->height / 2));
+    if (!avctx->slices)
+        count = FFMIN(count, rows);
+    for (; count <= rows; count++) {
+        s->num_h_slices = 1;
+        s->num_v_slices = FFMIN(rows, FFMAX(8 * count, 32));
+        for (i = 0; i < count; i++)
+            if (!slice_rows_fit(s, s->num_v_slices *  i      / count,
+                                   s->num_v_slices * (i + 1) / count))
+                break;
+        if (i == count)
+            break;
+    }
+    if (count > rows) {
+        av_log(avctx, AV_LOG_ERROR, "Unsupported number %d of slices requested\n",
+               avctx->slices);
+        return AVERROR(ENOSYS);
+    }
+    if (avctx->slices && count != avctx->slices)
+        av_log(avctx, AV_LOG_WARNING, "Using %d slices instead of %d\n",
+               count, avctx->slices);
+    s->adaptive_slice_count = count;
+    return 0;
+}
+
+/**
+ * Split the frame into bands of similar coding cost, using the costs of
+ * the current layout.
+ */
+static void update_slice_layout(FFV1Context *f)
+{
+    int64_t row_cost[MAX_SLICES], total = 0, acc = 0;
+    int rows  = f->num_v_slices;
+    int count = f->slice_count;
+    int start[MAX_SLICES + 1];
+    int i, r;
+
+    for (r = 0; r < rows; r++)
+        row_cost[r] = 0;
+    for (i = 0; i < count; i++) {
+        FFV1Context *fs = f->slice_context[i];
+        int a = (fs->slice_y      + 1) * rows / f->height;
+        int n = (fs->slice_height + 1) * rows / f->height;
+        for (r = a; r < a + n && r < rows && fs->slice_height; r++)
+            row_cost[r] += fs->slice_cost *
+                           (SLICE_ROW_Y(f, r + 1) - SLICE_ROW_Y(f, r)) / fs->slice_height;
+    }
+    for (r = 0; r < rows; r++)
+        total += row_cost[r];
+    if (!total) {
+        for (r = 0; r < rows; r++)
+            total += row_cost[r] = SLICE_ROW_Y(f, r + 1) - SLICE_ROW_Y(f, r);
+    }
+
+    start[0] = 0;
+    r        = 0;
+    for (i = 0; i < count - 1; i++) {
+        int64_t goal = total * (i + 1) / count;
+        int end      = start[i] + 1;
+
+        acc += row_cost[r++];
+        while (end < rows - (count - 1 - i) && slice_rows_fit(f, start[i], end + 1) &&
+               acc + row_cost[r] / 2 < goal) {
+            acc += row_cost[r++];
+            end++;
+        }
+        start[i + 1] = end;
+    }
+    start[count] = rows;
+
+    if (!slice_rows_fit(f, start[count - 1], rows))
+        for (i = 0; i <= count; i++)
+            start[i] = rows * i / count;
+
+    for (i = 0; i < count; i++) {
+        FFV1Context *fs = f->slice_context[i];
+        fs->slice_x      = 0;
+        fs->slice_width  = f->width;
+        fs->slice_y      = SLICE_ROW_Y(f, start[i]);
+        fs->slice_height = SLICE_ROW_Y(f, start[i + 1]) - fs->slice_y;
+        fs->slice_cost   = 0;
+        ff_dlog(f->avctx, "slice %d: lines %d-%d\n", i,
+                fs->slice_y, fs->slice_y + fs->slice_height - 1);
+    }
+}
+
 static av_cold int encode_init(AVCodecContext *avctx)
 {
     FFV1Context *s = avctx->priv_data;
@@ -524,6 +638,10 @@ static av_cold int encode_init(AVCodecContext *avctx)
     if (avctx->slices == 0 && avctx->level < 0 && avctx->width * avctx->height > 720*576)
         s->version = FFMAX(s->version, 2);
 
+    // Adaptive slice layouts are signalled in the slice headers of version 3+
+    if (s->adaptive_slices)
+        s->version = FFMAX(s->version, 3);
+
     if (avctx->level <= 0 && s->version == 2) {
         s->version = 3;
     }
@@ -871,6 +989,12 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
         s->num_v_slices = FFMIN(s->num_v_slices, max_v_slices);
 
+        if (s->adaptive_slices) {
+            if ((ret = init_adaptive_slices(s, plane_count)) < 0)
+                return ret;
+            goto slices_ok;
+        }
+
         for (; s->num_v_slices < 32; s->num_v_slices++) {
             for (s->num_h_slices = s->num_v_slices; s->num_h_slices < 2*s->num_v_slices; s->num_h_slices++) {
                 int maxw = (avctx->width  + s->num_h_slices - 1) / s->num_h_slices;
@@ -896,6 +1020,10 @@ slices_ok:
     if ((ret = ff_ffv1_init_slice_contexts(s)) < 0)
         return ret;
     s->slice_count = s->max_slice_count;
+    if (s->adaptive_slices) {
+        s->slice_count = s->adaptive_slice_count;
+        update_slice_layout(s);
+    }
     if ((ret = ff_ffv1_init_slices_state(s)) < 0)
         return ret;
 
@@ -1118,6 +1246,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     AVFrame *const p    = f->picture.f;
     uint8_t keystate    = 128;
     uint8_t *buf_p;
+    int slice_buf_size[MAX_SLICES];
     int i, ret;
     int64_t maxsize =   AV_INPUT_BUFFER_MIN_SIZE
                       + avctx->width*avctx->height*37LL*4;
@@ -1132,8 +1261,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
             for (i = 0; i < f->quant_table_count; i++)
                 memset(f->rc_stat2[i], 0, f->context_count[i] * sizeof(*f->rc_stat2[i]));
 
-            av_assert0(f->slice_count == f->max_slice_count);
-            for (j = 0; j < f->slice_count; j++) {
+            for (j = 0; j < f->max_slice_count; j++) {
                 FFV1Context *fs = f->slice_context[j];
                 for (i = 0; i < 256; i++) {
                     f->rc_stat[i][0] += fs->rc_stat[i][0];
@@ -1209,10 +1337,20 @@ FF_ENABLE_DEPRECATION_WARNINGS
         }
     }
 
+    if (f->adaptive_slices && f->key_frame && f->picture_number)
+        update_slice_layout(f);
+
     for (i = 0; i < f->slice_count; i++) {
         FFV1Context *fs = f->slice_context[i];
         uint8_t *start  = pkt->data + pkt->size * (int64_t)i / f->slice_count;
         int len         = pkt->size / f->slice_count;
+        if (f->adaptive_slices) {
+            /* slices differ in size, share the buffer by their height */
+            start = pkt->data + pkt->size * (int64_t)fs->slice_y / f->height;
+            len   = pkt->size * (int64_t)(fs->slice_y + fs->slice_height) / f->height -
+                    (start - pkt->data);
+        }
+        slice_buf_size[i] = len;
         if (i) {
             ff_init_range_encoder(&fs->c, start, len);
         } else {
@@ -1235,8 +1373,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
             flush_put_bits(&fs->pb); // FIXME: nicer padding
             bytes = fs->ac_byte_count + (put_bits_count(&fs->pb) + 7) / 8;
         }
+        fs->slice_cost += bytes + fs->slice_width * fs->slice_height / 4;
         if (i > 0 || f->version > 2) {
-            av_assert0(bytes < pkt->size / f->slice_count);
+            av_assert0(bytes < slice_buf_size[i]);
             memmove(buf_p, fs->c.bytestream_start, bytes);
             av_assert0(bytes < (1 << 24));
             AV_WB24(buf_p + bytes, bytes);
@@ -1293,6 +1432,8 @@ static const AVOption options[] = {
             { .i64 = 1 }, INT_MIN, INT_MAX, VE, "coder" },
     { "context", "Context model", OFFSET(context_model), AV_OPT_TYPE_INT,
             { .i64 = 0 }, 0, 1, VE },
+    { "adaptive_slices", "Balance the slice sizes by their coding cost at every keyframe", OFFSET(adaptive_slices), AV_OPT_TYPE_BOOL,
+            { .i64 = 0 }, 0, 1, VE },
 
     { NULL }
 };
@@ -30,6 +30,7 @@
 #include "hevc.h"
 #include "h264.h"
 #include "h2645_parse.h"
+#include "startcode.h"
 
 int ff_h2645_extract_rbsp(const uint8_t *src, int length,
                           H2645RBSP *rbsp, H2645NAL *nal, int small_padding)
@@ -99,10 +100,16 @@ int ff_h2645_extract_rbsp(const uint8_t *src, int length,
     si = di = i;
     while (si + 2 < length) {
         // remove escapes (very rare 1:2^22)
-        if (src[si + 2] > 3) {
-            dst[di++] = src[si++];
-            dst[di++] = src[si++];
-        } else if (src[si] == 0 && src[si + 1] == 0 && src[si + 2] != 0) {
+        if (src[si]) {
+            /* copy up to the next zero byte at once */
+            int run = FFMIN(ff_startcode_find_candidate(src + si, length - 2 - si),
+                            length - 2 - si);
+            memcpy(dst + di, src + si, run);
+            si += run;
+            di += run;
+            continue;
+        }
+        if (src[si + 1] == 0 && src[si + 2] != 0 && src[si + 2] <= 3) {
             if (src[si + 2] == 3) { // escape
                 dst[di++] = 0;
                 dst[di++] = 0;
@@ -336,7 +343,12 @@ static int find_next_start_code(const uint8_t *buf, const uint8_t *next_avc)
         return next_avc - buf;
 
     while (buf + i + 3 < next_avc) {
-        if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1)
+        if (buf[i]) {
+            int left = next_avc - buf - 3 - i;
+            i += FFMIN(ff_startcode_find_candidate(buf + i, left), left);
+            continue;
+        }
+        if (buf[i + 1] == 0 && buf[i + 2] == 1)
             break;
         i++;
     }
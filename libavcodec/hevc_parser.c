@@ -30,6 +30,7 @@
 #include "h2645_parse.h"
 #include "internal.h"
 #include "parser.h"
+#include "startcode.h"
 
 #define START_CODE 0x000001 ///< start_code_prefix_one_3bytes
 
@@ -257,6 +258,19 @@ static int hevc_find_frame_end(AVCodecParserContext *s, const uint8_t *buf,
     for (i = 0; i < buf_size; i++) {
         int nut;
 
+        if ((pc->state64 & 0xFF) && (pc->state64 & 0xFF00) &&
+            (pc->state64 & 0xFF0000) && (pc->state64 & 0xFF000000)) {
+            /* no start code can be completed before the next zero byte */
+            int j, next = i + FFMIN(ff_startcode_find_candidate(buf + i, buf_size - i),
+                                    buf_size - i);
+
+            for (j = FFMAX(i, next - 8); j < next; j++)
+                pc->state64 = (pc->state64 << 8) | buf[j];
+            i = next;
+            if (i >= buf_size)
+                break;
+        }
+
         pc->state64 = (pc->state64 << 8) | buf[i];
 
         if (((pc->state64 >> 3 * 8) & 0xFFFFFF) != START_CODE)
@@ -379,6 +379,54 @@ static int bands_dist(OpusPsyContext *s, CeltFrame *f, float *total_dist)
     return 0;
 }
 
+static void run_trial(OpusPsyContext *s, int trial, int thread, uint32_t seed)
+{
+    CeltFrame *f = &s->trial_frames[thread];
+
+    memcpy(f, s->trial_src, sizeof(*f));
+    f->pvq              = s->trial_pvq[thread];
+    f->seed             = seed;
+    f->intensity_stereo = s->trial_intensity[trial];
+    f->dual_stereo      = s->trial_dual[trial];
+
+    bands_dist(s, f, &s->trial_dist[trial]);
+    s->trial_seed_start[trial] = seed;
+    s->trial_seed_end[trial]   = f->seed;
+}
+
+/* Each trial works on a copy of the frame, so they are independent */
+static int bands_dist_thread(AVCodecContext *avctx, void *arg,
+                             int jobnr, int threadnr)
+{
+    OpusPsyContext *s = arg;
+
+    run_trial(s, jobnr, threadnr, s->trial_src->seed);
+
+    return 0;
+}
+
+/*
+ * Done one after the other, each trial would continue from the noise seed
+ * the previous one left. The trials all start from the seed of the frame
+ * here, so the ones that started from a wrong seed, i.e. those following a
+ * trial that drew noise, are run again in order with the right one.
+ */
+static void trial_bands_dist(OpusPsyContext *s, CeltFrame *f, int nb_trials)
+{
+    uint32_t seed = f->seed;
+    int i;
+
+    s->trial_src = f;
+    s->avctx->execute2(s->avctx, bands_dist_thread, s, NULL, nb_trials);
+
+    for (i = 0; i < nb_trials; i++) {
+        if (s->trial_seed_start[i] != seed)
+            run_trial(s, i, 0, seed);
+        seed = s->trial_seed_end[i];
+    }
+    f->seed = seed;
+}
+
 static void celt_search_for_dual_stereo(OpusPsyContext *s, CeltFrame *f)
 {
     float td1, td2;
@@ -387,9 +435,12 @@ static void celt_search_for_dual_stereo(OpusPsyContext *s, CeltFrame *f)
     if (s->avctx->channels < 2)
         return;
 
-    bands_dist(s, f, &td1);
-    f->dual_stereo = 1;
-    bands_dist(s, f, &td2);
+    s->trial_intensity[0] = s->trial_intensity[1] = f->intensity_stereo;
+    s->trial_dual[0]      = 0;
+    s->trial_dual[1]      = 1;
+    trial_bands_dist(s, f, 2);
+    td1 = s->trial_dist[0];
+    td2 = s->trial_dist[1];
 
     f->dual_stereo = td2 < td1;
     s->dual_stereo_used += td2 < td1;
@@ -406,8 +457,13 @@ static void celt_search_for_intensity(OpusPsyContext *s, CeltFrame *f)
         return;
 
     for (i = f->end_band; i >= end_band; i--) {
-        f->intensity_stereo = i;
-        bands_dist(s, f, &dist);
+        s->trial_intensity[f->end_band - i] = i;
+        s->trial_dual[f->end_band - i]      = f->dual_stereo;
+    }
+    trial_bands_dist(s, f, f->end_band - end_band + 1);
+
+    for (i = f->end_band; i >= end_band; i--) {
+        dist = s->trial_dist[f->end_band - i];
         if (best_dist > dist) {
             best_dist = dist;
             best_band = i;
@@ -568,12 +624,29 @@ av_cold int ff_opus_psy_init(OpusPsyContext *s, AVCodecContext *avctx,
             goto fail;
     }
 
+    s->nb_trial_threads = FFMAX(avctx->thread_count, 1);
+    s->trial_frames = av_malloc_array(s->nb_trial_threads, sizeof(*s->trial_frames));
+    s->trial_pvq    = av_mallocz_array(s->nb_trial_threads, sizeof(*s->trial_pvq));
+    if (!s->trial_frames || !s->trial_pvq) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    for (i = 0; i < s->nb_trial_threads; i++)
+        if ((ret = ff_celt_pvq_init(&s->trial_pvq[i], 1)) < 0)
+            goto fail;
+
     return 0;
 
 fail:
     av_freep(&s->inflection_points);
     av_freep(&s->dsp);
 
+    if (s->trial_pvq)
+        for (i = 0; i < s->nb_trial_threads; i++)
+            ff_celt_pvq_uninit(&s->trial_pvq[i]);
+    av_freep(&s->trial_pvq);
+    av_freep(&s->trial_frames);
+
     for (i = 0; i < CELT_BLOCK_NB; i++) {
         ff_mdct15_uninit(&s->mdct[i]);
         av_freep(&s->window[i]);
@@ -605,6 +678,12 @@ av_cold int ff_opus_psy_end(OpusPsyContext *s)
     for (i = 0; i < s->max_steps; i++)
         av_freep(&s->steps[i]);
 
+    if (s->trial_pvq)
+        for (i = 0; i < s->nb_trial_threads; i++)
+            ff_celt_pvq_uninit(&s->trial_pvq[i]);
+    av_freep(&s->trial_pvq);
+    av_freep(&s->trial_frames);
+
     av_log(s->avctx, AV_LOG_INFO, "Average Intensity Stereo band: %0.1f\n", s->avg_is_band);
     av_log(s->avctx, AV_LOG_INFO, "Dual Stereo used: %0.2f%%\n", ((float)s->dual_stereo_used/s->total_packets_out)*100.0f);
 
@@ -73,6 +73,17 @@ typedef struct OpusPsyContext {
 
     DECLARE_ALIGNED(32, float, scratch)[2048];
 
+    /* Trial band quantisation for the stereo searches, run in parallel */
+    CeltFrame *trial_frames;  /* One per thread */
+    CeltPVQ **trial_pvq;      /* One per thread */
+    int nb_trial_threads;
+    const CeltFrame *trial_src;
+    int trial_intensity[CELT_MAX_BANDS + 1];
+    int trial_dual[CELT_MAX_BANDS + 1];
+    float trial_dist[CELT_MAX_BANDS + 1];
+    uint32_t trial_seed_start[CELT_MAX_BANDS + 1];
+    uint32_t trial_seed_end[CELT_MAX_BANDS + 1];
+
     /* Stats */
     float rc_waste;
     float avg_is_band;
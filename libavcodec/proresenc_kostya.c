@@ -690,13 +690,18 @@ static int estimate_dcs(int *error, int16_t *blocks, int blocks_per_slice,
     return bits;
 }
 
+/**
+ * Estimate the size of the AC coefficients, giving up as soon as it
+ * exceeds bits_limit since the result is only compared against it then.
+ */
 static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
                         int plane_size_factor,
-                        const uint8_t *scan, const int16_t *qmat)
+                        const uint8_t *scan, const int16_t *qmat,
+                        int bits_limit)
 {
     int idx, i;
-    int run, level, run_cb, lev_cb;
-    int max_coeffs, abs_level;
+    int run, run_cb, lev_cb;
+    int max_coeffs, abs_coeff, abs_level, qm;
     int bits = 0;
 
     max_coeffs = blocks_per_slice << 6;
@@ -705,32 +710,37 @@ static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
     run        = 0;
 
     for (i = 1; i < 64; i++) {
+        qm = qmat[scan[i]];
         for (idx = scan[i]; idx < max_coeffs; idx += 64) {
-            level   = blocks[idx] / qmat[scan[i]];
-            *error += FFABS(blocks[idx]) % qmat[scan[i]];
-            if (level) {
-                abs_level = FFABS(level);
-                bits += estimate_vlc(ff_prores_ac_codebook[run_cb], run);
-                bits += estimate_vlc(ff_prores_ac_codebook[lev_cb],
-                                     abs_level - 1) + 1;
-
-                run_cb = ff_prores_run_to_cb_index[FFMIN(run, 15)];
-                lev_cb = ff_prores_lev_to_cb_index[FFMIN(abs_level, 9)];
-                run    = 0;
-            } else {
+            abs_coeff = FFABS(blocks[idx]);
+            /* most coefficients quantise to zero, avoid dividing them */
+            if (abs_coeff < qm) {
+                *error += abs_coeff;
                 run++;
+                continue;
             }
+            abs_level = abs_coeff / qm;
+            *error   += abs_coeff - abs_level * qm;
+            bits += estimate_vlc(ff_prores_ac_codebook[run_cb], run);
+            bits += estimate_vlc(ff_prores_ac_codebook[lev_cb],
+                                 abs_level - 1) + 1;
+
+            run_cb = ff_prores_run_to_cb_index[FFMIN(run, 15)];
+            lev_cb = ff_prores_lev_to_cb_index[FFMIN(abs_level, 9)];
+            run    = 0;
         }
+        if (bits > bits_limit)
+            break;
     }
 
     return bits;
 }
 
 static int estimate_slice_plane(ProresContext *ctx, int *error, int plane,
-                                const uint16_t *src, ptrdiff_t linesize,
                                 int mbs_per_slice,
                                 int blocks_per_mb, int plane_size_factor,
-                                const int16_t *qmat, ProresThreadData *td)
+                                const int16_t *qmat, ProresThreadData *td,
+                                int bits_limit)
 {
     int blocks_per_slice;
     int bits;
@@ -739,7 +749,8 @@ static int estimate_slice_plane(ProresContext *ctx, int *error, int plane,
 
     bits  = estimate_dcs(error, td->blocks[plane], blocks_per_slice, qmat[0]);
     bits += estimate_acs(error, td->blocks[plane], blocks_per_slice,
-                         plane_size_factor, ctx->scantable, qmat);
+                         plane_size_factor, ctx->scantable, qmat,
+                         bits_limit - bits);
 
     return FFALIGN(bits, 8);
 }
@@ -801,6 +812,40 @@ static int estimate_alpha_plane(ProresContext *ctx,
     return bits;
 }
 
+/**
+ * Estimate the size of the slice coded with quantiser q. The estimate stops
+ * early once it exceeds bits_limit.
+ */
+static int estimate_slice_quant(ProresContext *ctx, ProresThreadData *td,
+                                int q, int *error, int bits_limit,
+                                int mbs_per_slice, const int *num_cblocks,
+                                const int *plane_factor, int alpha_bits)
+{
+    const int16_t *qmat, *qmat_chroma;
+    int i, bits = alpha_bits;
+
+    if (q < MAX_STORED_Q) {
+        qmat        = ctx->quants[q];
+        qmat_chroma = ctx->quants_chroma[q];
+    } else {
+        for (i = 0; i < 64; i++) {
+            td->custom_q[i]        = ctx->quant_mat[i] * q;
+            td->custom_chroma_q[i] = ctx->quant_chroma_mat[i] * q;
+        }
+        qmat        = td->custom_q;
+        qmat_chroma = td->custom_chroma_q;
+    }
+
+    *error = 0;
+    for (i = 0; i < ctx->num_planes - !!ctx->alpha_bits && bits <= bits_limit; i++)
+        bits += estimate_slice_plane(ctx, error, i, mbs_per_slice,
+                                     num_cblocks[i], plane_factor[i],
+                                     i ? qmat_chroma : qmat, td,
+                                     bits_limit - bits);
+
+    return bits;
+}
+
 static int find_slice_quant(AVCodecContext *avctx,
                             int trellis_node, int x, int y, int mbs_per_slice,
                             ProresThreadData *td)
@@ -817,8 +862,6 @@ static int find_slice_quant(AVCodecContext *avctx,
     int mbs, prev, cur, new_score;
     int slice_bits[TRELLIS_WIDTH], slice_score[TRELLIS_WIDTH];
     int overquant;
-    uint16_t *qmat;
-    uint16_t *qmat_chroma;
     int linesize[4], line_add;
     int alpha_bits = 0;
 
@@ -871,58 +914,30 @@ static int find_slice_quant(AVCodecContext *avctx,
                                           mbs_per_slice, td->blocks[3]);
     // todo: maybe perform coarser quantising to fit into frame size when needed
     for (q = min_quant; q <= max_quant; q++) {
-        bits  = alpha_bits;
-        error = 0;
-        bits += estimate_slice_plane(ctx, &error, 0,
-                                     src, linesize[0],
-                                     mbs_per_slice,
-                                     num_cblocks[0], plane_factor[0],
-                                     ctx->quants[q], td); /* estimate luma plane */
-        for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) { /* estimate chroma plane */
-            bits += estimate_slice_plane(ctx, &error, i,
-                                         src, linesize[i],
-                                         mbs_per_slice,
-                                         num_cblocks[i], plane_factor[i],
-                                         ctx->quants_chroma[q], td);
-        }
+        bits = estimate_slice_quant(ctx, td, q, &error, INT_MAX,
+                                    mbs_per_slice, num_cblocks, plane_factor,
+                                    alpha_bits);
         if (bits > 65000 * 8)
             error = SCORE_LIMIT;
 
         slice_bits[q]  = bits;
         slice_score[q] = error;
     }
-    if (slice_bits[max_quant] <= ctx->bits_per_mb * mbs_per_slice) {
+    bits_limit = ctx->bits_per_mb * mbs_per_slice;
+    if (slice_bits[max_quant] <= bits_limit) {
         slice_bits[max_quant + 1]  = slice_bits[max_quant];
         slice_score[max_quant + 1] = slice_score[max_quant] + 1;
         overquant = max_quant;
     } else {
         for (q = max_quant + 1; q < 128; q++) {
-            bits  = alpha_bits;
-            error = 0;
-            if (q < MAX_STORED_Q) {
-                qmat = ctx->quants[q];
-                qmat_chroma = ctx->quants_chroma[q];
-            } else {
-                qmat = td->custom_q;
-                qmat_chroma = td->custom_chroma_q;
-                for (i = 0; i < 64; i++) {
-                    qmat[i] = ctx->quant_mat[i] * q;
-                    qmat_chroma[i] = ctx->quant_chroma_mat[i] * q;
-                }
-            }
-            bits += estimate_slice_plane(ctx, &error, 0,
-                                         src, linesize[0],
-                                         mbs_per_slice,
-                                         num_cblocks[0], plane_factor[0],
-                                         qmat, td);/* estimate luma plane */
-            for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) { /* estimate chroma plane */
-                bits += estimate_slice_plane(ctx, &error, i,
-                                             src, linesize[i],
-                                             mbs_per_slice,
-                                             num_cblocks[i], plane_factor[i],
-                                             qmat_chroma, td);
-            }
-            if (bits <= ctx->bits_per_mb * mbs_per_slice)
+            /* only whether the slice fits matters here, so the estimate
+             * may stop early, except for the last quantiser whose size
+             * is used even if it does not fit */
+            bits = estimate_slice_quant(ctx, td, q, &error,
+                                        q < 127 ? bits_limit : INT_MAX,
+                                        mbs_per_slice, num_cblocks,
+                                        plane_factor, alpha_bits);
+            if (bits <= bits_limit)
                 break;
         }
 
@@ -25,9 +25,20 @@
  * @author Michael Niedermayer <michaelni@gmx.at>
  */
 
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/thread.h"
 #include "startcode.h"
 #include "config.h"
 
+#if ARCH_ARM
+#include "libavutil/arm/cpu.h"
+#include "arm/startcode.h"
+#endif
+
+static int (*startcode_find_candidate)(const uint8_t *buf, int size);
+static AVOnce startcode_init_once = AV_ONCE_INIT;
+
 int ff_startcode_find_candidate_c(const uint8_t *buf, int size)
 {
     int i = 0;
@@ -55,3 +66,20 @@ int ff_startcode_find_candidate_c(const uint8_t *buf, int size)
             break;
     return i;
 }
+
+static av_cold void startcode_init(void)
+{
+    av_unused int cpu_flags = av_get_cpu_flags();
+
+    startcode_find_candidate = ff_startcode_find_candidate_c;
+#if ARCH_ARM && HAVE_ARMV6
+    if (have_setend(cpu_flags))
+        startcode_find_candidate = ff_startcode_find_candidate_armv6;
+#endif
+}
+
+int ff_startcode_find_candidate(const uint8_t *buf, int size)
+{
+    ff_thread_once(&startcode_init_once, startcode_init);
+    return startcode_find_candidate(buf, size);
+}
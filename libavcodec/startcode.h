@@ -29,4 +29,10 @@
 
 int ff_startcode_find_candidate_c(const uint8_t *buf, int size);
 
+/**
+ * Same as ff_startcode_find_candidate_c(), using the fastest version
+ * available on the running CPU. For callers without a DSP context.
+ */
+int ff_startcode_find_candidate(const uint8_t *buf, int size);
+
 #endif /* AVCODEC_STARTCODE_H */
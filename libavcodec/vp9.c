@@ -84,7 +84,7 @@ static void vp9_await_tile_progress(VP9Context *s, int field, int n) {
         return;
 
     pthread_mutex_lock(&s->progress_mutex);
-    while (atomic_load_explicit(&s->entries[field], memory_order_relaxed) != n)
+    while (atomic_load_explicit(&s->entries[field], memory_order_relaxed) < n)
         pthread_cond_wait(&s->progress_cond, &s->progress_mutex);
     pthread_mutex_unlock(&s->progress_mutex);
 }
@@ -770,7 +770,7 @@ static int decode_frame_header(AVCodecContext *avctx,
         vp9_free_entries(avctx);
         s->active_tile_cols = avctx->active_thread_type == FF_THREAD_SLICE ?
                               s->s.h.tiling.tile_cols : 1;
-        vp9_alloc_entries(avctx, s->sb_rows);
+        vp9_alloc_entries(avctx, s->s.h.tiling.tile_cols);
         if (avctx->active_thread_type == FF_THREAD_SLICE) {
             n_range_coders = 4; // max_tile_rows
         } else {
@@ -1426,7 +1426,7 @@ int decode_tiles_mt(AVCodecContext *avctx, void *tdata, int jobnr,
                        8 * tile_cols_len * bytesperpixel >> s->ss_h);
             }
 
-            vp9_report_tile_progress(s, row >> 3, 1);
+            vp9_report_tile_progress(s, jobnr, 1);
         }
     }
     return 0;
@@ -1438,21 +1438,31 @@ int loopfilter_proc(AVCodecContext *avctx)
     VP9Context *s = avctx->priv_data;
     ptrdiff_t uvoff, yoff, ls_y, ls_uv;
     VP9Filter *lflvl_ptr;
-    int bytesperpixel = s->bytesperpixel, col, i;
+    int bytesperpixel = s->bytesperpixel, col, i, tile_col;
+    int tile_col_start, tile_col_end;
     AVFrame *f;
 
     f = s->s.frames[CUR_FRAME].tf.f;
     ls_y = f->linesize[0];
     ls_uv =f->linesize[1];
 
+    // Filter each sb64 row one tile column at a time, as soon as that tile
+    // column has finished decoding the row. Tile columns never use pixels
+    // left of their start for intra prediction, and the row above is taken
+    // from the pre-loopfilter backup, so the filter only has to trail the
+    // tile it is working on instead of the slowest tile of the row.
     for (i = 0; i < s->sb_rows; i++) {
-        vp9_await_tile_progress(s, i, s->s.h.tiling.tile_cols);
+        yoff = (ls_y * 64)*i;
+        uvoff =  (ls_uv * 64 >> s->ss_v)*i;
+        lflvl_ptr = s->lflvl+s->sb_cols*i;
+        for (tile_col = 0; tile_col < s->s.h.tiling.tile_cols; tile_col++) {
+            set_tile_offset(&tile_col_start, &tile_col_end,
+                            tile_col, s->s.h.tiling.log2_tile_cols, s->sb_cols);
+            vp9_await_tile_progress(s, tile_col, i + 1);
 
-        if (s->s.h.filter.level) {
-            yoff = (ls_y * 64)*i;
-            uvoff =  (ls_uv * 64 >> s->ss_v)*i;
-            lflvl_ptr = s->lflvl+s->sb_cols*i;
-            for (col = 0; col < s->cols;
+            if (!s->s.h.filter.level)
+                continue;
+            for (col = tile_col_start; col < tile_col_end;
                  col += 8, yoff += 64 * bytesperpixel,
                  uvoff += 64 * bytesperpixel >> s->ss_h, lflvl_ptr++) {
                 ff_vp9_loopfilter_sb(avctx, lflvl_ptr, i << 3, col,
@@ -1596,7 +1606,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
 #if HAVE_THREADS
     if (avctx->active_thread_type & FF_THREAD_SLICE) {
-        for (i = 0; i < s->sb_rows; i++)
+        for (i = 0; i < s->s.h.tiling.tile_cols; i++)
             atomic_store(&s->entries[i], 0);
     }
 #endif
@@ -101,7 +101,7 @@ typedef struct VP9Context {
 #if HAVE_THREADS
     pthread_mutex_t progress_mutex;
     pthread_cond_t progress_cond;
-    atomic_int *entries;
+    atomic_int *entries; // sb64 rows decoded so far, per tile column
 #endif
 
     uint8_t ss_h, ss_v;
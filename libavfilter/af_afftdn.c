@@ -1079,57 +1079,95 @@ static void set_noise_profile(AudioFFTDeNoiseContext *s,
 }
 
 typedef struct ThreadData {
-    AVFrame *in;
+    AVFrame *in, *out;
+    int nb_blocks;
 } ThreadData;
 
+static void filter_block(AudioFFTDeNoiseContext *s, DeNoiseChannel *dnch,
+                         const float *src)
+{
+    double *dst = dnch->out_samples;
+
+    if (s->track_noise) {
+        int i = s->block_count & 0x1FF;
+
+        if (dnch->sfm_fail_flags[i])
+            dnch->sfm_fail_total--;
+        dnch->sfm_fail_flags[i] = 0;
+        dnch->sfm_threshold *= 1.0 - dnch->sfm_alpha;
+        dnch->sfm_threshold += dnch->sfm_alpha * (0.5 + (1.0 / 640) * dnch->sfm_fail_total);
+    }
+
+    for (int m = 0; m < s->window_length; m++) {
+        dnch->fft_data[m].re = s->window[m] * src[m] * (1LL << 24);
+        dnch->fft_data[m].im = 0;
+    }
+
+    for (int m = s->window_length; m < s->fft_length2; m++) {
+        dnch->fft_data[m].re = 0;
+        dnch->fft_data[m].im = 0;
+    }
+
+    av_fft_permute(dnch->fft, dnch->fft_data);
+    av_fft_calc(dnch->fft, dnch->fft_data);
+
+    preprocess(dnch->fft_data, s->fft_length);
+    process_frame(s, dnch, dnch->fft_data,
+                  dnch->prior,
+                  dnch->prior_band_excit,
+                  s->track_noise);
+    postprocess(dnch->fft_data, s->fft_length);
+
+    av_fft_permute(dnch->ifft, dnch->fft_data);
+    av_fft_calc(dnch->ifft, dnch->fft_data);
+
+    for (int m = 0; m < s->window_length; m++)
+        dst[m] += s->window[m] * dnch->fft_data[m].re / (1LL << 24);
+}
+
+static void output_block(AudioFFTDeNoiseContext *s, DeNoiseChannel *dnch,
+                         const float *orig, float *dst)
+{
+    double *src = dnch->out_samples;
+
+    switch (s->output_mode) {
+    case IN_MODE:
+        for (int m = 0; m < s->sample_advance; m++)
+            dst[m] = orig[m];
+        break;
+    case OUT_MODE:
+        for (int m = 0; m < s->sample_advance; m++)
+            dst[m] = src[m];
+        break;
+    case NOISE_MODE:
+        for (int m = 0; m < s->sample_advance; m++)
+            dst[m] = orig[m] - src[m];
+        break;
+    }
+    memmove(src, src + s->sample_advance, (s->window_length - s->sample_advance) * sizeof(*src));
+    memset(src + (s->window_length - s->sample_advance), 0, s->sample_advance * sizeof(*src));
+}
+
 static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     AudioFFTDeNoiseContext *s = ctx->priv;
     ThreadData *td = arg;
     AVFrame *in = td->in;
+    AVFrame *out = td->out;
     const int start = (in->channels * jobnr) / nb_jobs;
     const int end = (in->channels * (jobnr+1)) / nb_jobs;
 
     for (int ch = start; ch < end; ch++) {
         DeNoiseChannel *dnch = &s->dnch[ch];
         const float *src = (const float *)in->extended_data[ch];
-        double *dst = dnch->out_samples;
-
-        if (s->track_noise) {
-            int i = s->block_count & 0x1FF;
-
-            if (dnch->sfm_fail_flags[i])
-                dnch->sfm_fail_total--;
-            dnch->sfm_fail_flags[i] = 0;
-            dnch->sfm_threshold *= 1.0 - dnch->sfm_alpha;
-            dnch->sfm_threshold += dnch->sfm_alpha * (0.5 + (1.0 / 640) * dnch->sfm_fail_total);
-        }
-
-        for (int m = 0; m < s->window_length; m++) {
-            dnch->fft_data[m].re = s->window[m] * src[m] * (1LL << 24);
-            dnch->fft_data[m].im = 0;
-        }
+        float *dst = (float *)out->extended_data[ch];
 
-        for (int m = s->window_length; m < s->fft_length2; m++) {
-            dnch->fft_data[m].re = 0;
-            dnch->fft_data[m].im = 0;
+        /* run all blocks of a channel back to back, so its state stays in cache */
+        for (int n = 0; n < td->nb_blocks; n++) {
+            filter_block(s, dnch, src + n * s->sample_advance);
+            output_block(s, dnch, src + n * s->sample_advance,
+                         dst + n * s->sample_advance);
         }
-
-        av_fft_permute(dnch->fft, dnch->fft_data);
-        av_fft_calc(dnch->fft, dnch->fft_data);
-
-        preprocess(dnch->fft_data, s->fft_length);
-        process_frame(s, dnch, dnch->fft_data,
-                      dnch->prior,
-                      dnch->prior_band_excit,
-                      s->track_noise);
-        postprocess(dnch->fft_data, s->fft_length);
-
-        av_fft_permute(dnch->ifft, dnch->fft_data);
-        av_fft_calc(dnch->ifft, dnch->fft_data);
-
-        for (int m = 0; m < s->window_length; m++)
-            dst[m] += s->window[m] * dnch->fft_data[m].re / (1LL << 24);
     }
 
     return 0;
@@ -1161,13 +1199,21 @@ static int output_frame(AVFilterLink *inlink)
     AudioFFTDeNoiseContext *s = ctx->priv;
     AVFrame *out = NULL, *in = NULL;
     ThreadData td;
+    int nb_blocks = 1;
     int ret = 0;
 
-    in = ff_get_audio_buffer(outlink, s->window_length);
+    /* Without noise tracking or sampling, nothing is shared between the
+     * channels from one block to the next, so all the blocks available
+     * are filtered in a single pass. */
+    if (!s->track_noise && !s->sample_noise &&
+        !s->sample_noise_start && !s->sample_noise_end)
+        nb_blocks = 1 + (av_audio_fifo_size(s->fifo) - s->window_length) / s->sample_advance;
+
+    in = ff_get_audio_buffer(outlink, s->window_length + (nb_blocks - 1) * s->sample_advance);
     if (!in)
         return AVERROR(ENOMEM);
 
-    ret = av_audio_fifo_peek(s->fifo, (void **)in->extended_data, s->window_length);
+    ret = av_audio_fifo_peek(s->fifo, (void **)in->extended_data, in->nb_samples);
     if (ret < 0)
         goto end;
 
@@ -1215,52 +1261,27 @@ static int output_frame(AVFilterLink *inlink)
         s->sample_noise_end = 0;
     }
 
-    s->block_count++;
-    td.in = in;
-    ctx->internal->execute(ctx, filter_channel, &td, NULL,
-                           FFMIN(outlink->channels, ff_filter_get_nb_threads(ctx)));
-
-    out = ff_get_audio_buffer(outlink, s->sample_advance);
+    out = ff_get_audio_buffer(outlink, nb_blocks * s->sample_advance);
     if (!out) {
         ret = AVERROR(ENOMEM);
         goto end;
     }
 
-    for (int ch = 0; ch < inlink->channels; ch++) {
-        DeNoiseChannel *dnch = &s->dnch[ch];
-        double *src = dnch->out_samples;
-        float *orig = (float *)in->extended_data[ch];
-        float *dst = (float *)out->extended_data[ch];
-
-        switch (s->output_mode) {
-        case IN_MODE:
-            for (int m = 0; m < s->sample_advance; m++)
-                dst[m] = orig[m];
-            break;
-        case OUT_MODE:
-            for (int m = 0; m < s->sample_advance; m++)
-                dst[m] = src[m];
-            break;
-        case NOISE_MODE:
-            for (int m = 0; m < s->sample_advance; m++)
-                dst[m] = orig[m] - src[m];
-            break;
-        default:
-            av_frame_free(&out);
-            ret = AVERROR_BUG;
-            goto end;
-        }
-        memmove(src, src + s->sample_advance, (s->window_length - s->sample_advance) * sizeof(*src));
-        memset(src + (s->window_length - s->sample_advance), 0, s->sample_advance * sizeof(*src));
-    }
+    s->block_count++;
+    td.in = in;
+    td.out = out;
+    td.nb_blocks = nb_blocks;
+    ctx->internal->execute(ctx, filter_channel, &td, NULL,
+                           FFMIN(outlink->channels, ff_filter_get_nb_threads(ctx)));
+    s->block_count += nb_blocks - 1;
 
-    av_audio_fifo_drain(s->fifo, s->sample_advance);
+    av_audio_fifo_drain(s->fifo, out->nb_samples);
 
     out->pts = s->pts;
     ret = ff_filter_frame(outlink, out);
     if (ret < 0)
         goto end;
-    s->pts += s->sample_advance;
+    s->pts += out->nb_samples;
 end:
     av_frame_free(&in);
 
@@ -56,19 +56,35 @@ static void fcmul_add_c(float *sum, const float *t, const float *c, ptrdiff_t le
     sum[2 * n] += t[2 * n] * c[2 * n];
 }
 
+static void fir_partitions(AudioFIRContext *s, AudioFIRSegment *seg, int ch,
+                           int start, int end)
+{
+    const int part_index = seg->part_index[ch];
+    float *sum = (float *)seg->sum->extended_data[ch];
+
+    for (int age = start; age < end; age++) {
+        const int i = (part_index - age + seg->nb_partitions) % seg->nb_partitions;
+        const float *block = (const float *)seg->block->extended_data[ch] + i * seg->block_size;
+        const FFTComplex *coeff = (const FFTComplex *)seg->coeff->extended_data[ch * !s->one2many] + age * seg->coeff_size;
+
+        s->afirdsp.fcmul_add(sum, block, (const float *)coeff, seg->part_size);
+    }
+}
+
 static int fir_quantum(AVFilterContext *ctx, AVFrame *out, int ch, int offset)
 {
     AudioFIRContext *s = ctx->priv;
     const float *in = (const float *)s->in[0]->extended_data[ch] + offset;
     float *block, *buf, *ptr = (float *)out->extended_data[ch] + offset;
     const int nb_samples = FFMIN(s->min_part_size, out->nb_samples - offset);
-    int n, i, j;
+    int n;
 
     for (int segment = 0; segment < s->nb_segments; segment++) {
         AudioFIRSegment *seg = &s->seg[segment];
         float *src = (float *)seg->input->extended_data[ch];
         float *dst = (float *)seg->output->extended_data[ch];
         float *sum = (float *)seg->sum->extended_data[ch];
+        const int nb_quanta = seg->part_size / s->min_part_size;
 
         s->fdsp->vector_fmul_scalar(src + seg->input_offset, in, s->dry_gain, FFALIGN(nb_samples, 4));
         emms_c();
@@ -77,6 +93,15 @@ static int fir_quantum(AVFilterContext *ctx, AVFrame *out, int ch, int offset)
         if (seg->output_offset[ch] == seg->part_size) {
             seg->output_offset[ch] = 0;
         } else {
+            const int quantum = seg->output_offset[ch] / s->min_part_size;
+            const int older = seg->nb_partitions - 1;
+
+            /* Only the newest partition depends on the block still being
+             * buffered, so spread the products with the older partitions
+             * over the quanta in between two transforms. */
+            fir_partitions(s, seg, ch, 1 + (quantum - 1) * older / (nb_quanta - 1),
+                                       1 +  quantum      * older / (nb_quanta - 1));
+
             memmove(src, src + s->min_part_size, (seg->input_size - s->min_part_size) * sizeof(*src));
 
             dst += seg->output_offset[ch];
@@ -86,7 +111,6 @@ static int fir_quantum(AVFilterContext *ctx, AVFrame *out, int ch, int offset)
             continue;
         }
 
-        memset(sum, 0, sizeof(*sum) * seg->fft_length);
         block = (float *)seg->block->extended_data[ch] + seg->part_index[ch] * seg->block_size;
         memset(block + seg->part_size, 0, sizeof(*block) * (seg->fft_length - seg->part_size));
 
@@ -96,19 +120,9 @@ static int fir_quantum(AVFilterContext *ctx, AVFrame *out, int ch, int offset)
         block[2 * seg->part_size] = block[1];
         block[1] = 0;
 
-        j = seg->part_index[ch];
-
-        for (i = 0; i < seg->nb_partitions; i++) {
-            const int coffset = j * seg->coeff_size;
-            const float *block = (const float *)seg->block->extended_data[ch] + i * seg->block_size;
-            const FFTComplex *coeff = (const FFTComplex *)seg->coeff->extended_data[ch * !s->one2many] + coffset;
-
-            s->afirdsp.fcmul_add(sum, block, (const float *)coeff, seg->part_size);
-
-            if (j == 0)
-                j = seg->nb_partitions;
-            j--;
-        }
+        if (nb_quanta == 1)
+            fir_partitions(s, seg, ch, 1, seg->nb_partitions);
+        fir_partitions(s, seg, ch, 0, 1);
 
         sum[1] = sum[2 * seg->part_size];
         av_rdft_calc(seg->irdft[ch], sum);
@@ -123,6 +137,8 @@ static int fir_quantum(AVFilterContext *ctx, AVFrame *out, int ch, int offset)
         buf = (float *)seg->buffer->extended_data[ch];
         memcpy(buf, sum + seg->part_size, seg->part_size * sizeof(*buf));
 
+        memset(sum, 0, sizeof(*sum) * seg->fft_length);
+
         seg->part_index[ch] = (seg->part_index[ch] + 1) % seg->nb_partitions;
 
         memmove(src, src + s->min_part_size, (seg->input_size - s->min_part_size) * sizeof(*src));
@@ -707,29 +707,66 @@ static double process_sample(FoSection *s1, double in)
     return p1;
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
+/* Maximum number of filters of a channel applied in a single pass */
+#define MAX_CASCADE 16
+
+static void filter_cascade(EqualizatorFilter **cascade, int nb_cascade,
+                           double *bptr, int nb_samples)
 {
-    AVFilterContext *ctx = inlink->dst;
-    AudioNEqualizerContext *s = ctx->priv;
-    AVFilterLink *outlink = ctx->outputs[0];
-    double *bptr;
     int i, n;
 
-    for (i = 0; i < s->nb_filters; i++) {
-        EqualizatorFilter *f = &s->filters[i];
-
-        if (f->gain == 0. || f->ignore)
-            continue;
+    for (n = 0; n < nb_samples; n++) {
+        double sample = bptr[n];
 
-        bptr = (double *)buf->extended_data[f->channel];
-        for (n = 0; n < buf->nb_samples; n++) {
-            double sample = bptr[n];
+        for (i = 0; i < nb_cascade; i++)
+            sample = process_sample(cascade[i]->section, sample);
+        bptr[n] = sample;
+    }
+}
 
-            sample  = process_sample(f->section, sample);
-            bptr[n] = sample;
+static int filter_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AudioNEqualizerContext *s = ctx->priv;
+    AVFrame *buf = arg;
+    const int start = (buf->channels * jobnr) / nb_jobs;
+    const int end = (buf->channels * (jobnr+1)) / nb_jobs;
+    int ch, i;
+
+    /* Run the filters of each channel as a cascade, sample by sample,
+     * instead of one pass over the buffer per filter. */
+    for (ch = start; ch < end; ch++) {
+        double *bptr = (double *)buf->extended_data[ch];
+        EqualizatorFilter *cascade[MAX_CASCADE];
+        int nb_cascade = 0;
+
+        for (i = 0; i < s->nb_filters; i++) {
+            EqualizatorFilter *f = &s->filters[i];
+
+            if (f->gain == 0. || f->ignore || f->channel != ch)
+                continue;
+
+            cascade[nb_cascade++] = f;
+            if (nb_cascade == MAX_CASCADE) {
+                filter_cascade(cascade, nb_cascade, bptr, buf->nb_samples);
+                nb_cascade = 0;
+            }
         }
+        if (nb_cascade)
+            filter_cascade(cascade, nb_cascade, bptr, buf->nb_samples);
     }
 
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
+{
+    AVFilterContext *ctx = inlink->dst;
+    AudioNEqualizerContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+
+    ctx->internal->execute(ctx, filter_channels, buf, NULL,
+                           FFMIN(inlink->channels, ff_filter_get_nb_threads(ctx)));
+
     if (s->draw_curves) {
         const int64_t pts = buf->pts +
             av_rescale_q(buf->nb_samples, (AVRational){ 1, inlink->sample_rate },
@@ -766,6 +803,7 @@ AVFilter ff_af_anequalizer = {
     .query_formats = query_formats,
     .inputs        = inputs,
     .outputs       = NULL,
-    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS |
+                     AVFILTER_FLAG_SLICE_THREADS,
     .process_command = process_command,
 };
@@ -408,9 +408,6 @@ static void yae_downmix(ATempoContext *atempo, AudioFragment *frag)
     // shortcuts:
     const uint8_t *src = frag->data;
 
-    // init complex data buffer used for FFT and Correlation:
-    memset(frag->xdat, 0, sizeof(FFTComplex) * atempo->window);
-
     if (atempo->format == AV_SAMPLE_FMT_U8) {
         yae_init_xdat(uint8_t, 127);
     } else if (atempo->format == AV_SAMPLE_FMT_S16) {
@@ -422,6 +419,10 @@ static void yae_downmix(ATempoContext *atempo, AudioFragment *frag)
     } else if (atempo->format == AV_SAMPLE_FMT_DBL) {
         yae_init_xdat(double, 1);
     }
+
+    // zero-pad the complex data buffer used for FFT and Correlation:
+    memset(frag->xdat + frag->nsamples, 0,
+           sizeof(FFTSample) * (2 * atempo->window - frag->nsamples));
 }
 
 /**
@@ -739,28 +740,22 @@ static int yae_adjust_position(ATempoContext *atempo)
         const scalar_type *aaa = (const scalar_type *)a;                \
         const scalar_type *bbb = (const scalar_type *)b;                \
                                                                         \
-        scalar_type *out     = (scalar_type *)dst;                      \
-        scalar_type *out_end = (scalar_type *)dst_end;                  \
+        scalar_type *out = (scalar_type *)dst;                          \
+        const int channels = atempo->channels;                          \
         int64_t i;                                                      \
+        int j;                                                          \
                                                                         \
-        for (i = 0; i < overlap && out < out_end;                       \
-             i++, atempo->position[1]++, wa++, wb++) {                  \
-            float w0 = *wa;                                             \
-            float w1 = *wb;                                             \
-            int j;                                                      \
+        for (i = ncopy; i < nblend; i++) {                              \
+            const float w0 = wa[i];                                     \
+            const float w1 = wb[i];                                     \
                                                                         \
-            for (j = 0; j < atempo->channels;                           \
-                 j++, aaa++, bbb++, out++) {                            \
-                float t0 = (float)*aaa;                                 \
-                float t1 = (float)*bbb;                                 \
+            for (j = 0; j < channels; j++) {                            \
+                const float t0 = (float)aaa[i * channels + j];          \
+                const float t1 = (float)bbb[i * channels + j];          \
                                                                         \
-                *out =                                                  \
-                    frag->position[0] + i < 0 ?                         \
-                    *aaa :                                              \
-                    (scalar_type)(t0 * w0 + t1 * w1);                   \
+                out[i * channels + j] = (scalar_type)(t0 * w0 + t1 * w1); \
             }                                                           \
         }                                                               \
-        dst = (uint8_t *)out;                                           \
     } while (0)
 
 /**
@@ -798,10 +793,18 @@ static int yae_overlap_add(ATempoContext *atempo,
 
     uint8_t *dst = *dst_ref;
 
+    // number of samples that fit in the dst buffer:
+    const int64_t nblend = FFMIN(overlap, (dst_end - dst) / atempo->stride);
+
+    // the samples preceding the start of the stream are not blended:
+    const int64_t ncopy = av_clip64(-frag->position[0], 0, nblend);
+
     av_assert0(start_here <= stop_here &&
                frag->position[1] <= start_here &&
                overlap <= frag->nsamples);
 
+    memcpy(dst, a, ncopy * atempo->stride);
+
     if (atempo->format == AV_SAMPLE_FMT_U8) {
         yae_blend(uint8_t);
     } else if (atempo->format == AV_SAMPLE_FMT_S16) {
@@ -814,6 +817,9 @@ static int yae_overlap_add(ATempoContext *atempo,
         yae_blend(double);
     }
 
+    atempo->position[1] += nblend;
+    dst += nblend * atempo->stride;
+
     // pass-back the updated destination buffer pointer:
     *dst_ref = dst;
 
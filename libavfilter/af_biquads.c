@@ -93,6 +93,11 @@ enum WidthType {
     NB_WTYPE,
 };
 
+/* Number of channels filtered together. The recursions of different
+ * channels are independent, so interleaving a pair of them hides part of
+ * the feedback latency; more lanes run out of registers. */
+#define BIQUAD_LANES 2
+
 typedef struct ChanCache {
     double i1, i2;
     double o1, o2;
@@ -118,9 +123,8 @@ typedef struct BiquadsContext {
     ChanCache *cache;
     int block_align;
 
-    void (*filter)(struct BiquadsContext *s, const void *ibuf, void *obuf, int len,
-                   double *i1, double *i2, double *o1, double *o2,
-                   double b0, double b1, double b2, double a1, double a2, int *clippings);
+    void (*filter)(struct BiquadsContext *s, const void **ibuf, void **obuf, int len,
+                   ChanCache **cache, int nb_lanes);
 } BiquadsContext;
 
 static av_cold int init(AVFilterContext *ctx)
@@ -172,68 +176,77 @@ static int query_formats(AVFilterContext *ctx)
 }
 
 #define BIQUAD_FILTER(name, type, min, max, need_clipping)                    \
-static void biquad_## name (BiquadsContext *s,                                \
-                            const void *input, void *output, int len,         \
-                            double *in1, double *in2,                         \
-                            double *out1, double *out2,                       \
-                            double b0, double b1, double b2,                  \
-                            double a1, double a2, int *clippings)             \
+static av_always_inline void biquad_lanes_## name (BiquadsContext *s,         \
+                                     const void **input, void **output,       \
+                                     int len, ChanCache **cache,              \
+                                     const int nb_lanes)                      \
 {                                                                             \
-    const type *ibuf = input;                                                 \
-    type *obuf = output;                                                      \
-    double i1 = *in1;                                                         \
-    double i2 = *in2;                                                         \
-    double o1 = *out1;                                                        \
-    double o2 = *out2;                                                        \
-    int i;                                                                    \
-    a1 = -a1;                                                                 \
-    a2 = -a2;                                                                 \
+    const double b0 = s->b0, b1 = s->b1, b2 = s->b2;                          \
+    const double a1 = -s->a1, a2 = -s->a2;                                    \
+    const int even_len = len & ~1;                                            \
+    const type *ibuf[BIQUAD_LANES];                                           \
+    type *obuf[BIQUAD_LANES];                                                 \
+    double i1[BIQUAD_LANES], i2[BIQUAD_LANES];                                \
+    double o1[BIQUAD_LANES], o2[BIQUAD_LANES];                                \
+    int clippings[BIQUAD_LANES];                                              \
+    int i, l;                                                                 \
                                                                               \
-    for (i = 0; i+1 < len; i++) {                                             \
-        o2 = i2 * b2 + i1 * b1 + ibuf[i] * b0 + o2 * a2 + o1 * a1;            \
-        i2 = ibuf[i];                                                         \
-        if (need_clipping && o2 < min) {                                      \
-            (*clippings)++;                                                   \
-            obuf[i] = min;                                                    \
-        } else if (need_clipping && o2 > max) {                               \
-            (*clippings)++;                                                   \
-            obuf[i] = max;                                                    \
-        } else {                                                              \
-            obuf[i] = o2;                                                     \
-        }                                                                     \
-        i++;                                                                  \
-        o1 = i1 * b2 + i2 * b1 + ibuf[i] * b0 + o1 * a2 + o2 * a1;            \
-        i1 = ibuf[i];                                                         \
-        if (need_clipping && o1 < min) {                                      \
-            (*clippings)++;                                                   \
-            obuf[i] = min;                                                    \
-        } else if (need_clipping && o1 > max) {                               \
-            (*clippings)++;                                                   \
-            obuf[i] = max;                                                    \
-        } else {                                                              \
-            obuf[i] = o1;                                                     \
-        }                                                                     \
+    for (l = 0; l < nb_lanes; l++) {                                          \
+        ibuf[l] = input[l];                                                   \
+        obuf[l] = output[l];                                                  \
+        i1[l] = cache[l]->i1;                                                 \
+        i2[l] = cache[l]->i2;                                                 \
+        o1[l] = cache[l]->o1;                                                 \
+        o2[l] = cache[l]->o2;                                                 \
+        clippings[l] = 0;                                                     \
     }                                                                         \
-    if (i < len) {                                                            \
-        double o0 = ibuf[i] * b0 + i1 * b1 + i2 * b2 + o1 * a1 + o2 * a2;     \
-        i2 = i1;                                                              \
-        i1 = ibuf[i];                                                         \
-        o2 = o1;                                                              \
-        o1 = o0;                                                              \
-        if (need_clipping && o0 < min) {                                      \
-            (*clippings)++;                                                   \
-            obuf[i] = min;                                                    \
-        } else if (need_clipping && o0 > max) {                               \
-            (*clippings)++;                                                   \
-            obuf[i] = max;                                                    \
-        } else {                                                              \
-            obuf[i] = o0;                                                     \
+                                                                              \
+    for (i = 0; i < len; i++) {                                               \
+        for (l = 0; l < nb_lanes; l++) {                                      \
+            const double in = ibuf[l][i];                                     \
+            double out;                                                       \
+                                                                              \
+            /* the last sample of an odd length buffer has always been        \
+             * summed in this order */                                        \
+            if (i < even_len)                                                 \
+                out = i2[l] * b2 + i1[l] * b1 + in * b0 + o2[l] * a2 + o1[l] * a1;\
+            else                                                              \
+                out = in * b0 + i1[l] * b1 + i2[l] * b2 + o1[l] * a1 + o2[l] * a2;\
+            i2[l] = i1[l];                                                    \
+            i1[l] = in;                                                       \
+            o2[l] = o1[l];                                                    \
+            o1[l] = out;                                                      \
+                                                                              \
+            if (need_clipping && out < min) {                                 \
+                clippings[l]++;                                               \
+                obuf[l][i] = min;                                             \
+            } else if (need_clipping && out > max) {                          \
+                clippings[l]++;                                               \
+                obuf[l][i] = max;                                             \
+            } else {                                                          \
+                obuf[l][i] = out;                                             \
+            }                                                                 \
         }                                                                     \
     }                                                                         \
-    *in1  = i1;                                                               \
-    *in2  = i2;                                                               \
-    *out1 = o1;                                                               \
-    *out2 = o2;                                                               \
+                                                                              \
+    for (l = 0; l < nb_lanes; l++) {                                          \
+        cache[l]->i1 = i1[l];                                                 \
+        cache[l]->i2 = i2[l];                                                 \
+        cache[l]->o1 = o1[l];                                                 \
+        cache[l]->o2 = o2[l];                                                 \
+        cache[l]->clippings += clippings[l];                                  \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static void biquad_## name (BiquadsContext *s,                                \
+                            const void **input, void **output, int len,       \
+                            ChanCache **cache, int nb_lanes)                  \
+{                                                                             \
+    switch (nb_lanes) {                                                       \
+    case 1: biquad_lanes_## name (s, input, output, len, cache, 1); break;    \
+    case 2: biquad_lanes_## name (s, input, output, len, cache, 2); break;    \
+    default: av_assert0(0);                                                   \
+    }                                                                         \
 }
 
 BIQUAD_FILTER(s16, int16_t, INT16_MIN, INT16_MAX, 1)
@@ -430,7 +443,10 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
     BiquadsContext *s = ctx->priv;
     const int start = (buf->channels * jobnr) / nb_jobs;
     const int end = (buf->channels * (jobnr+1)) / nb_jobs;
-    int ch;
+    const void *ibuf[BIQUAD_LANES];
+    void *obuf[BIQUAD_LANES];
+    ChanCache *cache[BIQUAD_LANES];
+    int ch, nb_lanes = 0;
 
     for (ch = start; ch < end; ch++) {
         if (!((av_channel_layout_extract_channel(inlink->channel_layout, ch) & s->channels))) {
@@ -440,10 +456,16 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
             continue;
         }
 
-        s->filter(s, buf->extended_data[ch], out_buf->extended_data[ch], buf->nb_samples,
-                  &s->cache[ch].i1, &s->cache[ch].i2, &s->cache[ch].o1, &s->cache[ch].o2,
-                  s->b0, s->b1, s->b2, s->a1, s->a2, &s->cache[ch].clippings);
+        ibuf[nb_lanes]  = buf->extended_data[ch];
+        obuf[nb_lanes]  = out_buf->extended_data[ch];
+        cache[nb_lanes] = &s->cache[ch];
+        if (++nb_lanes == BIQUAD_LANES) {
+            s->filter(s, ibuf, obuf, buf->nb_samples, cache, nb_lanes);
+            nb_lanes = 0;
+        }
     }
+    if (nb_lanes)
+        s->filter(s, ibuf, obuf, buf->nb_samples, cache, nb_lanes);
 
     return 0;
 }
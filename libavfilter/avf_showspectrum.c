@@ -368,33 +368,30 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
-static int run_channel_fft(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+static void run_fft(ShowSpectrumContext *s, int sample_rate,
+                    FFTContext *fft, FFTContext *ifft,
+                    FFTComplex *fft_data, FFTComplex *fft_scratch,
+                    const float *p)
 {
-    ShowSpectrumContext *s = ctx->priv;
-    AVFilterLink *inlink = ctx->inputs[0];
     const float *window_func_lut = s->window_func_lut;
-    AVFrame *fin = arg;
-    const int ch = jobnr;
     int n;
 
     /* fill FFT input with the number of samples available */
-    const float *p = (float *)fin->extended_data[ch];
-
     for (n = 0; n < s->win_size; n++) {
-        s->fft_data[ch][n].re = p[n] * window_func_lut[n];
-        s->fft_data[ch][n].im = 0;
+        fft_data[n].re = p[n] * window_func_lut[n];
+        fft_data[n].im = 0;
     }
 
     if (s->stop) {
         double theta, phi, psi, a, b, S, c;
-        FFTComplex *g = s->fft_data[ch];
-        FFTComplex *h = s->fft_scratch[ch];
+        FFTComplex *g = fft_data;
+        FFTComplex *h = fft_scratch;
         int L = s->buf_size;
         int N = s->win_size;
         int M = s->win_size / 2;
 
-        phi = 2.0 * M_PI * (s->stop - s->start) / (double)inlink->sample_rate / (M - 1);
-        theta = 2.0 * M_PI * s->start / (double)inlink->sample_rate;
+        phi = 2.0 * M_PI * (s->stop - s->start) / (double)sample_rate / (M - 1);
+        theta = 2.0 * M_PI * s->start / (double)sample_rate;
 
         for (int n = 0; n < M; n++) {
             h[n].re = cos(n * n / 2.0 * phi);
@@ -412,8 +409,8 @@ static int run_channel_fft(AVFilterContext *ctx, void *arg, int jobnr, int nb_jo
         }
 
         for (int n = 0; n < N; n++) {
-            g[n].re = s->fft_data[ch][n].re;
-            g[n].im = s->fft_data[ch][n].im;
+            g[n].re = fft_data[n].re;
+            g[n].im = fft_data[n].im;
         }
 
         for (int n = N; n < L; n++) {
@@ -431,11 +428,11 @@ static int run_channel_fft(AVFilterContext *ctx, void *arg, int jobnr, int nb_jo
             g[n].im = b;
         }
 
-        av_fft_permute(s->fft[ch], h);
-        av_fft_calc(s->fft[ch], h);
+        av_fft_permute(fft, h);
+        av_fft_calc(fft, h);
 
-        av_fft_permute(s->fft[ch], g);
-        av_fft_calc(s->fft[ch], g);
+        av_fft_permute(fft, g);
+        av_fft_calc(fft, g);
 
         for (int n = 0; n < L; n++) {
             c = g[n].re;
@@ -447,8 +444,8 @@ static int run_channel_fft(AVFilterContext *ctx, void *arg, int jobnr, int nb_jo
             g[n].im = b / L;
         }
 
-        av_fft_permute(s->ifft[ch], g);
-        av_fft_calc(s->ifft[ch], g);
+        av_fft_permute(ifft, g);
+        av_fft_calc(ifft, g);
 
         for (int k = 0; k < M; k++) {
             psi = k * k / 2.0 * phi;
@@ -456,14 +453,26 @@ static int run_channel_fft(AVFilterContext *ctx, void *arg, int jobnr, int nb_jo
             S = -sin(psi);
             a = c * g[k].re - S * g[k].im;
             b = S * g[k].re + c * g[k].im;
-            s->fft_data[ch][k].re = a;
-            s->fft_data[ch][k].im = b;
+            fft_data[k].re = a;
+            fft_data[k].im = b;
         }
     } else {
         /* run FFT on each samples set */
-        av_fft_permute(s->fft[ch], s->fft_data[ch]);
-        av_fft_calc(s->fft[ch], s->fft_data[ch]);
+        av_fft_permute(fft, fft_data);
+        av_fft_calc(fft, fft_data);
     }
+}
+
+static int run_channel_fft(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ShowSpectrumContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFrame *fin = arg;
+    const int ch = jobnr;
+
+    run_fft(s, inlink->sample_rate, s->fft[ch], s->stop ? s->ifft[ch] : NULL,
+            s->fft_data[ch], s->fft_scratch[ch],
+            (const float *)fin->extended_data[ch]);
 
     return 0;
 }
@@ -1062,50 +1071,22 @@ static int calc_channel_phases(AVFilterContext *ctx, void *arg, int jobnr, int n
     return 0;
 }
 
-static void acalc_magnitudes(ShowSpectrumContext *s)
-{
-    const double w = s->win_scale * (s->scale == LOG ? s->win_scale : 1);
-    int ch, y, h = s->orientation == VERTICAL ? s->h : s->w;
-    const float f = s->gain * w;
-
-    for (ch = 0; ch < s->nb_display_channels; ch++) {
-        float *magnitudes = s->magnitudes[ch];
-
-        for (y = 0; y < h; y++)
-            magnitudes[y] += MAGNITUDE(y, ch) * f;
-    }
-}
-
-static void scale_magnitudes(ShowSpectrumContext *s, float scale)
-{
-    int ch, y, h = s->orientation == VERTICAL ? s->h : s->w;
-
-    for (ch = 0; ch < s->nb_display_channels; ch++) {
-        float *magnitudes = s->magnitudes[ch];
-
-        for (y = 0; y < h; y++)
-            magnitudes[y] *= scale;
-    }
-}
-
-static void clear_combine_buffer(ShowSpectrumContext *s, int size)
+static void clear_combine_buffer(float *combine_buffer, int size)
 {
     int y;
 
     for (y = 0; y < size; y++) {
-        s->combine_buffer[3 * y    ] = 0;
-        s->combine_buffer[3 * y + 1] = 127.5;
-        s->combine_buffer[3 * y + 2] = 127.5;
+        combine_buffer[3 * y    ] = 0;
+        combine_buffer[3 * y + 1] = 127.5;
+        combine_buffer[3 * y + 2] = 127.5;
     }
 }
 
-static int plot_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+static void plot_channel_data(ShowSpectrumContext *s, int ch,
+                              const float *magnitudes, const float *phases,
+                              float *color_buffer)
 {
-    ShowSpectrumContext *s = ctx->priv;
     const int h = s->orientation == VERTICAL ? s->channel_height : s->channel_width;
-    const int ch = jobnr;
-    float *magnitudes = s->magnitudes[ch];
-    float *phases = s->phases[ch];
     float yf, uf, vf;
     int y;
 
@@ -1115,7 +1096,7 @@ static int plot_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
     /* draw the channel */
     for (y = 0; y < h; y++) {
         int row = (s->mode == COMBINED) ? y : ch * h + y;
-        float *out = &s->color_buffer[ch][3 * row];
+        float *out = &color_buffer[3 * row];
         float a;
 
         switch (s->data) {
@@ -1157,10 +1138,45 @@ static int plot_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 
         pick_color(s, yf, uf, vf, a, out);
     }
+}
+
+static int plot_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ShowSpectrumContext *s = ctx->priv;
+    const int ch = jobnr;
+
+    plot_channel_data(s, ch, s->magnitudes[ch], s->phases[ch], s->color_buffer[ch]);
 
     return 0;
 }
 
+static void copy_column(ShowSpectrumContext *s, AVFrame *outpicref, int outh,
+                        const float *combine_buffer, int xpos)
+{
+    int plane, x, y;
+
+    if (s->orientation == VERTICAL) {
+        for (plane = 0; plane < 3; plane++) {
+            uint8_t *p = outpicref->data[plane] + s->start_x +
+                         (outh - 1 - s->start_y) * outpicref->linesize[plane] +
+                         xpos;
+            for (y = 0; y < s->h; y++) {
+                *p = lrintf(av_clipf(combine_buffer[3 * y + plane], 0, 255));
+                p -= outpicref->linesize[plane];
+            }
+        }
+    } else {
+        for (plane = 0; plane < 3; plane++) {
+            uint8_t *p = outpicref->data[plane] + s->start_x +
+                         (xpos + s->start_y) * outpicref->linesize[plane];
+            for (x = 0; x < s->w; x++) {
+                *p = lrintf(av_clipf(combine_buffer[3 * x + plane], 0, 255));
+                p++;
+            }
+        }
+    }
+}
+
 static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -1171,7 +1187,7 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples)
 
     /* fill a new spectrum column */
     /* initialize buffer for combining to black */
-    clear_combine_buffer(s, z);
+    clear_combine_buffer(s->combine_buffer, z);
 
     ctx->internal->execute(ctx, plot_channel, NULL, NULL, s->nb_display_channels);
 
@@ -1203,15 +1219,6 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples)
             }
             s->xpos = 0;
         }
-        for (plane = 0; plane < 3; plane++) {
-            uint8_t *p = outpicref->data[plane] + s->start_x +
-                         (outlink->h - 1 - s->start_y) * outpicref->linesize[plane] +
-                         s->xpos;
-            for (y = 0; y < s->h; y++) {
-                *p = lrintf(av_clipf(s->combine_buffer[3 * y + plane], 0, 255));
-                p -= outpicref->linesize[plane];
-            }
-        }
     } else {
         if (s->sliding == SCROLL) {
             for (plane = 0; plane < 3; plane++) {
@@ -1232,15 +1239,8 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples)
             }
             s->xpos = 0;
         }
-        for (plane = 0; plane < 3; plane++) {
-            uint8_t *p = outpicref->data[plane] + s->start_x +
-                         (s->xpos + s->start_y) * outpicref->linesize[plane];
-            for (x = 0; x < s->w; x++) {
-                *p = lrintf(av_clipf(s->combine_buffer[3 * x + plane], 0, 255));
-                p++;
-            }
-        }
     }
+    copy_column(s, outpicref, outlink->h, s->combine_buffer, s->xpos);
 
     if (s->sliding != FULLFRAME || s->xpos == 0)
         outpicref->pts = av_rescale_q(insamples->pts, inlink->time_base, outlink->time_base);
@@ -1483,6 +1483,157 @@ static const AVOption showspectrumpic_options[] = {
 
 AVFILTER_DEFINE_CLASS(showspectrumpic);
 
+/* per job buffers, so that columns of the picture can be computed in parallel */
+typedef struct PicSliceContext {
+    FFTContext *fft, *ifft;
+    FFTComplex *fft_data;
+    FFTComplex *fft_scratch;
+    AVFrame *fin;
+    float **magnitudes;
+    float **color_buffer;
+    float *combine_buffer;
+} PicSliceContext;
+
+typedef struct PicThreadData {
+    PicSliceContext *slices;
+    int samples;    ///< number of samples in the fifo
+    int spf;        ///< samples between two consecutive windows
+    int nb_windows; ///< number of windows averaged in a column
+} PicThreadData;
+
+static void free_pic_slices(ShowSpectrumContext *s, PicSliceContext *slices, int nb_slices)
+{
+    int i, ch;
+
+    for (i = 0; i < nb_slices; i++) {
+        PicSliceContext *ps = &slices[i];
+
+        av_fft_end(ps->fft);
+        av_fft_end(ps->ifft);
+        av_freep(&ps->fft_data);
+        av_freep(&ps->fft_scratch);
+        av_frame_free(&ps->fin);
+        for (ch = 0; ch < s->nb_display_channels; ch++) {
+            if (ps->magnitudes)
+                av_freep(&ps->magnitudes[ch]);
+            if (ps->color_buffer)
+                av_freep(&ps->color_buffer[ch]);
+        }
+        av_freep(&ps->magnitudes);
+        av_freep(&ps->color_buffer);
+        av_freep(&ps->combine_buffer);
+    }
+    av_freep(&slices);
+}
+
+static PicSliceContext *alloc_pic_slices(AVFilterContext *ctx, int nb_slices)
+{
+    ShowSpectrumContext *s = ctx->priv;
+    const int h = s->orientation == VERTICAL ? s->h : s->w;
+    PicSliceContext *slices;
+    int i, ch;
+
+    slices = av_calloc(nb_slices, sizeof(*slices));
+    if (!slices)
+        return NULL;
+
+    for (i = 0; i < nb_slices; i++) {
+        PicSliceContext *ps = &slices[i];
+
+        ps->fft = av_fft_init(s->fft_bits + !!s->stop, 0);
+        if (s->stop)
+            ps->ifft = av_fft_init(s->fft_bits + !!s->stop, 1);
+        ps->fft_data       = av_calloc(s->buf_size, sizeof(*ps->fft_data));
+        ps->fft_scratch    = av_calloc(s->buf_size, sizeof(*ps->fft_scratch));
+        ps->fin            = ff_get_audio_buffer(ctx->inputs[0], s->win_size);
+        ps->magnitudes     = av_calloc(s->nb_display_channels, sizeof(*ps->magnitudes));
+        ps->color_buffer   = av_calloc(s->nb_display_channels, sizeof(*ps->color_buffer));
+        ps->combine_buffer = av_calloc(h * 3, sizeof(*ps->combine_buffer));
+        if (!ps->fft || (s->stop && !ps->ifft) || !ps->fft_data ||
+            !ps->fft_scratch || !ps->fin || !ps->magnitudes ||
+            !ps->color_buffer || !ps->combine_buffer)
+            goto fail;
+
+        for (ch = 0; ch < s->nb_display_channels; ch++) {
+            ps->magnitudes[ch]   = av_calloc(h, sizeof(**ps->magnitudes));
+            ps->color_buffer[ch] = av_calloc(h * 3, sizeof(**ps->color_buffer));
+            if (!ps->magnitudes[ch] || !ps->color_buffer[ch])
+                goto fail;
+        }
+    }
+
+    return slices;
+fail:
+    free_pic_slices(s, slices, nb_slices);
+    return NULL;
+}
+
+static int plot_pic_columns(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ShowSpectrumContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFilterLink *outlink = ctx->outputs[0];
+    PicThreadData *td = arg;
+    PicSliceContext *ps = &td->slices[jobnr];
+    const double w = s->win_scale * (s->scale == LOG ? s->win_scale : 1);
+    const float f = s->gain * w;
+    const float scale = 1. / td->nb_windows;
+    const int h = s->orientation == VERTICAL ? s->h : s->w;
+    const int sz = s->orientation == VERTICAL ? s->w : s->h;
+    const int start = (sz * jobnr) / nb_jobs;
+    const int end = (sz * (jobnr+1)) / nb_jobs;
+    int x, y, ch, n;
+
+    for (x = start; x < end; x++) {
+        for (ch = 0; ch < s->nb_display_channels; ch++)
+            memset(ps->magnitudes[ch], 0, h * sizeof(**ps->magnitudes));
+
+        for (n = 0; n < td->nb_windows; n++) {
+            const int offset = (x * td->nb_windows + n) * td->spf;
+            const int size = av_clip(td->samples - offset, 0, s->win_size);
+
+            if (size > 0)
+                av_audio_fifo_peek_at(s->fifo, (void **)ps->fin->extended_data, size, offset);
+
+            for (ch = 0; ch < s->nb_display_channels; ch++) {
+                float *magnitudes = ps->magnitudes[ch];
+
+                if (size < s->win_size)
+                    memset(ps->fin->extended_data[ch] + size * sizeof(float), 0,
+                           (s->win_size - size) * sizeof(float));
+
+                run_fft(s, inlink->sample_rate, ps->fft, ps->ifft,
+                        ps->fft_data, ps->fft_scratch,
+                        (const float *)ps->fin->extended_data[ch]);
+
+                for (y = 0; y < h; y++)
+                    magnitudes[y] += hypot(ps->fft_data[y].re, ps->fft_data[y].im) * f;
+            }
+        }
+
+        clear_combine_buffer(ps->combine_buffer, h);
+
+        for (ch = 0; ch < s->nb_display_channels; ch++) {
+            float *magnitudes = ps->magnitudes[ch];
+
+            for (y = 0; y < h; y++)
+                magnitudes[y] *= scale;
+
+            plot_channel_data(s, ch, magnitudes, s->phases[ch], ps->color_buffer[ch]);
+        }
+
+        for (y = 0; y < h * 3; y++) {
+            for (ch = 0; ch < s->nb_display_channels; ch++) {
+                ps->combine_buffer[y] += ps->color_buffer[ch][y];
+            }
+        }
+
+        copy_column(s, s->outpicref, outlink->h, ps->combine_buffer, x);
+    }
+
+    return 0;
+}
+
 static int showspectrumpic_request_frame(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -1493,53 +1644,30 @@ static int showspectrumpic_request_frame(AVFilterLink *outlink)
     ret = ff_request_frame(inlink);
     samples = av_audio_fifo_size(s->fifo);
     if (ret == AVERROR_EOF && s->outpicref && samples > 0) {
-        int consumed = 0;
-        int x = 0, sz = s->orientation == VERTICAL ? s->w : s->h;
-        int ch, spf, spb;
-        AVFrame *fin;
+        int sz = s->orientation == VERTICAL ? s->w : s->h;
+        int nb_jobs = FFMIN(sz, ff_filter_get_nb_threads(ctx));
+        int spf, spb;
+        PicThreadData td;
 
         spf = s->win_size * (samples / ((s->win_size * sz) * ceil(samples / (float)(s->win_size * sz))));
         spf = FFMAX(1, spf);
 
         spb = (samples / (spf * sz)) * spf;
 
-        fin = ff_get_audio_buffer(inlink, s->win_size);
-        if (!fin)
+        /* The whole input is buffered, and the windows of every column are
+         * at known offsets in it, so the columns are computed in parallel. */
+        td.slices = alloc_pic_slices(ctx, nb_jobs);
+        if (!td.slices)
             return AVERROR(ENOMEM);
+        td.samples    = samples;
+        td.spf        = spf;
+        td.nb_windows = FFMAX(1, spb / spf);
 
-        while (x < sz) {
-            ret = av_audio_fifo_peek(s->fifo, (void **)fin->extended_data, s->win_size);
-            if (ret < 0) {
-                av_frame_free(&fin);
-                return ret;
-            }
-
-            av_audio_fifo_drain(s->fifo, spf);
+        ctx->internal->execute(ctx, plot_pic_columns, &td, NULL, nb_jobs);
 
-            if (ret < s->win_size) {
-                for (ch = 0; ch < s->nb_display_channels; ch++) {
-                    memset(fin->extended_data[ch] + ret * sizeof(float), 0,
-                           (s->win_size - ret) * sizeof(float));
-                }
-            }
-
-            ctx->internal->execute(ctx, run_channel_fft, fin, NULL, s->nb_display_channels);
-            acalc_magnitudes(s);
-
-            consumed += spf;
-            if (consumed >= spb) {
-                int h = s->orientation == VERTICAL ? s->h : s->w;
+        free_pic_slices(s, td.slices, nb_jobs);
+        av_audio_fifo_drain(s->fifo, samples);
 
-                scale_magnitudes(s, 1. / (consumed / spf));
-                plot_spectrum_column(inlink, fin);
-                consumed = 0;
-                x++;
-                for (ch = 0; ch < s->nb_display_channels; ch++)
-                    memset(s->magnitudes[ch], 0, h * sizeof(float));
-            }
-        }
-
-        av_frame_free(&fin);
         s->outpicref->pts = 0;
 
         if (s->legend)
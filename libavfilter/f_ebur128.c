@@ -78,8 +78,8 @@ struct hist_entry {
 };
 
 struct integrator {
-    double *cache[MAX_CHANNELS];    ///< window of filtered samples (N ms)
-    int cache_pos;                  ///< focus on the last added bin in the cache array
+    double *cache[MAX_CHANNELS];    ///< window of the energies of the last 100ms blocks (N ms)
+    int cache_pos;                  ///< focus on the last added block in the cache array
     double sum[MAX_CHANNELS];       ///< sum of the last N ms filtered samples (cache content)
     int filled;                     ///< 1 if the cache is completely filled, 0 otherwise
     double rel_threshold;           ///< relative threshold
@@ -122,15 +122,21 @@ typedef struct EBUR128Context {
     int nb_channels;                ///< number of channels in the input
     double *ch_weighting;           ///< channel weighting mapping
     int sample_count;               ///< sample count used for refresh frequency, reset at refresh
+    int nb_threads;                 ///< number of threads the channels are split across
 
     /* Filter caches.
      * The mult by 3 in the following is for X[i], X[i-1] and X[i-2] */
     double x[MAX_CHANNELS * 3];     ///< 3 input samples cache for each channel
     double y[MAX_CHANNELS * 3];     ///< 3 pre-filter samples cache for each channel
     double z[MAX_CHANNELS * 3];     ///< 3 RLB-filter samples cache for each channel
+    double block_energy[MAX_CHANNELS]; ///< sum of the filtered samples of the current 100ms block
 
+    /* The loudnesses are only evaluated every 100ms, so the integration
+     * windows are kept as rings of 100ms block energies. */
 #define I400_BINS  (48000 * 4 / 10)
 #define I3000_BINS (48000 * 3)
+#define I400_BLOCKS  (I400_BINS  / 4800)
+#define I3000_BLOCKS (I3000_BINS / 4800)
     struct integrator i400;         ///< 400ms integrator, used for Momentary loudness  (M), and Integrated loudness (I)
     struct integrator i3000;        ///<    3s integrator, used for Short term loudness (S), and Loudness Range      (LRA)
 
@@ -141,6 +147,7 @@ typedef struct EBUR128Context {
 
     /* misc */
     int loglevel;                   ///< log level for frame logging
+    int measure_only;               ///< no per-frame output, I and LRA are only computed at the end
     int metadata;                   ///< whether or not to inject loudness results in frames
     int dual_mono;                  ///< whether or not to treat single channel input files as dual-mono
     double pan_law;                 ///< pan law value used to calculate dual-mono measurements
@@ -176,6 +183,7 @@ static const AVOption ebur128_options[] = {
     { "framelog", "force frame logging level", OFFSET(loglevel), AV_OPT_TYPE_INT, {.i64 = -1},   INT_MIN, INT_MAX, A|V|F, "level" },
         { "info",    "information logging level", 0, AV_OPT_TYPE_CONST, {.i64 = AV_LOG_INFO},    INT_MIN, INT_MAX, A|V|F, "level" },
         { "verbose", "verbose logging level",     0, AV_OPT_TYPE_CONST, {.i64 = AV_LOG_VERBOSE}, INT_MIN, INT_MAX, A|V|F, "level" },
+        { "quiet",   "disable frame logging",     0, AV_OPT_TYPE_CONST, {.i64 = AV_LOG_QUIET},   INT_MIN, INT_MAX, A|V|F, "level" },
     { "metadata", "inject metadata in the filtergraph", OFFSET(metadata), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, A|V|F },
     { "peak", "set peak mode", OFFSET(peak_mode), AV_OPT_TYPE_FLAGS, {.i64 = PEAK_MODE_NONE}, 0, INT_MAX, A|F, "mode" },
         { "none",   "disable any peak mode",   0, AV_OPT_TYPE_CONST, {.i64 = PEAK_MODE_NONE},          INT_MIN, INT_MAX, A|F, "mode" },
@@ -414,6 +422,7 @@ static int config_audio_output(AVFilterLink *outlink)
                    AV_CH_SURROUND_DIRECT_LEFT               |AV_CH_SURROUND_DIRECT_RIGHT)
 
     ebur128->nb_channels  = nb_channels;
+    ebur128->nb_threads   = FFMIN(nb_channels, ff_filter_get_nb_threads(ctx));
     ebur128->ch_weighting = av_calloc(nb_channels, sizeof(*ebur128->ch_weighting));
     if (!ebur128->ch_weighting)
         return AVERROR(ENOMEM);
@@ -432,9 +441,9 @@ static int config_audio_output(AVFilterLink *outlink)
         if (!ebur128->ch_weighting[i])
             continue;
 
-        /* bins buffer for the two integration window (400ms and 3s) */
-        ebur128->i400.cache[i]  = av_calloc(I400_BINS,  sizeof(*ebur128->i400.cache[0]));
-        ebur128->i3000.cache[i] = av_calloc(I3000_BINS, sizeof(*ebur128->i3000.cache[0]));
+        /* blocks buffer for the two integration window (400ms and 3s) */
+        ebur128->i400.cache[i]  = av_calloc(I400_BLOCKS,  sizeof(*ebur128->i400.cache[0]));
+        ebur128->i3000.cache[i] = av_calloc(I3000_BLOCKS, sizeof(*ebur128->i3000.cache[0]));
         if (!ebur128->i400.cache[i] || !ebur128->i3000.cache[i])
             return AVERROR(ENOMEM);
     }
@@ -499,13 +508,19 @@ static av_cold int init(AVFilterContext *ctx)
     int ret;
 
     if (ebur128->loglevel != AV_LOG_INFO &&
-        ebur128->loglevel != AV_LOG_VERBOSE) {
+        ebur128->loglevel != AV_LOG_VERBOSE &&
+        ebur128->loglevel != AV_LOG_QUIET) {
         if (ebur128->do_video || ebur128->metadata)
             ebur128->loglevel = AV_LOG_VERBOSE;
         else
             ebur128->loglevel = AV_LOG_INFO;
     }
 
+    /* Without any per-frame output, the integrated loudness and the loudness
+     * range only need to be computed from the histograms once, at the end. */
+    ebur128->measure_only = ebur128->loglevel == AV_LOG_QUIET &&
+                            !ebur128->do_video && !ebur128->metadata;
+
     if (!CONFIG_SWRESAMPLE && (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS)) {
         av_log(ctx, AV_LOG_ERROR,
                "True-peak mode requires libswresample to be performed\n");
@@ -585,108 +600,271 @@ static int gate_update(struct integrator *integ, double power,
     return gate_hist_pos;
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
+/* Integrated loudness */
+#define I_GATE_THRES -10  // initially defined to -8 LU in the first EBU standard
+
+/* compute integrated loudness by summing the histogram values above the
+ * relative threshold */
+static void compute_integrated_loudness(EBUR128Context *ebur128, int gate_hist_pos)
 {
-    int i, ch, idx_insample;
-    AVFilterContext *ctx = inlink->dst;
-    EBUR128Context *ebur128 = ctx->priv;
-    const int nb_channels = ebur128->nb_channels;
-    const int nb_samples  = insamples->nb_samples;
-    const double *samples = (double *)insamples->data[0];
-    AVFrame *pic = ebur128->outpicref;
+    double integrated_sum = 0;
+    int nb_integrated = 0;
+    int i;
 
-#if CONFIG_SWRESAMPLE
-    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
-        const double *swr_samples = ebur128->swr_buf;
-        int ret = swr_convert(ebur128->swr_ctx, (uint8_t**)&ebur128->swr_buf, 19200,
-                              (const uint8_t **)insamples->data, nb_samples);
-        if (ret < 0)
-            return ret;
-        for (ch = 0; ch < nb_channels; ch++)
-            ebur128->true_peaks_per_frame[ch] = 0.0;
-        for (idx_insample = 0; idx_insample < ret; idx_insample++) {
-            for (ch = 0; ch < nb_channels; ch++) {
-                ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch], fabs(*swr_samples));
-                ebur128->true_peaks_per_frame[ch] = FFMAX(ebur128->true_peaks_per_frame[ch],
-                                                          fabs(*swr_samples));
-                swr_samples++;
-            }
+    for (i = gate_hist_pos; i < HIST_SIZE; i++) {
+        const int nb_v = ebur128->i400.histogram[i].count;
+        nb_integrated  += nb_v;
+        integrated_sum += nb_v * ebur128->i400.histogram[i].energy;
+    }
+    if (nb_integrated) {
+        ebur128->integrated_loudness = LOUDNESS(integrated_sum / nb_integrated);
+        /* dual-mono correction */
+        if (ebur128->nb_channels == 1 && ebur128->dual_mono) {
+            ebur128->integrated_loudness -= ebur128->pan_law;
         }
     }
-#endif
+}
 
-    for (idx_insample = 0; idx_insample < nb_samples; idx_insample++) {
-        const int bin_id_400  = ebur128->i400.cache_pos;
-        const int bin_id_3000 = ebur128->i3000.cache_pos;
+/* LRA */
+#define LRA_GATE_THRES -20
+#define LRA_LOWER_PRC   10
+#define LRA_HIGHER_PRC  95
 
-#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
-    ebur128->i##time.cache_pos++;                           \
-    if (ebur128->i##time.cache_pos == I##time##_BINS) {     \
-        ebur128->i##time.filled    = 1;                     \
-        ebur128->i##time.cache_pos = 0;                     \
-    }                                                       \
-} while (0)
+static void compute_loudness_range(EBUR128Context *ebur128, int gate_hist_pos)
+{
+    int i, nb_powers = 0;
+
+    for (i = gate_hist_pos; i < HIST_SIZE; i++)
+        nb_powers += ebur128->i3000.histogram[i].count;
+    if (nb_powers) {
+        int n, nb_pow;
+
+        /* get lower loudness to consider */
+        n = 0;
+        nb_pow = LRA_LOWER_PRC  * nb_powers / 100. + 0.5;
+        for (i = gate_hist_pos; i < HIST_SIZE; i++) {
+            n += ebur128->i3000.histogram[i].count;
+            if (n >= nb_pow) {
+                ebur128->lra_low = ebur128->i3000.histogram[i].loudness;
+                break;
+            }
+        }
 
-        MOVE_TO_NEXT_CACHED_ENTRY(400);
-        MOVE_TO_NEXT_CACHED_ENTRY(3000);
+        /* get higher loudness to consider */
+        n = nb_powers;
+        nb_pow = LRA_HIGHER_PRC * nb_powers / 100. + 0.5;
+        for (i = HIST_SIZE - 1; i >= 0; i--) {
+            n -= ebur128->i3000.histogram[i].count;
+            if (n < nb_pow) {
+                ebur128->lra_high = ebur128->i3000.histogram[i].loudness;
+                break;
+            }
+        }
 
-        for (ch = 0; ch < nb_channels; ch++) {
-            double bin;
+        // XXX: show low & high on the graph?
+        ebur128->loudness_range = ebur128->lra_high - ebur128->lra_low;
+    }
+}
 
-            if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS)
-                ebur128->sample_peaks[ch] = FFMAX(ebur128->sample_peaks[ch], fabs(*samples));
+typedef struct ThreadData {
+    const double *samples;          ///< interleaved samples
+    int nb_samples;
+} ThreadData;
 
-            ebur128->x[ch * 3] = *samples++; // set X[i]
+#define FILTER_LANES 4
 
-            if (!ebur128->ch_weighting[ch])
-                continue;
+/*
+ * Apply the K-weighting to nb_lanes consecutive channels and add their
+ * filtered powers to the current block energies. The filters of different
+ * channels are independent, so running them side by side in lanes hides the
+ * latency of each recursion and lets the compiler use SIMD registers.
+ */
+static av_always_inline void filter_lanes(EBUR128Context *ebur128, const double *samples,
+                                          int nb_samples, int ch0, const int nb_lanes)
+{
+    const int nb_channels = ebur128->nb_channels;
+    double x1[FILTER_LANES], x2[FILTER_LANES];
+    double y1[FILTER_LANES], y2[FILTER_LANES];
+    double z1[FILTER_LANES], z2[FILTER_LANES];
+    double peak[FILTER_LANES], energy[FILTER_LANES];
+    int i, l;
+
+    for (l = 0; l < nb_lanes; l++) {
+        const int ch = ch0 + l;
+
+        x1[l] = ebur128->x[ch * 3 + 1];
+        x2[l] = ebur128->x[ch * 3 + 2];
+        y1[l] = ebur128->y[ch * 3    ];
+        y2[l] = ebur128->y[ch * 3 + 1];
+        z1[l] = ebur128->z[ch * 3    ];
+        z2[l] = ebur128->z[ch * 3 + 1];
+        peak[l]   = 0.0;
+        energy[l] = ebur128->block_energy[ch];
+    }
+
+    for (i = 0; i < nb_samples; i++) {
+        const double *src = samples + i * nb_channels + ch0;
+
+        for (l = 0; l < nb_lanes; l++) {
+            const double x0 = src[l];
+            double y0, z0;
+
+            peak[l] = FFMAX(peak[l], fabs(x0));
 
             /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
-#define FILTER(Y, X, name) do {                                                 \
-            double *dst = ebur128->Y + ch*3;                                    \
-            double *src = ebur128->X + ch*3;                                    \
-            dst[2] = dst[1];                                                    \
-            dst[1] = dst[0];                                                    \
-            dst[0] = src[0]*name##_B0 + src[1]*name##_B1 + src[2]*name##_B2     \
-                                      - dst[1]*name##_A1 - dst[2]*name##_A2;    \
-} while (0)
+            y0 = x0*PRE_B0 + x1[l]*PRE_B1 + x2[l]*PRE_B2 - y1[l]*PRE_A1 - y2[l]*PRE_A2;
+            z0 = y0*RLB_B0 + y1[l]*RLB_B1 + y2[l]*RLB_B2 - z1[l]*RLB_A1 - z2[l]*RLB_A2;
+
+            x2[l] = x1[l];
+            x1[l] = x0;
+            y2[l] = y1[l];
+            y1[l] = y0;
+            z2[l] = z1[l];
+            z1[l] = z0;
+            energy[l] += z0 * z0;
+        }
+    }
 
-            // TODO: merge both filters in one?
-            FILTER(y, x, PRE);  // apply pre-filter
-            ebur128->x[ch * 3 + 2] = ebur128->x[ch * 3 + 1];
-            ebur128->x[ch * 3 + 1] = ebur128->x[ch * 3    ];
-            FILTER(z, y, RLB);  // apply RLB-filter
+    for (l = 0; l < nb_lanes; l++) {
+        const int ch = ch0 + l;
 
-            bin = ebur128->z[ch * 3] * ebur128->z[ch * 3];
+        if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS)
+            ebur128->sample_peaks[ch] = FFMAX(ebur128->sample_peaks[ch], peak[l]);
 
-            /* add the new value, and limit the sum to the cache size (400ms or 3s)
-             * by removing the oldest one */
-            ebur128->i400.sum [ch] = ebur128->i400.sum [ch] + bin - ebur128->i400.cache [ch][bin_id_400];
-            ebur128->i3000.sum[ch] = ebur128->i3000.sum[ch] + bin - ebur128->i3000.cache[ch][bin_id_3000];
+        ebur128->block_energy[ch] = energy[l];
+        ebur128->x[ch * 3    ] = x1[l];
+        ebur128->x[ch * 3 + 1] = x1[l];
+        ebur128->x[ch * 3 + 2] = x2[l];
+        ebur128->y[ch * 3    ] = y1[l];
+        ebur128->y[ch * 3 + 1] = y2[l];
+        ebur128->z[ch * 3    ] = z1[l];
+        ebur128->z[ch * 3 + 1] = z2[l];
+    }
+}
 
-            /* override old cache entry with the new value */
-            ebur128->i400.cache [ch][bin_id_400 ] = bin;
-            ebur128->i3000.cache[ch][bin_id_3000] = bin;
+static int filter_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    EBUR128Context *ebur128 = ctx->priv;
+    ThreadData *td = arg;
+    const int start = (ebur128->nb_channels * jobnr) / nb_jobs;
+    const int end   = (ebur128->nb_channels * (jobnr+1)) / nb_jobs;
+    const int nb_groups = (end - start + FILTER_LANES - 1) / FILTER_LANES;
+    int g;
+
+    /* split the channels of the job in groups of similar sizes, each filtered
+     * by a version of filter_lanes() specialized for its number of lanes */
+    for (g = 0; g < nb_groups; g++) {
+        const int ch0 = start + ((end - start) *  g     ) / nb_groups;
+        const int ch1 = start + ((end - start) * (g + 1)) / nb_groups;
+
+        switch (ch1 - ch0) {
+        case 1: filter_lanes(ebur128, td->samples, td->nb_samples, ch0, 1); break;
+        case 2: filter_lanes(ebur128, td->samples, td->nb_samples, ch0, 2); break;
+        case 3: filter_lanes(ebur128, td->samples, td->nb_samples, ch0, 3); break;
+        case 4: filter_lanes(ebur128, td->samples, td->nb_samples, ch0, 4); break;
         }
+    }
+
+    return 0;
+}
+
+#if CONFIG_SWRESAMPLE
+static int true_peaks_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    EBUR128Context *ebur128 = ctx->priv;
+    ThreadData *td = arg;
+    const int nb_channels = ebur128->nb_channels;
+    const int start = (nb_channels * jobnr) / nb_jobs;
+    const int end   = (nb_channels * (jobnr+1)) / nb_jobs;
+    int i, ch;
+
+    for (ch = start; ch < end; ch++) {
+        const double *swr_samples = td->samples + ch;
+        double peak = 0.0;
+
+        for (i = 0; i < td->nb_samples; i++)
+            peak = FFMAX(peak, fabs(swr_samples[i * nb_channels]));
+        ebur128->true_peaks_per_frame[ch] = peak;
+        ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch], peak);
+    }
+
+    return 0;
+}
+#endif
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
+{
+    int ch, idx_insample;
+    AVFilterContext *ctx = inlink->dst;
+    EBUR128Context *ebur128 = ctx->priv;
+    const int nb_channels = ebur128->nb_channels;
+    const int nb_samples  = insamples->nb_samples;
+    const double *samples = (double *)insamples->data[0];
+    AVFrame *pic = ebur128->outpicref;
+    ThreadData td;
+
+#if CONFIG_SWRESAMPLE
+    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
+        int ret = swr_convert(ebur128->swr_ctx, (uint8_t**)&ebur128->swr_buf, 19200,
+                              (const uint8_t **)insamples->data, nb_samples);
+        if (ret < 0)
+            return ret;
+        td.samples    = ebur128->swr_buf;
+        td.nb_samples = ret;
+        ctx->internal->execute(ctx, true_peaks_channels, &td, NULL, ebur128->nb_threads);
+    }
+#endif
+
+    /* The samples are processed in blocks ending at the next refresh, so that
+     * the channels only need to be synchronized every 100ms. */
+    for (idx_insample = 0; idx_insample < nb_samples; idx_insample += td.nb_samples) {
+        td.samples    = samples + idx_insample * nb_channels;
+        td.nb_samples = FFMIN(nb_samples - idx_insample, 4800 - ebur128->sample_count);
+        ctx->internal->execute(ctx, filter_channels, &td, NULL, ebur128->nb_threads);
 
         /* For integrated loudness, gating blocks are 400ms long with 75%
          * overlap (see BS.1770-2 p5), so a re-computation is needed each 100ms
          * (4800 samples at 48kHz). */
-        if (++ebur128->sample_count == 4800) {
+        ebur128->sample_count += td.nb_samples;
+        if (ebur128->sample_count == 4800) {
             double loudness_400, loudness_3000;
             double power_400 = 1e-12, power_3000 = 1e-12;
             AVFilterLink *outlink = ctx->outputs[0];
             const int64_t pts = insamples->pts +
-                av_rescale_q(idx_insample, (AVRational){ 1, inlink->sample_rate },
+                av_rescale_q(idx_insample + td.nb_samples - 1,
+                             (AVRational){ 1, inlink->sample_rate },
                              outlink->time_base);
 
             ebur128->sample_count = 0;
 
+#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                                        \
+    for (ch = 0; ch < nb_channels; ch++)                                            \
+        if (ebur128->ch_weighting[ch])                                              \
+            ebur128->i##time.cache[ch][ebur128->i##time.cache_pos] =                \
+                ebur128->block_energy[ch];                                          \
+    ebur128->i##time.cache_pos++;                                                   \
+    if (ebur128->i##time.cache_pos == I##time##_BLOCKS) {                           \
+        ebur128->i##time.filled    = 1;                                             \
+        ebur128->i##time.cache_pos = 0;                                             \
+    }                                                                               \
+} while (0)
+
+            MOVE_TO_NEXT_CACHED_ENTRY(400);
+            MOVE_TO_NEXT_CACHED_ENTRY(3000);
+            memset(ebur128->block_energy, 0, sizeof(ebur128->block_energy));
+
 #define COMPUTE_LOUDNESS(m, time) do {                                              \
     if (ebur128->i##time.filled) {                                                  \
         /* weighting sum of the last <time> ms */                                   \
-        for (ch = 0; ch < nb_channels; ch++)                                        \
+        for (ch = 0; ch < nb_channels; ch++) {                                      \
+            int b;                                                                  \
+            if (!ebur128->ch_weighting[ch])                                         \
+                continue;                                                           \
+            ebur128->i##time.sum[ch] = 0;                                           \
+            for (b = 0; b < I##time##_BLOCKS; b++)                                  \
+                ebur128->i##time.sum[ch] += ebur128->i##time.cache[ch][b];          \
             power_##time += ebur128->ch_weighting[ch] * ebur128->i##time.sum[ch];   \
+        }                                                                           \
         power_##time /= I##time##_BINS;                                             \
     }                                                                               \
     loudness_##time = LOUDNESS(power_##time);                                       \
@@ -695,75 +873,24 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
             COMPUTE_LOUDNESS(M,  400);
             COMPUTE_LOUDNESS(S, 3000);
 
-            /* Integrated loudness */
-#define I_GATE_THRES -10  // initially defined to -8 LU in the first EBU standard
-
             if (loudness_400 >= ABS_THRES) {
-                double integrated_sum = 0;
-                int nb_integrated = 0;
                 int gate_hist_pos = gate_update(&ebur128->i400, power_400,
                                                 loudness_400, I_GATE_THRES);
-
-                /* compute integrated loudness by summing the histogram values
-                 * above the relative threshold */
-                for (i = gate_hist_pos; i < HIST_SIZE; i++) {
-                    const int nb_v = ebur128->i400.histogram[i].count;
-                    nb_integrated  += nb_v;
-                    integrated_sum += nb_v * ebur128->i400.histogram[i].energy;
-                }
-                if (nb_integrated) {
-                    ebur128->integrated_loudness = LOUDNESS(integrated_sum / nb_integrated);
-                    /* dual-mono correction */
-                    if (nb_channels == 1 && ebur128->dual_mono) {
-                        ebur128->integrated_loudness -= ebur128->pan_law;
-                    }
-                }
+                if (!ebur128->measure_only)
+                    compute_integrated_loudness(ebur128, gate_hist_pos);
             }
 
-            /* LRA */
-#define LRA_GATE_THRES -20
-#define LRA_LOWER_PRC   10
-#define LRA_HIGHER_PRC  95
-
             /* XXX: example code in EBU 3342 is ">=" but formula in BS.1770
              * specs is ">" */
             if (loudness_3000 >= ABS_THRES) {
-                int nb_powers = 0;
                 int gate_hist_pos = gate_update(&ebur128->i3000, power_3000,
                                                 loudness_3000, LRA_GATE_THRES);
-
-                for (i = gate_hist_pos; i < HIST_SIZE; i++)
-                    nb_powers += ebur128->i3000.histogram[i].count;
-                if (nb_powers) {
-                    int n, nb_pow;
-
-                    /* get lower loudness to consider */
-                    n = 0;
-                    nb_pow = LRA_LOWER_PRC  * nb_powers / 100. + 0.5;
-                    for (i = gate_hist_pos; i < HIST_SIZE; i++) {
-                        n += ebur128->i3000.histogram[i].count;
-                        if (n >= nb_pow) {
-                            ebur128->lra_low = ebur128->i3000.histogram[i].loudness;
-                            break;
-                        }
-                    }
-
-                    /* get higher loudness to consider */
-                    n = nb_powers;
-                    nb_pow = LRA_HIGHER_PRC * nb_powers / 100. + 0.5;
-                    for (i = HIST_SIZE - 1; i >= 0; i--) {
-                        n -= ebur128->i3000.histogram[i].count;
-                        if (n < nb_pow) {
-                            ebur128->lra_high = ebur128->i3000.histogram[i].loudness;
-                            break;
-                        }
-                    }
-
-                    // XXX: show low & high on the graph?
-                    ebur128->loudness_range = ebur128->lra_high - ebur128->lra_low;
-                }
+                if (!ebur128->measure_only)
+                    compute_loudness_range(ebur128, gate_hist_pos);
             }
 
+            if (ebur128->measure_only)
+                continue;
             /* dual-mono correction */
             if (nb_channels == 1 && ebur128->dual_mono) {
                 loudness_400 -= ebur128->pan_law;
@@ -859,6 +986,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
                 SET_META_PEAK(true,   TRUE);
             }
 
+            if (ebur128->loglevel == AV_LOG_QUIET)
+                continue;
+
             if (ebur128->scale == SCALE_TYPE_ABSOLUTE) {
                 av_log(ctx, ebur128->loglevel, "t: %-10s " LOG_FMT,
                        av_ts2timestr(pts, &outlink->time_base),
@@ -937,6 +1067,15 @@ static av_cold void uninit(AVFilterContext *ctx)
     int i;
     EBUR128Context *ebur128 = ctx->priv;
 
+    if (ebur128->measure_only) {
+        if (ebur128->i400.nb_kept_powers)
+            compute_integrated_loudness(ebur128,
+                av_clip(HIST_POS(ebur128->i400.rel_threshold), 0, HIST_SIZE - 1));
+        if (ebur128->i3000.nb_kept_powers)
+            compute_loudness_range(ebur128,
+                av_clip(HIST_POS(ebur128->i3000.rel_threshold), 0, HIST_SIZE - 1));
+    }
+
     /* dual-mono correction */
     if (ebur128->nb_channels == 1 && ebur128->dual_mono) {
         ebur128->i400.rel_threshold -= ebur128->pan_law;
@@ -1015,5 +1154,5 @@ AVFilter ff_af_ebur128 = {
     .inputs        = ebur128_inputs,
     .outputs       = NULL,
     .priv_class    = &ebur128_class,
-    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,837 @@
+/*
+ * Copyright (c) 2002 A'rpi
+ * Copyright (c) 2010 Mark Heath mjpeg0 @ silicontrip dot org
+ * Copyright (c) 2012 Stefano Sabatini
+ * Copyright (C) 2012 Michael Niedermayer <michaelni@gmx.at>
+ * Copyright (c) 2014 Clément Bœsch
+ * Copyright (c) 2014 Dave Rice @dericed
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file
+ * Video quality control filter: computes the signalstats, blackdetect,
+ * freezedetect, cropdetect and idet repeated field metrics in a single
+ * slice-threaded pass over each plane.
+ * The crop detection is derived from vf_cropdetect.c, the other metrics
+ * follow vf_signalstats.c, vf_blackdetect.c, vf_freezedetect.c and
+ * vf_idet.c.
+ */
+
+#include <float.h>
+
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/timestamp.h"
+#include "avfilter.h"
+#include "internal.h"
+
+enum QCMetric {
+    METRIC_SIGNAL,
+    METRIC_SATHUE,
+    METRIC_BLACK,
+    METRIC_FREEZE,
+    METRIC_CROP,
+    METRIC_REPEAT,
+    METRIC_NB
+};
+
+enum RepeatedField {
+    REPEAT_NONE,
+    REPEAT_TOP,
+    REPEAT_BOTTOM,
+};
+
+typedef struct QCSlice {
+    unsigned *hist[3];          ///< Y, U and V histograms
+    unsigned *histsat;
+    unsigned histhue[360];
+    uint64_t *colsum;           ///< luma column sums of the slice, for crop
+    uint64_t dif[3];            ///< absolute difference with the previous frame
+    uint64_t sad[3];            ///< absolute difference with the freeze reference
+    uint64_t field_dif[2];      ///< dif of odd and even lines, for repeat
+    unsigned mask[3];
+} QCSlice;
+
+typedef struct QCStatsContext {
+    const AVClass *class;
+    int metrics;
+
+    double black_min_duration_time;
+    double picture_black_ratio_th;
+    double pixel_black_th;
+    double freeze_noise;
+    int64_t freeze_duration;
+    float crop_limit;
+    int crop_round;
+    int crop_reset_count;
+    int crop_max_outliers;
+    float repeat_threshold;
+
+    int depth;
+    int hsub, vsub;
+    int w, h;
+    int chromaw, chromah;
+    int fs, cfs;
+    unsigned pixel_black_th_i;
+    int crop_limit_i;
+
+    int nb_jobs;
+    QCSlice *slices;
+    unsigned *hist[3], *histsat;
+    uint64_t *rowsum, *colsum;
+
+    AVFrame *prev;              ///< previous input frame
+    AVFrame *reference;         ///< last frame that was not frozen
+    int64_t n;
+    int64_t reference_n;
+    int frozen;
+
+    int64_t black_min_duration;
+    int64_t black_start;
+    int64_t last_pts;
+    int black_started;
+
+    int x1, y1, x2, y2;
+    int crop_frame_nb;
+
+    /* summary */
+    int64_t nb_frames;
+    int nb_black;
+    int64_t black_total;
+    int nb_freeze;
+    int64_t freeze_total;
+    int64_t total_repeats[3];
+    double yavg_total;
+    int crop_x, crop_y, crop_w, crop_h;
+} QCStatsContext;
+
+typedef struct ThreadData {
+    const AVFrame *in;
+    const AVFrame *prev;
+    const AVFrame *ref;
+    int do_dif, do_sad;
+} ThreadData;
+
+#define OFFSET(x) offsetof(QCStatsContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption qcstats_options[] = {
+    { "metrics", "set the metrics to compute", OFFSET(metrics), AV_OPT_TYPE_FLAGS,
+        {.i64=(1<<METRIC_SIGNAL)|(1<<METRIC_BLACK)|(1<<METRIC_FREEZE)|(1<<METRIC_CROP)|(1<<METRIC_REPEAT)}, 0, INT_MAX, FLAGS, "metrics" },
+        { "signal", "plane statistics, as computed by signalstats", 0, AV_OPT_TYPE_CONST, {.i64=1<<METRIC_SIGNAL}, 0, 0, FLAGS, "metrics" },
+        { "sathue", "saturation and hue statistics",                0, AV_OPT_TYPE_CONST, {.i64=1<<METRIC_SATHUE}, 0, 0, FLAGS, "metrics" },
+        { "black",  "black intervals, as detected by blackdetect",  0, AV_OPT_TYPE_CONST, {.i64=1<<METRIC_BLACK},  0, 0, FLAGS, "metrics" },
+        { "freeze", "frozen intervals, as detected by freezedetect",0, AV_OPT_TYPE_CONST, {.i64=1<<METRIC_FREEZE}, 0, 0, FLAGS, "metrics" },
+        { "crop",   "crop area, as detected by cropdetect",         0, AV_OPT_TYPE_CONST, {.i64=1<<METRIC_CROP},   0, 0, FLAGS, "metrics" },
+        { "repeat", "repeated fields, as detected by idet",         0, AV_OPT_TYPE_CONST, {.i64=1<<METRIC_REPEAT}, 0, 0, FLAGS, "metrics" },
+    { "black_d",      "set minimum detected black duration in seconds", OFFSET(black_min_duration_time), AV_OPT_TYPE_DOUBLE, {.dbl=2}, 0, DBL_MAX, FLAGS },
+    { "pic_th",       "set the picture black ratio threshold", OFFSET(picture_black_ratio_th), AV_OPT_TYPE_DOUBLE, {.dbl=.98}, 0, 1, FLAGS },
+    { "pix_th",       "set the pixel black threshold",         OFFSET(pixel_black_th),         AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
+    { "freeze_n",     "set freeze noise tolerance",            OFFSET(freeze_noise),    AV_OPT_TYPE_DOUBLE,   {.dbl=0.001},   0,       1.0, FLAGS },
+    { "freeze_d",     "set minimum freeze duration in seconds",OFFSET(freeze_duration), AV_OPT_TYPE_DURATION, {.i64=2000000}, 0, INT64_MAX, FLAGS },
+    { "crop_limit",   "set the crop black threshold",          OFFSET(crop_limit),        AV_OPT_TYPE_FLOAT, {.dbl=24.0/255}, 0, 65535, FLAGS },
+    { "crop_round",   "set the crop width/height divisor",     OFFSET(crop_round),        AV_OPT_TYPE_INT,   {.i64=16},       0, INT_MAX, FLAGS },
+    { "crop_reset",   "recalculate the crop area after this many frames", OFFSET(crop_reset_count), AV_OPT_TYPE_INT, {.i64=0}, 0, INT_MAX, FLAGS },
+    { "crop_max_outliers", "set the crop outlier count threshold",        OFFSET(crop_max_outliers), AV_OPT_TYPE_INT, {.i64=0}, 0, INT_MAX, FLAGS },
+    { "rep_thres",    "set the repeated field threshold",      OFFSET(repeat_threshold),  AV_OPT_TYPE_FLOAT, {.dbl=3.0},     -1, FLT_MAX, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(qcstats);
+
+static const enum AVPixelFormat yuvj_formats[] = {
+    AV_PIX_FMT_YUVJ411P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P,
+    AV_PIX_FMT_YUVJ444P, AV_PIX_FMT_YUVJ440P, AV_PIX_FMT_NONE
+};
+
+static int query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV411P,
+        AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUV410P,
+        AV_PIX_FMT_YUVJ422P, AV_PIX_FMT_YUVJ444P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ411P,
+        AV_PIX_FMT_YUVJ440P,
+        AV_PIX_FMT_YUV444P9, AV_PIX_FMT_YUV422P9, AV_PIX_FMT_YUV420P9,
+        AV_PIX_FMT_YUV444P10, AV_PIX_FMT_YUV422P10, AV_PIX_FMT_YUV420P10,
+        AV_PIX_FMT_YUV440P10,
+        AV_PIX_FMT_YUV444P12, AV_PIX_FMT_YUV422P12, AV_PIX_FMT_YUV420P12,
+        AV_PIX_FMT_YUV440P12,
+        AV_PIX_FMT_YUV444P14, AV_PIX_FMT_YUV422P14, AV_PIX_FMT_YUV420P14,
+        AV_PIX_FMT_YUV444P16, AV_PIX_FMT_YUV422P16, AV_PIX_FMT_YUV420P16,
+        AV_PIX_FMT_NONE
+    };
+
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static void free_slices(QCStatsContext *s)
+{
+    int i, p;
+
+    if (!s->slices)
+        return;
+    for (i = 0; i < s->nb_jobs; i++) {
+        for (p = 0; p < 3; p++)
+            av_freep(&s->slices[i].hist[p]);
+        av_freep(&s->slices[i].histsat);
+        av_freep(&s->slices[i].colsum);
+    }
+    av_freep(&s->slices);
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    QCStatsContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    const int hist_size = 1 << desc->comp[0].depth;
+    int i, p;
+
+    s->depth   = desc->comp[0].depth;
+    s->hsub    = desc->log2_chroma_w;
+    s->vsub    = desc->log2_chroma_h;
+    s->w       = inlink->w;
+    s->h       = inlink->h;
+    s->chromaw = AV_CEIL_RSHIFT(inlink->w, s->hsub);
+    s->chromah = AV_CEIL_RSHIFT(inlink->h, s->vsub);
+    s->fs      = s->w * s->h;
+    s->cfs     = s->chromaw * s->chromah;
+
+    s->black_min_duration = s->black_min_duration_time / av_q2d(inlink->time_base);
+    // luminance_minimum_value + pixel_black_th * luminance_range_size
+    s->pixel_black_th_i = ff_fmt_is_in(inlink->format, yuvj_formats) ?
+                          s->pixel_black_th * ((1 << s->depth) - 1) :
+                          (16 << (s->depth - 8)) + s->pixel_black_th * (219 << (s->depth - 8));
+
+    s->crop_limit_i = lrint(s->crop_limit < 1.0 ? s->crop_limit * ((1 << s->depth) - 1)
+                                                : s->crop_limit);
+    if (s->crop_round <= 1)
+        s->crop_round = 16;
+    if (s->crop_round % 2)
+        s->crop_round *= 2;
+    s->x1 = s->w - 1;
+    s->y1 = s->h - 1;
+    s->x2 = 0;
+    s->y2 = 0;
+    s->crop_frame_nb = -2;
+
+    free_slices(s);
+    s->nb_jobs = FFMAX(1, FFMIN(s->chromah, ff_filter_get_nb_threads(ctx)));
+    s->slices  = av_calloc(s->nb_jobs, sizeof(*s->slices));
+    if (!s->slices)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_jobs; i++) {
+        QCSlice *sl = &s->slices[i];
+
+        for (p = 0; p < 3; p++) {
+            sl->hist[p] = av_malloc_array(hist_size, sizeof(*sl->hist[p]));
+            if (!sl->hist[p])
+                return AVERROR(ENOMEM);
+        }
+        sl->histsat = av_malloc_array(hist_size, sizeof(*sl->histsat));
+        sl->colsum  = av_malloc_array(s->w, sizeof(*sl->colsum));
+        if (!sl->histsat || !sl->colsum)
+            return AVERROR(ENOMEM);
+    }
+
+    for (p = 0; p < 3; p++) {
+        av_freep(&s->hist[p]);
+        s->hist[p] = av_malloc_array(hist_size, sizeof(*s->hist[p]));
+        if (!s->hist[p])
+            return AVERROR(ENOMEM);
+    }
+    av_freep(&s->histsat);
+    av_freep(&s->rowsum);
+    av_freep(&s->colsum);
+    s->histsat = av_malloc_array(hist_size, sizeof(*s->histsat));
+    s->rowsum  = av_malloc_array(s->h, sizeof(*s->rowsum));
+    s->colsum  = av_malloc_array(s->w, sizeof(*s->colsum));
+    if (!s->histsat || !s->rowsum || !s->colsum)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+#define RD(ptr, x) (is16 ? ((const uint16_t *)(ptr))[x] : (ptr)[x])
+
+/**
+ * Accumulate everything the enabled metrics need from one line of a plane.
+ * Returns the absolute difference of the line with the previous frame.
+ */
+static av_always_inline uint64_t analyze_line(const uint8_t *src, const uint8_t *prv,
+                                              const uint8_t *ref, int w,
+                                              unsigned *hist, unsigned *mask,
+                                              uint64_t *sad, uint64_t *colsum,
+                                              uint64_t *rowsum, int is16)
+{
+    uint64_t dif = 0, sum = 0, rsad = 0;
+    unsigned m = 0;
+    int x;
+
+    for (x = 0; x < w; x++) {
+        const int v = RD(src, x);
+
+        hist[v]++;
+        m |= v;
+        if (prv)
+            dif += FFABS(v - (int)RD(prv, x));
+        if (ref)
+            rsad += FFABS(v - (int)RD(ref, x));
+        if (colsum) {
+            colsum[x] += v;
+            sum += v;
+        }
+    }
+
+    *mask |= m;
+    *sad  += rsad;
+    if (rowsum)
+        *rowsum = sum;
+    return dif;
+}
+
+static av_always_inline void analyze_sathue(const uint8_t *src_u, const uint8_t *src_v,
+                                            int w, int mid, unsigned *histsat,
+                                            unsigned *histhue, int is16)
+{
+    int x;
+
+    for (x = 0; x < w; x++) {
+        const int u = RD(src_u, x);
+        const int v = RD(src_v, x);
+        int hue = floor((180 / M_PI) * atan2f(u - mid, v - mid) + 180);
+
+        histsat[(int)hypot(u - mid, v - mid)]++;
+        histhue[hue >= 360 ? hue - 360 : hue]++;
+    }
+}
+
+static av_always_inline void analyze_slice(AVFilterContext *ctx, void *arg,
+                                           int jobnr, int nb_jobs, int is16)
+{
+    QCStatsContext *s = ctx->priv;
+    ThreadData *td = arg;
+    QCSlice *sl = &s->slices[jobnr];
+    const AVFrame *in = td->in;
+    const int hist_size = 1 << s->depth;
+    const int do_crop   = s->crop_frame_nb > 0 && (s->metrics & (1 << METRIC_CROP));
+    const int do_sathue = s->metrics & (1 << METRIC_SATHUE);
+    const int do_repeat = s->metrics & (1 << METRIC_REPEAT);
+    const int slice_start  = (s->h *  jobnr     ) / nb_jobs;
+    const int slice_end    = (s->h * (jobnr + 1)) / nb_jobs;
+    const int cslice_start = (s->chromah *  jobnr     ) / nb_jobs;
+    const int cslice_end   = (s->chromah * (jobnr + 1)) / nb_jobs;
+    int p, y;
+
+    for (p = 0; p < 3; p++) {
+        memset(sl->hist[p], 0, hist_size * sizeof(*sl->hist[p]));
+        sl->dif[p] = sl->sad[p] = 0;
+        sl->mask[p] = 0;
+    }
+    if (do_sathue) {
+        memset(sl->histsat, 0, hist_size * sizeof(*sl->histsat));
+        memset(sl->histhue, 0, sizeof(sl->histhue));
+    }
+    if (do_crop)
+        memset(sl->colsum, 0, s->w * sizeof(*sl->colsum));
+    sl->field_dif[0] = sl->field_dif[1] = 0;
+
+    for (y = slice_start; y < slice_end; y++) {
+        const uint8_t *src = in->data[0] + y * in->linesize[0];
+        const uint8_t *prv = td->do_dif ? td->prev->data[0] + y * td->prev->linesize[0] : NULL;
+        const uint8_t *ref = td->do_sad ? td->ref ->data[0] + y * td->ref ->linesize[0] : NULL;
+        const uint64_t dif = analyze_line(src, prv, ref, s->w, sl->hist[0], &sl->mask[0],
+                                          &sl->sad[0], do_crop ? sl->colsum : NULL,
+                                          do_crop ? &s->rowsum[y] : NULL, is16);
+
+        sl->dif[0] += dif;
+        if (do_repeat && y >= 2 && y < s->h - 2)
+            sl->field_dif[(y ^ 1) & 1] += dif;
+    }
+
+    for (y = cslice_start; y < cslice_end; y++) {
+        for (p = 1; p < 3; p++) {
+            const uint8_t *src = in->data[p] + y * in->linesize[p];
+            const uint8_t *prv = td->do_dif ? td->prev->data[p] + y * td->prev->linesize[p] : NULL;
+            const uint8_t *ref = td->do_sad ? td->ref ->data[p] + y * td->ref ->linesize[p] : NULL;
+            const uint64_t dif = analyze_line(src, prv, ref, s->chromaw, sl->hist[p], &sl->mask[p],
+                                              &sl->sad[p], NULL, NULL, is16);
+
+            sl->dif[p] += dif;
+            if (do_repeat && y >= 2 && y < s->chromah - 2)
+                sl->field_dif[(y ^ 1) & 1] += dif;
+        }
+        if (do_sathue)
+            analyze_sathue(in->data[1] + y * in->linesize[1],
+                           in->data[2] + y * in->linesize[2],
+                           s->chromaw, 1 << (s->depth - 1),
+                           sl->histsat, sl->histhue, is16);
+    }
+}
+
+static int analyze_slice8(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    analyze_slice(ctx, arg, jobnr, nb_jobs, 0);
+    return 0;
+}
+
+static int analyze_slice16(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    analyze_slice(ctx, arg, jobnr, nb_jobs, 1);
+    return 0;
+}
+
+static void plane_stats(const unsigned *hist, int size, int count,
+                        int *min, int *low, uint64_t *tot, int *high, int *max)
+{
+    const int lowp  = lrint(count * 10 / 100.);
+    const int highp = lrint(count * 90 / 100.);
+    int i, acc = 0;
+
+    *min = *low = *high = *max = -1;
+    *tot = 0;
+    for (i = 0; i < size; i++) {
+        if (!hist[i])
+            continue;
+        if (*min < 0)
+            *min = i;
+        *max  = i;
+        *tot += (uint64_t)hist[i] * i;
+        acc  += hist[i];
+        if (*low  == -1 && acc >= lowp)
+            *low  = i;
+        if (*high == -1 && acc >= highp)
+            *high = i;
+    }
+}
+
+static int crop_find(const uint64_t *sums, int div, int limit, int max_outliers,
+                     int from, int to, int inc, int dst)
+{
+    int y, last_y, outliers = 0;
+
+    for (last_y = y = from; inc > 0 ? y < to : y > to; y += inc) {
+        if (sums[y] / div > limit) {
+            if (++outliers > max_outliers)
+                return last_y;
+        } else
+            last_y = y + inc;
+    }
+    return dst;
+}
+
+static void check_black_end(AVFilterContext *ctx, int64_t black_end)
+{
+    QCStatsContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+
+    if (black_end - s->black_start >= s->black_min_duration) {
+        av_log(ctx, AV_LOG_INFO,
+               "black_start:%s black_end:%s black_duration:%s\n",
+               av_ts2timestr(s->black_start, &inlink->time_base),
+               av_ts2timestr(black_end,      &inlink->time_base),
+               av_ts2timestr(black_end - s->black_start, &inlink->time_base));
+        s->nb_black++;
+        s->black_total += black_end - s->black_start;
+    }
+}
+
+static int set_meta(AVFilterContext *ctx, AVFrame *frame, const char *key, const char *value)
+{
+    av_log(ctx, AV_LOG_INFO, "%s: %s\n", key, value);
+    return av_dict_set(&frame->metadata, key, value, 0);
+}
+
+static void detect_black(AVFilterContext *ctx, AVFrame *frame)
+{
+    QCStatsContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    const unsigned *histy = s->hist[0];
+    const int th = FFMIN(s->pixel_black_th_i, (1 << s->depth) - 1);
+    uint64_t nb_black_pixels = 0;
+    double picture_black_ratio;
+    char metabuf[128];
+    int i;
+
+    for (i = 0; i <= th; i++)
+        nb_black_pixels += histy[i];
+    picture_black_ratio = (double)nb_black_pixels / s->fs;
+
+    snprintf(metabuf, sizeof(metabuf), "%g", picture_black_ratio);
+    av_dict_set(&frame->metadata, "lavfi.qcstats.BLACK", metabuf, 0);
+
+    if (picture_black_ratio >= s->picture_black_ratio_th) {
+        if (!s->black_started) {
+            s->black_started = 1;
+            s->black_start = frame->pts;
+            av_dict_set(&frame->metadata, "lavfi.qcstats.black_start",
+                        av_ts2timestr(s->black_start, &inlink->time_base), 0);
+        }
+    } else if (s->black_started) {
+        s->black_started = 0;
+        check_black_end(ctx, frame->pts);
+        av_dict_set(&frame->metadata, "lavfi.qcstats.black_end",
+                    av_ts2timestr(frame->pts, &inlink->time_base), 0);
+    }
+}
+
+static int detect_freeze(AVFilterContext *ctx, AVFrame *frame, uint64_t sad)
+{
+    QCStatsContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    const double mafd = (double)sad / (s->fs + 2 * s->cfs) / (1ULL << s->depth);
+    int frozen = mafd <= s->freeze_noise;
+    int64_t duration;
+    char metabuf[128];
+
+    snprintf(metabuf, sizeof(metabuf), "%g", mafd);
+    av_dict_set(&frame->metadata, "lavfi.qcstats.MAFD", metabuf, 0);
+
+    if (s->reference->pts == AV_NOPTS_VALUE || frame->pts == AV_NOPTS_VALUE || frame->pts < s->reference->pts) // Discontinuity?
+        duration = inlink->frame_rate.num > 0 ? av_rescale_q(s->n - s->reference_n, av_inv_q(inlink->frame_rate), AV_TIME_BASE_Q) : 0;
+    else
+        duration = av_rescale_q(frame->pts - s->reference->pts, inlink->time_base, AV_TIME_BASE_Q);
+
+    if (duration >= s->freeze_duration) {
+        if (frozen) {
+            if (!s->frozen)
+                set_meta(ctx, frame, "lavfi.qcstats.freeze_start", av_ts2timestr(s->reference->pts, &inlink->time_base));
+        } else {
+            set_meta(ctx, frame, "lavfi.qcstats.freeze_duration", av_ts2timestr(duration, &AV_TIME_BASE_Q));
+            set_meta(ctx, frame, "lavfi.qcstats.freeze_end", av_ts2timestr(frame->pts, &inlink->time_base));
+            s->nb_freeze++;
+            s->freeze_total += duration;
+        }
+        s->frozen = frozen;
+    }
+
+    return frozen;
+}
+
+static void detect_crop(AVFilterContext *ctx, AVFrame *frame)
+{
+    QCStatsContext *s = ctx->priv;
+    AVDictionary **metadata = &frame->metadata;
+    int w, h, x, y, i, j, shrink_by;
+
+    // Reset the crop area every reset_count frames, if reset_count is > 0
+    if (s->crop_reset_count > 0 && s->crop_frame_nb > s->crop_reset_count) {
+        s->x1 = s->w - 1;
+        s->y1 = s->h - 1;
+        s->x2 = 0;
+        s->y2 = 0;
+        s->crop_frame_nb = 1;
+    }
+
+    memcpy(s->colsum, s->slices[0].colsum, s->w * sizeof(*s->colsum));
+    for (j = 1; j < s->nb_jobs; j++)
+        for (i = 0; i < s->w; i++)
+            s->colsum[i] += s->slices[j].colsum[i];
+
+    s->y1 = crop_find(s->rowsum, s->w, s->crop_limit_i, s->crop_max_outliers,
+                      0, s->y1, +1, s->y1);
+    s->y2 = crop_find(s->rowsum, s->w, s->crop_limit_i, s->crop_max_outliers,
+                      s->h - 1, FFMAX(s->y2, s->y1), -1, s->y2);
+    s->x1 = crop_find(s->colsum, s->h, s->crop_limit_i, s->crop_max_outliers,
+                      0, s->x1, +1, s->x1);
+    s->x2 = crop_find(s->colsum, s->h, s->crop_limit_i, s->crop_max_outliers,
+                      s->w - 1, FFMAX(s->x2, s->x1), -1, s->x2);
+
+    // round x and y (up), important for yuv colorspaces
+    x = (s->x1 + 1) & ~1;
+    y = (s->y1 + 1) & ~1;
+    w = s->x2 - x + 1;
+    h = s->y2 - y + 1;
+
+    shrink_by = w % s->crop_round;
+    w -= shrink_by;
+    x += (shrink_by / 2 + 1) & ~1;
+
+    shrink_by = h % s->crop_round;
+    h -= shrink_by;
+    y += (shrink_by / 2 + 1) & ~1;
+
+    av_dict_set_int(metadata, "lavfi.qcstats.crop_x1", s->x1, 0);
+    av_dict_set_int(metadata, "lavfi.qcstats.crop_x2", s->x2, 0);
+    av_dict_set_int(metadata, "lavfi.qcstats.crop_y1", s->y1, 0);
+    av_dict_set_int(metadata, "lavfi.qcstats.crop_y2", s->y2, 0);
+    av_dict_set_int(metadata, "lavfi.qcstats.crop_w",  w, 0);
+    av_dict_set_int(metadata, "lavfi.qcstats.crop_h",  h, 0);
+    av_dict_set_int(metadata, "lavfi.qcstats.crop_x",  x, 0);
+    av_dict_set_int(metadata, "lavfi.qcstats.crop_y",  y, 0);
+
+    s->crop_w = w;
+    s->crop_h = h;
+    s->crop_x = x;
+    s->crop_y = y;
+}
+
+static const char *rep2str(enum RepeatedField repeated_field)
+{
+    switch (repeated_field) {
+    case REPEAT_NONE   : return "neither";
+    case REPEAT_TOP    : return "top";
+    case REPEAT_BOTTOM : return "bottom";
+    }
+    return NULL;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    QCStatsContext *s = ctx->priv;
+    const int hist_size = 1 << s->depth;
+    const int do_signal = s->metrics & (1 << METRIC_SIGNAL);
+    const int do_sathue = s->metrics & (1 << METRIC_SATHUE);
+    const int do_freeze = s->metrics & (1 << METRIC_FREEZE) && s->reference;
+    const int do_repeat = s->metrics & (1 << METRIC_REPEAT);
+    uint64_t dif[3] = { 0 }, sad[3] = { 0 }, field_dif[2] = { 0 };
+    unsigned mask[3] = { 0 };
+    char metabuf[128];
+    ThreadData td;
+    int i, j, p;
+
+    if (!s->prev && !(s->prev = av_frame_clone(in))) {
+        av_frame_free(&in);
+        return AVERROR(ENOMEM);
+    }
+    s->n++;
+    s->crop_frame_nb++;
+
+    // the reference is the previous frame unless the picture is frozen,
+    // in which case the difference with the previous frame is reused
+    td.in     = in;
+    td.prev   = s->prev;
+    td.ref    = s->reference;
+    td.do_sad = do_freeze && s->reference->data[0] != s->prev->data[0];
+    td.do_dif = do_signal || do_repeat || (do_freeze && !td.do_sad);
+
+    ctx->internal->execute(ctx, s->depth > 8 ? analyze_slice16 : analyze_slice8,
+                           &td, NULL, s->nb_jobs);
+
+    for (p = 0; p < 3; p++) {
+        memcpy(s->hist[p], s->slices[0].hist[p], hist_size * sizeof(*s->hist[p]));
+        for (j = 0; j < s->nb_jobs; j++) {
+            const QCSlice *sl = &s->slices[j];
+
+            if (j)
+                for (i = 0; i < hist_size; i++)
+                    s->hist[p][i] += sl->hist[p][i];
+            dif[p]  += sl->dif[p];
+            sad[p]  += sl->sad[p];
+            mask[p] |= sl->mask[p];
+        }
+    }
+    for (j = 0; j < s->nb_jobs; j++) {
+        field_dif[0] += s->slices[j].field_dif[0];
+        field_dif[1] += s->slices[j].field_dif[1];
+    }
+
+#define SET_META(key, fmt, val) do {                                    \
+    snprintf(metabuf, sizeof(metabuf), fmt, val);                       \
+    av_dict_set(&in->metadata, "lavfi.qcstats." key, metabuf, 0);       \
+} while (0)
+
+    if (do_signal) {
+        static const char *const names[3][5] = {
+            { "lavfi.qcstats.YMIN", "lavfi.qcstats.YLOW", "lavfi.qcstats.YAVG", "lavfi.qcstats.YHIGH", "lavfi.qcstats.YMAX" },
+            { "lavfi.qcstats.UMIN", "lavfi.qcstats.ULOW", "lavfi.qcstats.UAVG", "lavfi.qcstats.UHIGH", "lavfi.qcstats.UMAX" },
+            { "lavfi.qcstats.VMIN", "lavfi.qcstats.VLOW", "lavfi.qcstats.VAVG", "lavfi.qcstats.VHIGH", "lavfi.qcstats.VMAX" },
+        };
+
+        for (p = 0; p < 3; p++) {
+            const int count = p ? s->cfs : s->fs;
+            int min, low, high, max;
+            uint64_t tot;
+
+            plane_stats(s->hist[p], hist_size, count, &min, &low, &tot, &high, &max);
+            av_dict_set_int(&in->metadata, names[p][0], min, 0);
+            av_dict_set_int(&in->metadata, names[p][1], low, 0);
+            snprintf(metabuf, sizeof(metabuf), "%g", 1.0 * tot / count);
+            av_dict_set(&in->metadata, names[p][2], metabuf, 0);
+            av_dict_set_int(&in->metadata, names[p][3], high, 0);
+            av_dict_set_int(&in->metadata, names[p][4], max, 0);
+            if (!p)
+                s->yavg_total += 1.0 * tot / count;
+        }
+
+        SET_META("YDIF",      "%g", 1.0 * dif[0] / s->fs);
+        SET_META("UDIF",      "%g", 1.0 * dif[1] / s->cfs);
+        SET_META("VDIF",      "%g", 1.0 * dif[2] / s->cfs);
+        SET_META("YBITDEPTH", "%d", av_popcount(mask[0]));
+        SET_META("UBITDEPTH", "%d", av_popcount(mask[1]));
+        SET_META("VBITDEPTH", "%d", av_popcount(mask[2]));
+    }
+
+    if (do_sathue) {
+        unsigned histhue[360];
+        int min, low, high, max, medhue = -1, acchue = 0;
+        uint64_t tot, tothue = 0;
+
+        memcpy(s->histsat, s->slices[0].histsat, hist_size * sizeof(*s->histsat));
+        memcpy(histhue, s->slices[0].histhue, sizeof(histhue));
+        for (j = 1; j < s->nb_jobs; j++) {
+            for (i = 0; i < hist_size; i++)
+                s->histsat[i] += s->slices[j].histsat[i];
+            for (i = 0; i < 360; i++)
+                histhue[i] += s->slices[j].histhue[i];
+        }
+
+        plane_stats(s->histsat, hist_size, s->cfs, &min, &low, &tot, &high, &max);
+        for (i = 0; i < 360; i++) {
+            tothue += (uint64_t)histhue[i] * i;
+            acchue += histhue[i];
+            if (medhue == -1 && acchue > s->cfs / 2)
+                medhue = i;
+        }
+
+        SET_META("SATMIN",  "%d", min);
+        SET_META("SATLOW",  "%d", low);
+        SET_META("SATAVG",  "%g", 1.0 * tot / s->cfs);
+        SET_META("SATHIGH", "%d", high);
+        SET_META("SATMAX",  "%d", max);
+        SET_META("HUEMED",  "%d", medhue);
+        SET_META("HUEAVG",  "%g", 1.0 * tothue / s->cfs);
+    }
+
+    if (s->metrics & (1 << METRIC_BLACK))
+        detect_black(ctx, in);
+
+    if (s->metrics & (1 << METRIC_CROP) && s->crop_frame_nb > 0)
+        detect_crop(ctx, in);
+
+    if (do_repeat) {
+        enum RepeatedField repeat = REPEAT_NONE;
+
+        if (field_dif[0] > s->repeat_threshold * field_dif[1])
+            repeat = REPEAT_TOP;
+        else if (field_dif[1] > s->repeat_threshold * field_dif[0])
+            repeat = REPEAT_BOTTOM;
+        s->total_repeats[repeat]++;
+        av_dict_set(&in->metadata, "lavfi.qcstats.repeated", rep2str(repeat), 0);
+    }
+
+    if (s->metrics & (1 << METRIC_FREEZE)) {
+        int frozen = 0;
+
+        if (s->reference)
+            frozen = detect_freeze(ctx, in, td.do_sad ? sad[0] + sad[1] + sad[2]
+                                                      : dif[0] + dif[1] + dif[2]);
+        if (!frozen) {
+            av_frame_free(&s->reference);
+            s->reference_n = s->n;
+            if (!(s->reference = av_frame_clone(in))) {
+                av_frame_free(&in);
+                return AVERROR(ENOMEM);
+            }
+        }
+    }
+
+    av_frame_free(&s->prev);
+    if (!(s->prev = av_frame_clone(in))) {
+        av_frame_free(&in);
+        return AVERROR(ENOMEM);
+    }
+
+    s->last_pts = in->pts;
+    s->nb_frames++;
+    return ff_filter_frame(ctx->outputs[0], in);
+}
+
+static int request_frame(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    QCStatsContext *s = ctx->priv;
+    int ret = ff_request_frame(ctx->inputs[0]);
+
+    if (ret == AVERROR_EOF && s->black_started) {
+        s->black_started = 0;
+        check_black_end(ctx, s->last_pts);
+    }
+    return ret;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    QCStatsContext *s = ctx->priv;
+    AVRational tb = ctx->inputs[0] ? ctx->inputs[0]->time_base : AV_TIME_BASE_Q;
+
+    if (s->nb_frames) {
+        av_log(ctx, AV_LOG_INFO, "frames:%"PRId64"\n", s->nb_frames);
+        if (s->metrics & (1 << METRIC_SIGNAL))
+            av_log(ctx, AV_LOG_INFO, "YAVG:%f\n", s->yavg_total / s->nb_frames);
+        if (s->metrics & (1 << METRIC_BLACK))
+            av_log(ctx, AV_LOG_INFO, "black intervals:%d black duration:%s\n",
+                   s->nb_black, av_ts2timestr(s->black_total, &tb));
+        if (s->metrics & (1 << METRIC_FREEZE))
+            av_log(ctx, AV_LOG_INFO, "freeze intervals:%d freeze duration:%s%s\n",
+                   s->nb_freeze, av_ts2timestr(s->freeze_total, &AV_TIME_BASE_Q),
+                   s->frozen ? " (frozen at end)" : "");
+        if (s->metrics & (1 << METRIC_CROP) && s->crop_w > 0 && s->crop_h > 0)
+            av_log(ctx, AV_LOG_INFO, "crop=%d:%d:%d:%d\n",
+                   s->crop_w, s->crop_h, s->crop_x, s->crop_y);
+        if (s->metrics & (1 << METRIC_REPEAT))
+            av_log(ctx, AV_LOG_INFO, "Repeated Fields: Neither:%6"PRId64" Top:%6"PRId64" Bottom:%6"PRId64"\n",
+                   s->total_repeats[REPEAT_NONE], s->total_repeats[REPEAT_TOP],
+                   s->total_repeats[REPEAT_BOTTOM]);
+    }
+
+    av_frame_free(&s->prev);
+    av_frame_free(&s->reference);
+    free_slices(s);
+    av_freep(&s->hist[0]);
+    av_freep(&s->hist[1]);
+    av_freep(&s->hist[2]);
+    av_freep(&s->histsat);
+    av_freep(&s->rowsum);
+    av_freep(&s->colsum);
+}
+
+static const AVFilterPad qcstats_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+static const AVFilterPad qcstats_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .request_frame = request_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_qcstats = {
+    .name          = "qcstats",
+    .description   = NULL_IF_CONFIG_SMALL("Compute video quality control metrics in one pass."),
+    .priv_size     = sizeof(QCStatsContext),
+    .priv_class    = &qcstats_class,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .inputs        = qcstats_inputs,
+    .outputs       = qcstats_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
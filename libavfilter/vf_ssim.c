@@ -27,6 +27,11 @@
  *
  * To improve speed, this implementation uses the standard approximation of
  * overlapped 8x8 block sums, rather than the original gaussian weights.
+ *
+ * multi-scale variant:
+ * Z. Wang, E. P. Simoncelli and A. C. Bovik,
+ *   "Multiscale structural similarity for image quality assessment,"
+ *   Asilomar Conference on Signals, Systems and Computers, 2003.
  */
 
 /*
@@ -45,6 +50,8 @@
 #include "ssim.h"
 #include "video.h"
 
+#define MS_SSIM_SCALES 5
+
 typedef struct SSIMContext {
     const AVClass *class;
     FFFrameSync fs;
@@ -59,22 +66,47 @@ typedef struct SSIMContext {
     uint8_t rgba_map[4];
     int planewidth[4];
     int planeheight[4];
-    int *temp;
+    void **temp;
+    int nb_threads;
     int is_rgb;
-    float (*ssim_plane)(SSIMDSPContext *dsp,
-                        uint8_t *main, int main_stride,
-                        uint8_t *ref, int ref_stride,
-                        int width, int height, void *temp,
-                        int max);
+    int msssim;
+    int nb_scales;
+    double ms_ssim[4], ms_ssim_total;
+    int scalewidth[MS_SSIM_SCALES][4];
+    int scaleheight[MS_SSIM_SCALES][4];
+    uint16_t *main_scaled[MS_SSIM_SCALES][4];
+    uint16_t *ref_scaled[MS_SSIM_SCALES][4];
+    float *score[MS_SSIM_SCALES][4];
+    float *cs[MS_SSIM_SCALES][4];
+    void (*ssim_plane)(SSIMDSPContext *dsp,
+                       const uint8_t *main, int main_stride,
+                       const uint8_t *ref, int ref_stride,
+                       int width, void *temp, int max,
+                       int slice_start, int slice_end,
+                       float *score, float *cs);
     SSIMDSPContext dsp;
 } SSIMContext;
 
+typedef struct ThreadData {
+    const uint8_t *main_data[4];
+    const uint8_t *ref_data[4];
+    int main_linesize[4];
+    int ref_linesize[4];
+    int scale;
+} ThreadData;
+
+/* Weights of the scales from the reference implementation */
+static const double ms_ssim_weights[MS_SSIM_SCALES] = {
+    0.0448, 0.2856, 0.3001, 0.2363, 0.1333,
+};
+
 #define OFFSET(x) offsetof(SSIMContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 
 static const AVOption ssim_options[] = {
     {"stats_file", "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
     {"f",          "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    {"msssim",     "Also compute the multi-scale SSIM",                       OFFSET(msssim),         AV_OPT_TYPE_BOOL,   {.i64=0},    0, 1, FLAGS },
     { NULL }
 };
 
@@ -160,7 +192,8 @@ static void ssim_4x4xn_8bit(const uint8_t *main, ptrdiff_t main_stride,
     }
 }
 
-static float ssim_end1x(int64_t s1, int64_t s2, int64_t ss, int64_t s12, int max)
+static float ssim_end1x(int64_t s1, int64_t s2, int64_t ss, int64_t s12, int max,
+                        float *cs)
 {
     int64_t ssim_c1 = (int64_t)(.01*.01*max*max*64 + .5);
     int64_t ssim_c2 = (int64_t)(.03*.03*max*max*64*63 + .5);
@@ -172,6 +205,9 @@ static float ssim_end1x(int64_t s1, int64_t s2, int64_t ss, int64_t s12, int max
     int64_t vars = fss * 64 - fs1 * fs1 - fs2 * fs2;
     int64_t covar = fs12 * 64 - fs1 * fs2;
 
+    if (cs)
+        *cs = (float)(2 * covar + ssim_c2) / (float)(vars + ssim_c2);
+
     return (float)(2 * fs1 * fs2 + ssim_c1) * (float)(2 * covar + ssim_c2)
          / ((float)(fs1 * fs1 + fs2 * fs2 + ssim_c1) * (float)(vars + ssim_c2));
 }
@@ -192,17 +228,34 @@ static float ssim_end1(int s1, int s2, int ss, int s12)
          / ((float)(fs1 * fs1 + fs2 * fs2 + ssim_c1) * (float)(vars + ssim_c2));
 }
 
-static float ssim_endn_16bit(const int64_t (*sum0)[4], const int64_t (*sum1)[4], int width, int max)
+/* The contrast-structure term of ssim_end1() */
+static float ssim_cs1(int s1, int s2, int ss, int s12)
 {
-    float ssim = 0.0;
+    static const int ssim_c2 = (int)(.03*.03*255*255*64*63 + .5);
+
+    int vars = ss * 64 - s1 * s1 - s2 * s2;
+    int covar = s12 * 64 - s1 * s2;
+
+    return (float)(2 * covar + ssim_c2) / (float)(vars + ssim_c2);
+}
+
+static float ssim_endn_16bit(const int64_t (*sum0)[4], const int64_t (*sum1)[4], int width, int max,
+                             float *cs)
+{
+    float ssim = 0.0, cs_sum = 0.0, cs1;
     int i;
 
-    for (i = 0; i < width; i++)
+    for (i = 0; i < width; i++) {
         ssim += ssim_end1x(sum0[i][0] + sum0[i + 1][0] + sum1[i][0] + sum1[i + 1][0],
                            sum0[i][1] + sum0[i + 1][1] + sum1[i][1] + sum1[i + 1][1],
                            sum0[i][2] + sum0[i + 1][2] + sum1[i][2] + sum1[i + 1][2],
                            sum0[i][3] + sum0[i + 1][3] + sum1[i][3] + sum1[i + 1][3],
-                           max);
+                           max, cs ? &cs1 : NULL);
+        if (cs)
+            cs_sum += cs1;
+    }
+    if (cs)
+        *cs = cs_sum;
     return ssim;
 }
 
@@ -219,23 +272,53 @@ static float ssim_endn_8bit(const int (*sum0)[4], const int (*sum1)[4], int widt
     return ssim;
 }
 
-#define SUM_LEN(w) (((w) >> 2) + 3)
+static float ssim_csn_8bit(const int (*sum0)[4], const int (*sum1)[4], int width)
+{
+    float cs = 0.0;
+    int i;
+
+    for (i = 0; i < width; i++)
+        cs += ssim_cs1(sum0[i][0] + sum0[i + 1][0] + sum1[i][0] + sum1[i + 1][0],
+                       sum0[i][1] + sum0[i + 1][1] + sum1[i][1] + sum1[i + 1][1],
+                       sum0[i][2] + sum0[i + 1][2] + sum1[i][2] + sum1[i + 1][2],
+                       sum0[i][3] + sum0[i + 1][3] + sum1[i][3] + sum1[i + 1][3]);
+    return cs;
+}
 
-static float ssim_plane_16bit(SSIMDSPContext *dsp,
-                              uint8_t *main, int main_stride,
-                              uint8_t *ref, int ref_stride,
-                              int width, int height, void *temp,
-                              int max)
+void ff_ssim_init(SSIMDSPContext *dsp)
 {
-    int z = 0, y;
-    float ssim = 0.0;
+    dsp->ssim_4x4_line = ssim_4x4xn_8bit;
+    dsp->ssim_end_line = ssim_endn_8bit;
+    if (ARCH_X86)
+        ff_ssim_init_x86(dsp);
+}
+
+/* Even, so that the second line of sums keeps the alignment of the first */
+#define SUM_LEN(w) FFALIGN(((w) >> 2) + 3, 2)
+
+/*
+ * The functions below store the SSIM sum (and the contrast-structure sum,
+ * if cs is set) of each row y of 4x4 blocks in [slice_start, slice_end),
+ * where row y covers the 8x8 windows of block rows y - 1 and y. Row 0 has
+ * no window, so the first slice starts at 1 and each slice recomputes the
+ * sums of its first block row's upper neighbour.
+ */
+static void ssim_plane_16bit(SSIMDSPContext *dsp,
+                             const uint8_t *main, int main_stride,
+                             const uint8_t *ref, int ref_stride,
+                             int width, void *temp, int max,
+                             int slice_start, int slice_end,
+                             float *score, float *cs)
+{
+    int z, y;
     int64_t (*sum0)[4] = temp;
     int64_t (*sum1)[4] = sum0 + SUM_LEN(width);
 
     width >>= 2;
-    height >>= 2;
+    slice_start = FFMAX(slice_start, 1);
+    z = slice_start - 1;
 
-    for (y = 1; y < height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for (; z <= y; z++) {
             FFSWAP(void*, sum0, sum1);
             ssim_4x4xn_16bit(&main[4 * z * main_stride], main_stride,
@@ -243,27 +326,27 @@ static float ssim_plane_16bit(SSIMDSPContext *dsp,
                              sum0, width);
         }
 
-        ssim += ssim_endn_16bit((const int64_t (*)[4])sum0, (const int64_t (*)[4])sum1, width - 1, max);
+        score[y] = ssim_endn_16bit((const int64_t (*)[4])sum0, (const int64_t (*)[4])sum1,
+                                   width - 1, max, cs ? &cs[y] : NULL);
     }
-
-    return ssim / ((height - 1) * (width - 1));
 }
 
-static float ssim_plane(SSIMDSPContext *dsp,
-                        uint8_t *main, int main_stride,
-                        uint8_t *ref, int ref_stride,
-                        int width, int height, void *temp,
-                        int max)
+static void ssim_plane(SSIMDSPContext *dsp,
+                       const uint8_t *main, int main_stride,
+                       const uint8_t *ref, int ref_stride,
+                       int width, void *temp, int max,
+                       int slice_start, int slice_end,
+                       float *score, float *cs)
 {
-    int z = 0, y;
-    float ssim = 0.0;
+    int z, y;
     int (*sum0)[4] = temp;
     int (*sum1)[4] = sum0 + SUM_LEN(width);
 
     width >>= 2;
-    height >>= 2;
+    slice_start = FFMAX(slice_start, 1);
+    z = slice_start - 1;
 
-    for (y = 1; y < height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for (; z <= y; z++) {
             FFSWAP(void*, sum0, sum1);
             dsp->ssim_4x4_line(&main[4 * z * main_stride], main_stride,
@@ -271,10 +354,135 @@ static float ssim_plane(SSIMDSPContext *dsp,
                                sum0, width);
         }
 
-        ssim += dsp->ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1, width - 1);
+        /* the cs term is computed separately, so that the SSIM itself
+         * always comes from the same, possibly SIMD, function */
+        score[y] = dsp->ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1,
+                                      width - 1);
+        if (cs)
+            cs[y] = ssim_csn_8bit((const int (*)[4])sum0, (const int (*)[4])sum1,
+                                  width - 1);
+    }
+}
+
+static void downscale_2x2(uint16_t *dst, int width, const uint8_t *src, int linesize,
+                          int is_16bit, int slice_start, int slice_end)
+{
+    int x, y;
+
+    for (y = slice_start; y < slice_end; y++) {
+        const uint8_t *src0 = src + 2 * y * linesize;
+        const uint8_t *src1 = src0 + linesize;
+        uint16_t *dst_line = dst + y * width;
+
+        if (is_16bit) {
+            const uint16_t *s0 = (const uint16_t *)src0;
+            const uint16_t *s1 = (const uint16_t *)src1;
+
+            for (x = 0; x < width; x++)
+                dst_line[x] = (s0[2 * x] + s0[2 * x + 1] + s1[2 * x] + s1[2 * x + 1] + 2) >> 2;
+        } else {
+            for (x = 0; x < width; x++)
+                dst_line[x] = (src0[2 * x] + src0[2 * x + 1] + src1[2 * x] + src1[2 * x + 1] + 2) >> 2;
+        }
+    }
+}
+
+static int downscale_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    SSIMContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int l = td->scale;
+    int c;
+
+    for (c = 0; c < s->nb_components; c++) {
+        const int width  = s->scalewidth[l][c];
+        const int height = s->scaleheight[l][c];
+        const int slice_start = (height * jobnr) / nb_jobs;
+        const int slice_end   = (height * (jobnr + 1)) / nb_jobs;
+
+        if (l == 1) {
+            downscale_2x2(s->main_scaled[l][c], width, td->main_data[c], td->main_linesize[c],
+                          s->max > 255, slice_start, slice_end);
+            downscale_2x2(s->ref_scaled[l][c], width, td->ref_data[c], td->ref_linesize[c],
+                          s->max > 255, slice_start, slice_end);
+        } else {
+            const int linesize = s->scalewidth[l - 1][c] * 2;
+
+            downscale_2x2(s->main_scaled[l][c], width, (const uint8_t *)s->main_scaled[l - 1][c],
+                          linesize, 1, slice_start, slice_end);
+            downscale_2x2(s->ref_scaled[l][c], width, (const uint8_t *)s->ref_scaled[l - 1][c],
+                          linesize, 1, slice_start, slice_end);
+        }
+    }
+
+    return 0;
+}
+
+static int ssim_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    SSIMContext *s = ctx->priv;
+    ThreadData *td = arg;
+    void *temp = s->temp[jobnr];
+    int l, c;
+
+    for (l = 0; l < s->nb_scales; l++) {
+        for (c = 0; c < s->nb_components; c++) {
+            const int rows = s->scaleheight[l][c] >> 2;
+            const int slice_start = (rows * jobnr) / nb_jobs;
+            const int slice_end   = (rows * (jobnr + 1)) / nb_jobs;
+            float *cs = s->msssim ? s->cs[l][c] : NULL;
+
+            if (!l) {
+                s->ssim_plane(&s->dsp, td->main_data[c], td->main_linesize[c],
+                              td->ref_data[c], td->ref_linesize[c],
+                              s->planewidth[c], temp, s->max,
+                              slice_start, slice_end, s->score[l][c], cs);
+            } else {
+                const int width = s->scalewidth[l][c];
+
+                ssim_plane_16bit(&s->dsp, (const uint8_t *)s->main_scaled[l][c], width * 2,
+                                 (const uint8_t *)s->ref_scaled[l][c], width * 2,
+                                 width, temp, s->max,
+                                 slice_start, slice_end, s->score[l][c], cs);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* Averages the per-row sums in order, independently of the slicing */
+static float mean_rows(const float *rows, int width, int height)
+{
+    float sum = 0.0;
+    int y;
+
+    width >>= 2;
+    height >>= 2;
+
+    for (y = 1; y < height; y++)
+        sum += rows[y];
+
+    return sum / ((height - 1) * (width - 1));
+}
+
+static double ms_ssim_plane(SSIMContext *s, int c)
+{
+    double ms_ssim = 1.0, weight_sum = 0.0;
+    int l;
+
+    for (l = 0; l < s->nb_scales; l++)
+        weight_sum += ms_ssim_weights[l];
+
+    /* Luminance only enters at the coarsest scale */
+    for (l = 0; l < s->nb_scales; l++) {
+        const float *rows = l == s->nb_scales - 1 ? s->score[l][c] : s->cs[l][c];
+        double v = mean_rows(rows, s->scalewidth[l][c], s->scaleheight[l][c]);
+
+        ms_ssim *= pow(FFMAX(v, 0.0), ms_ssim_weights[l] / weight_sum);
     }
 
-    return ssim / ((height - 1) * (width - 1));
+    return ms_ssim;
 }
 
 static double ssim_db(double ssim, double weight)
@@ -288,8 +496,10 @@ static int do_ssim(FFFrameSync *fs)
     SSIMContext *s = ctx->priv;
     AVFrame *master, *ref;
     AVDictionary **metadata;
+    ThreadData td;
     float c[4], ssimv = 0.0;
-    int ret, i;
+    double ms[4], msv = 0.0;
+    int ret, i, l, nb_jobs;
 
     ret = ff_framesync_dualinput_get(fs, &master, &ref);
     if (ret < 0)
@@ -301,21 +511,43 @@ static int do_ssim(FFFrameSync *fs)
     s->nb_frames++;
 
     for (i = 0; i < s->nb_components; i++) {
-        c[i] = s->ssim_plane(&s->dsp, master->data[i], master->linesize[i],
-                             ref->data[i], ref->linesize[i],
-                             s->planewidth[i], s->planeheight[i], s->temp,
-                             s->max);
+        td.main_data[i] = master->data[i];
+        td.ref_data[i] = ref->data[i];
+        td.main_linesize[i] = master->linesize[i];
+        td.ref_linesize[i] = ref->linesize[i];
+    }
+
+    nb_jobs = FFMIN(s->planeheight[0] >> 2, s->nb_threads);
+    for (l = 1; l < s->nb_scales; l++) {
+        td.scale = l;
+        ctx->internal->execute(ctx, downscale_slice, &td, NULL, nb_jobs);
+    }
+    ctx->internal->execute(ctx, ssim_slice, &td, NULL, nb_jobs);
+
+    for (i = 0; i < s->nb_components; i++) {
+        c[i] = mean_rows(s->score[0][i], s->planewidth[i], s->planeheight[i]);
         ssimv += s->coefs[i] * c[i];
         s->ssim[i] += c[i];
+        if (s->msssim) {
+            ms[i] = ms_ssim_plane(s, i);
+            msv += s->coefs[i] * ms[i];
+            s->ms_ssim[i] += ms[i];
+        }
     }
     for (i = 0; i < s->nb_components; i++) {
         int cidx = s->is_rgb ? s->rgba_map[i] : i;
         set_meta(metadata, "lavfi.ssim.", s->comps[i], c[cidx]);
+        if (s->msssim)
+            set_meta(metadata, "lavfi.ssim.ms.", s->comps[i], ms[cidx]);
     }
     s->ssim_total += ssimv;
 
     set_meta(metadata, "lavfi.ssim.All", 0, ssimv);
     set_meta(metadata, "lavfi.ssim.dB", 0, ssim_db(ssimv, 1.0));
+    if (s->msssim) {
+        s->ms_ssim_total += msv;
+        set_meta(metadata, "lavfi.ssim.ms.All", 0, msv);
+    }
 
     if (s->stats_file) {
         fprintf(s->stats_file, "n:%"PRId64" ", s->nb_frames);
@@ -325,7 +557,10 @@ static int do_ssim(FFFrameSync *fs)
             fprintf(s->stats_file, "%c:%f ", s->comps[i], c[cidx]);
         }
 
-        fprintf(s->stats_file, "All:%f (%f)\n", ssimv, ssim_db(ssimv, 1.0));
+        fprintf(s->stats_file, "All:%f (%f)", ssimv, ssim_db(ssimv, 1.0));
+        if (s->msssim)
+            fprintf(s->stats_file, " MS:%f", msv);
+        fprintf(s->stats_file, "\n");
     }
 
     return ff_filter_frame(ctx->outputs[0], master);
@@ -381,7 +616,8 @@ static int config_input_ref(AVFilterLink *inlink)
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
     AVFilterContext *ctx  = inlink->dst;
     SSIMContext *s = ctx->priv;
-    int sum = 0, i;
+    int sum = 0, i, l;
+    size_t temp_size;
 
     s->nb_components = desc->nb_components;
 
@@ -410,16 +646,59 @@ static int config_input_ref(AVFilterLink *inlink)
     for (i = 0; i < s->nb_components; i++)
         s->coefs[i] = (double) s->planeheight[i] * s->planewidth[i] / sum;
 
-    s->temp = av_mallocz_array(2 * SUM_LEN(inlink->w), (desc->comp[0].depth > 8) ? sizeof(int64_t[4]) : sizeof(int[4]));
+    s->nb_scales = 1;
+    if (s->msssim) {
+        for (; s->nb_scales < MS_SSIM_SCALES; s->nb_scales++) {
+            for (i = 0; i < s->nb_components; i++)
+                if ((s->planewidth[i]  >> s->nb_scales) < 8 ||
+                    (s->planeheight[i] >> s->nb_scales) < 8)
+                    break;
+            if (i < s->nb_components)
+                break;
+        }
+        if (s->nb_scales < MS_SSIM_SCALES)
+            av_log(ctx, AV_LOG_WARNING, "Input too small for %d MS-SSIM scales, using %d.\n",
+                   MS_SSIM_SCALES, s->nb_scales);
+    }
+
+    for (l = 0; l < s->nb_scales; l++) {
+        for (i = 0; i < s->nb_components; i++) {
+            s->scalewidth[l][i]  = s->planewidth[i]  >> l;
+            s->scaleheight[l][i] = s->planeheight[i] >> l;
+
+            s->score[l][i] = av_calloc(FFMAX(s->scaleheight[l][i] >> 2, 1), sizeof(*s->score[l][i]));
+            if (!s->score[l][i])
+                return AVERROR(ENOMEM);
+            if (s->msssim) {
+                s->cs[l][i] = av_calloc(FFMAX(s->scaleheight[l][i] >> 2, 1), sizeof(*s->cs[l][i]));
+                if (!s->cs[l][i])
+                    return AVERROR(ENOMEM);
+            }
+            if (l) {
+                s->main_scaled[l][i] = av_malloc_array(s->scalewidth[l][i] * s->scaleheight[l][i],
+                                                       sizeof(*s->main_scaled[l][i]));
+                s->ref_scaled[l][i]  = av_malloc_array(s->scalewidth[l][i] * s->scaleheight[l][i],
+                                                       sizeof(*s->ref_scaled[l][i]));
+                if (!s->main_scaled[l][i] || !s->ref_scaled[l][i])
+                    return AVERROR(ENOMEM);
+            }
+        }
+    }
+
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->temp = av_calloc(s->nb_threads, sizeof(*s->temp));
     if (!s->temp)
         return AVERROR(ENOMEM);
+    temp_size = (desc->comp[0].depth > 8 || s->nb_scales > 1) ? sizeof(int64_t[4]) : sizeof(int[4]);
+    for (i = 0; i < s->nb_threads; i++) {
+        s->temp[i] = av_mallocz_array(2 * SUM_LEN(inlink->w), temp_size);
+        if (!s->temp[i])
+            return AVERROR(ENOMEM);
+    }
     s->max = (1 << desc->comp[0].depth) - 1;
 
     s->ssim_plane = desc->comp[0].depth > 8 ? ssim_plane_16bit : ssim_plane;
-    s->dsp.ssim_4x4_line = ssim_4x4xn_8bit;
-    s->dsp.ssim_end_line = ssim_endn_8bit;
-    if (ARCH_X86)
-        ff_ssim_init_x86(&s->dsp);
+    ff_ssim_init(&s->dsp);
 
     return 0;
 }
@@ -455,10 +734,10 @@ static int activate(AVFilterContext *ctx)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     SSIMContext *s = ctx->priv;
+    int i, l;
 
     if (s->nb_frames > 0) {
         char buf[256];
-        int i;
         buf[0] = 0;
         for (i = 0; i < s->nb_components; i++) {
             int c = s->is_rgb ? s->rgba_map[i] : i;
@@ -467,6 +746,16 @@ static av_cold void uninit(AVFilterContext *ctx)
         }
         av_log(ctx, AV_LOG_INFO, "SSIM%s All:%f (%f)\n", buf,
                s->ssim_total / s->nb_frames, ssim_db(s->ssim_total, s->nb_frames));
+
+        if (s->msssim) {
+            buf[0] = 0;
+            for (i = 0; i < s->nb_components; i++) {
+                int c = s->is_rgb ? s->rgba_map[i] : i;
+                av_strlcatf(buf, sizeof(buf), " %c:%f", s->comps[i], s->ms_ssim[c] / s->nb_frames);
+            }
+            av_log(ctx, AV_LOG_INFO, "MS-SSIM%s All:%f\n", buf,
+                   s->ms_ssim_total / s->nb_frames);
+        }
     }
 
     ff_framesync_uninit(&s->fs);
@@ -474,7 +763,18 @@ static av_cold void uninit(AVFilterContext *ctx)
     if (s->stats_file && s->stats_file != stdout)
         fclose(s->stats_file);
 
+    for (i = 0; i < s->nb_threads && s->temp; i++)
+        av_freep(&s->temp[i]);
     av_freep(&s->temp);
+
+    for (l = 0; l < MS_SSIM_SCALES; l++) {
+        for (i = 0; i < 4; i++) {
+            av_freep(&s->score[l][i]);
+            av_freep(&s->cs[l][i]);
+            av_freep(&s->main_scaled[l][i]);
+            av_freep(&s->ref_scaled[l][i]);
+        }
+    }
 }
 
 static const AVFilterPad ssim_inputs[] = {
@@ -510,4 +810,5 @@ AVFilter ff_vf_ssim = {
     .priv_class    = &ssim_class,
     .inputs        = ssim_inputs,
     .outputs       = ssim_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,917 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Calculate the elementary VMAF features (VIF, ADM and motion) of a video
+ * against a reference, without libvmaf.
+ *
+ * VIF:
+ * H. R. Sheikh and A. C. Bovik, "Image information and visual quality,"
+ *   IEEE Transactions on Image Processing, vol. 15, no. 2, pp. 430-444, 2006.
+ *
+ * ADM (detail loss metric):
+ * S. Li, F. Zhang, L. Ma and K. N. Ngan, "Image quality assessment by
+ *   separately evaluating detail losses and additive impairments,"
+ *   IEEE Transactions on Multimedia, vol. 13, no. 5, pp. 935-949, 2011.
+ *
+ * The features follow the floating point implementation of the VMAF
+ * project, with the same filters, wavelet, contrast sensitivity model and
+ * constants.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "avfilter.h"
+#include "formats.h"
+#include "framesync.h"
+#include "internal.h"
+#include "vmaf_motion.h"
+#include "video.h"
+
+#define VIF_SCALES 4
+#define VIF_MAX_FILTER 17
+#define ADM_SCALES 4
+#define ADM_BORDER_FACTOR 0.1
+
+enum { BAND_H, BAND_V, BAND_D, BAND_A, NB_BANDS };
+
+typedef struct VMAFFeaturesContext {
+    const AVClass *class;
+    FFFrameSync fs;
+    FILE *stats_file;
+    char *stats_file_str;
+
+    int width, height;
+    int depth;
+    int nb_threads;
+    uint64_t nb_frames;
+
+    float vif_filter[VIF_SCALES][VIF_MAX_FILTER];
+    int vif_filter_width[VIF_SCALES];
+    int vif_w[VIF_SCALES], vif_h[VIF_SCALES];
+    float *vif_ref[VIF_SCALES], *vif_dis[VIF_SCALES];
+    float *vif_num[VIF_SCALES], *vif_den[VIF_SCALES];
+
+    float adm_rfactor[ADM_SCALES][3];
+    int adm_w[ADM_SCALES + 1], adm_h[ADM_SCALES + 1];
+    float *adm_ref[ADM_SCALES][NB_BANDS], *adm_dis[ADM_SCALES][NB_BANDS];
+    float *adm_r[3], *adm_a[3];
+    float *adm_num[3], *adm_den[3];
+
+    float **line_buf;
+
+    VMAFMotionData motion;
+    double prev_vif[VIF_SCALES], prev_adm[ADM_SCALES];
+    double prev_adm2, prev_motion;
+
+    double vif_sum[VIF_SCALES];
+    double adm_sum[ADM_SCALES];
+    double adm2_sum, motion_sum, motion2_sum;
+} VMAFFeaturesContext;
+
+typedef struct ThreadData {
+    const AVFrame *main, *ref;
+    int scale;
+} ThreadData;
+
+#define OFFSET(x) offsetof(VMAFFeaturesContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
+
+static const AVOption vmaffeatures_options[] = {
+    {"stats_file", "Set file where to store per-frame features", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    {"f",          "Set file where to store per-frame features", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { NULL }
+};
+
+FRAMESYNC_DEFINE_CLASS(vmaffeatures, VMAFFeaturesContext, fs);
+
+/* Daubechies 2 wavelet */
+static const float dwt_lo[4] = {
+     0.482962913144690,  0.836516303737469,
+     0.224143868041857, -0.129409522550921,
+};
+
+static const float dwt_hi[4] = {
+    -0.129409522550921, -0.224143868041857,
+     0.836516303737469, -0.482962913144690,
+};
+
+/* Amplitudes of the 9/7 wavelet basis functions, per level and orientation */
+static const float dwt_basis_amplitudes[6][4] = {
+    { 0.62171,  0.67234,  0.72709,  0.67234  },
+    { 0.34537,  0.41317,  0.49428,  0.41317  },
+    { 0.18004,  0.22727,  0.28688,  0.22727  },
+    { 0.091401, 0.11792,  0.15214,  0.11792  },
+    { 0.045943, 0.059758, 0.077727, 0.059758 },
+    { 0.023013, 0.030018, 0.039156, 0.030018 },
+};
+
+/*
+ * Quantization step of the luma contrast sensitivity model of Watson et al.,
+ * "Visibility of wavelet quantization noise", for a 1080 lines display seen
+ * from three times its height.
+ */
+static float dwt_quant_step(int lambda, int theta)
+{
+    static const float a = 0.495, k = 0.466, f0 = 0.401;
+    static const float g[4] = { 1.501, 1.0, 0.534, 1.0 };
+    const float r = 3.0 * 1080 * M_PI / 180.0;
+    const float temp = log10(pow(2.0, lambda + 1) * f0 * g[theta] / r);
+
+    return 2.0 * a * pow(10.0, k * temp * temp) / dwt_basis_amplitudes[lambda][theta];
+}
+
+static av_always_inline int mirror(int x, int n)
+{
+    x = FFABS(x);
+    return x < n ? x : 2 * n - x - 1;
+}
+
+/* Extends a line of w samples by radius mirrored samples on each side */
+static void pad_line(float *line, int w, int radius)
+{
+    int k;
+
+    for (k = 1; k <= radius; k++) {
+        line[-k]        = line[mirror(-k, w)];
+        line[w - 1 + k] = line[mirror(w - 1 + k, w)];
+    }
+}
+
+static int convert_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFFeaturesContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int w = s->width, h = s->height;
+    const int slice_start = (h * jobnr) / nb_jobs;
+    const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    int i, j, p;
+
+    for (p = 0; p < 2; p++) {
+        const AVFrame *in = p ? td->main : td->ref;
+        float *dst = p ? s->vif_dis[0] : s->vif_ref[0];
+
+        for (i = slice_start; i < slice_end; i++) {
+            const uint8_t *src = in->data[0] + i * in->linesize[0];
+            float *dst_line = dst + i * w;
+
+            /* Features are computed on the 8-bit scale, centered on zero */
+            if (s->depth > 8) {
+                const uint16_t *src16 = (const uint16_t *)src;
+                for (j = 0; j < w; j++)
+                    dst_line[j] = src16[j] / 4.0f - 128.0f;
+            } else {
+                for (j = 0; j < w; j++)
+                    dst_line[j] = src[j] - 128.0f;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int vif_downscale_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFFeaturesContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int l = td->scale;
+    const float *filter = s->vif_filter[l];
+    const int fw = s->vif_filter_width[l];
+    const int radius = fw / 2;
+    const int w = s->vif_w[l - 1], h = s->vif_h[l - 1];
+    const int dst_w = s->vif_w[l], dst_h = s->vif_h[l];
+    const int slice_start = (dst_h * jobnr) / nb_jobs;
+    const int slice_end   = (dst_h * (jobnr + 1)) / nb_jobs;
+    float *line = s->line_buf[jobnr] + radius;
+    int i, j, k, p;
+
+    for (p = 0; p < 2; p++) {
+        const float *src = p ? s->vif_dis[l - 1] : s->vif_ref[l - 1];
+        float *dst = p ? s->vif_dis[l] : s->vif_ref[l];
+
+        for (i = slice_start; i < slice_end; i++) {
+            const float *rows[VIF_MAX_FILTER];
+
+            for (k = 0; k < fw; k++)
+                rows[k] = src + mirror(2 * i - radius + k, h) * w;
+
+            for (j = 0; j < w; j++) {
+                float sum = 0.0f;
+                for (k = 0; k < fw; k++)
+                    sum += filter[k] * rows[k][j];
+                line[j] = sum;
+            }
+            pad_line(line, w, radius);
+
+            for (j = 0; j < dst_w; j++) {
+                const float *l0 = line + 2 * j - radius;
+                float sum = 0.0f;
+                for (k = 0; k < fw; k++)
+                    sum += filter[k] * l0[k];
+                dst[i * dst_w + j] = sum;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int vif_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    static const float sigma_nsq = 2.0f;
+    static const float eps = 1.0e-10f;
+    static const float gain_limit = 100.0f;
+    VMAFFeaturesContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int l = td->scale;
+    const float *filter = s->vif_filter[l];
+    const int fw = s->vif_filter_width[l];
+    const int radius = fw / 2;
+    const int w = s->vif_w[l], h = s->vif_h[l];
+    const int line_len = w + 2 * radius;
+    const int slice_start = (h * jobnr) / nb_jobs;
+    const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    const float *ref = s->vif_ref[l];
+    const float *dis = s->vif_dis[l];
+    float *mu1 = s->line_buf[jobnr] + radius;
+    float *mu2 = mu1 + line_len;
+    float *xx  = mu2 + line_len;
+    float *yy  = xx  + line_len;
+    float *xy  = yy  + line_len;
+    int i, j, k;
+
+    for (i = slice_start; i < slice_end; i++) {
+        float num = 0.0f, den = 0.0f;
+        int rows[VIF_MAX_FILTER];
+
+        for (k = 0; k < fw; k++)
+            rows[k] = mirror(i - radius + k, h) * w;
+
+        for (j = 0; j < w; j++) {
+            float s1 = 0.0f, s2 = 0.0f, s11 = 0.0f, s22 = 0.0f, s12 = 0.0f;
+            for (k = 0; k < fw; k++) {
+                const float f = filter[k];
+                const float r = ref[rows[k] + j];
+                const float d = dis[rows[k] + j];
+                s1  += f * r;
+                s2  += f * d;
+                s11 += f * (r * r);
+                s22 += f * (d * d);
+                s12 += f * (r * d);
+            }
+            mu1[j] = s1;
+            mu2[j] = s2;
+            xx[j]  = s11;
+            yy[j]  = s22;
+            xy[j]  = s12;
+        }
+        pad_line(mu1, w, radius);
+        pad_line(mu2, w, radius);
+        pad_line(xx,  w, radius);
+        pad_line(yy,  w, radius);
+        pad_line(xy,  w, radius);
+
+        for (j = 0; j < w; j++) {
+            float m1 = 0.0f, m2 = 0.0f, s11 = 0.0f, s22 = 0.0f, s12 = 0.0f;
+            float sigma1_sq, sigma2_sq, sigma12, g, sv_sq;
+
+            for (k = 0; k < fw; k++) {
+                const int jj = j - radius + k;
+                const float f = filter[k];
+                m1  += f * mu1[jj];
+                m2  += f * mu2[jj];
+                s11 += f * xx[jj];
+                s22 += f * yy[jj];
+                s12 += f * xy[jj];
+            }
+
+            sigma1_sq = FFMAX(s11 - m1 * m1, 0.0f);
+            sigma2_sq = FFMAX(s22 - m2 * m2, 0.0f);
+            sigma12   = s12 - m1 * m2;
+
+            g     = sigma12 / (sigma1_sq + eps);
+            sv_sq = sigma2_sq - g * sigma12;
+
+            if (sigma1_sq < eps) {
+                g = 0.0f;
+                sv_sq = sigma2_sq;
+                sigma1_sq = 0.0f;
+            }
+            if (sigma2_sq < eps) {
+                g = 0.0f;
+                sv_sq = 0.0f;
+            }
+            if (g < 0.0f) {
+                sv_sq = sigma2_sq;
+                g = 0.0f;
+            }
+            sv_sq = FFMAX(sv_sq, eps);
+            g = FFMIN(g, gain_limit);
+
+            num += log2f(1.0f + (g * g * sigma1_sq) / (sv_sq + sigma_nsq));
+            den += log2f(1.0f + sigma1_sq / sigma_nsq);
+        }
+
+        s->vif_num[l][i] = num;
+        s->vif_den[l][i] = den;
+    }
+
+    return 0;
+}
+
+static int adm_dwt_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFFeaturesContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int l = td->scale;
+    const int w = s->adm_w[l], h = s->adm_h[l];
+    const int dst_w = s->adm_w[l + 1], dst_h = s->adm_h[l + 1];
+    const int slice_start = (dst_h * jobnr) / nb_jobs;
+    const int slice_end   = (dst_h * (jobnr + 1)) / nb_jobs;
+    float *lo = s->line_buf[jobnr] + 2;
+    float *hi = lo + w + 4;
+    int i, j, k, p;
+
+    for (p = 0; p < 2; p++) {
+        const float *src = l ? (p ? s->adm_dis : s->adm_ref)[l - 1][BAND_A]
+                             : (p ? s->vif_dis[0] : s->vif_ref[0]);
+        float **bands = p ? s->adm_dis[l] : s->adm_ref[l];
+
+        for (i = slice_start; i < slice_end; i++) {
+            const float *rows[4];
+
+            for (k = 0; k < 4; k++)
+                rows[k] = src + mirror(2 * i - 1 + k, h) * w;
+
+            for (j = 0; j < w; j++) {
+                float sum_lo = 0.0f, sum_hi = 0.0f;
+                for (k = 0; k < 4; k++) {
+                    sum_lo += dwt_lo[k] * rows[k][j];
+                    sum_hi += dwt_hi[k] * rows[k][j];
+                }
+                lo[j] = sum_lo;
+                hi[j] = sum_hi;
+            }
+            pad_line(lo, w, 2);
+            pad_line(hi, w, 2);
+
+            for (j = 0; j < dst_w; j++) {
+                const float *lo0 = lo + 2 * j - 1;
+                const float *hi0 = hi + 2 * j - 1;
+                float a = 0.0f, v = 0.0f, hh = 0.0f, d = 0.0f;
+
+                for (k = 0; k < 4; k++) {
+                    a  += dwt_lo[k] * lo0[k];
+                    v  += dwt_hi[k] * lo0[k];
+                    hh += dwt_lo[k] * hi0[k];
+                    d  += dwt_hi[k] * hi0[k];
+                }
+                bands[BAND_A][i * dst_w + j] = a;
+                bands[BAND_V][i * dst_w + j] = v;
+                bands[BAND_H][i * dst_w + j] = hh;
+                bands[BAND_D][i * dst_w + j] = d;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void adm_border(int w, int h, int *left, int *top, int *right, int *bottom)
+{
+    *left   = w * ADM_BORDER_FACTOR - 0.5;
+    *top    = h * ADM_BORDER_FACTOR - 0.5;
+    *right  = w - *left;
+    *bottom = h - *top;
+}
+
+/*
+ * Splits the distorted subbands into the part restored from the reference
+ * (detail losses) and the additive impairments, and weights the latter
+ * with the contrast sensitivity function.
+ */
+static int adm_decouple_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFFeaturesContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int l = td->scale;
+    const int w = s->adm_w[l + 1], h = s->adm_h[l + 1];
+    const int slice_start = (h * jobnr) / nb_jobs;
+    const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    const float *rfactor = s->adm_rfactor[l];
+    const float cos_1deg_sq = cos(M_PI / 180.0) * cos(M_PI / 180.0);
+    const float eps = 1e-30f;
+    int left, top, right, bottom;
+    int i, j, b;
+
+    adm_border(w, h, &left, &top, &right, &bottom);
+
+    for (i = slice_start; i < slice_end; i++) {
+        for (j = 0; j < w; j++) {
+            const int idx = i * w + j;
+            float o[3], t[3], k, rst[3];
+            float ot_dp, o_mag_sq, t_mag_sq;
+
+            for (b = 0; b < 3; b++) {
+                o[b] = s->adm_ref[l][b][idx];
+                t[b] = s->adm_dis[l][b][idx];
+                k = av_clipf(t[b] / (o[b] + eps), 0.0f, 1.0f);
+                rst[b] = k * o[b];
+            }
+
+            ot_dp    = o[BAND_H] * t[BAND_H] + o[BAND_V] * t[BAND_V];
+            o_mag_sq = o[BAND_H] * o[BAND_H] + o[BAND_V] * o[BAND_V];
+            t_mag_sq = t[BAND_H] * t[BAND_H] + t[BAND_V] * t[BAND_V];
+
+            /* Orientation preserved to within one degree, only a contrast change */
+            if (ot_dp >= 0.0f && ot_dp * ot_dp >= cos_1deg_sq * o_mag_sq * t_mag_sq) {
+                for (b = 0; b < 3; b++)
+                    rst[b] = t[b];
+            }
+
+            for (b = 0; b < 3; b++) {
+                s->adm_r[b][idx] = rst[b];
+                s->adm_a[b][idx] = (t[b] - rst[b]) * rfactor[b];
+            }
+        }
+
+        if (i >= top && i < bottom) {
+            for (b = 0; b < 3; b++) {
+                const float *ref = s->adm_ref[l][b] + i * w;
+                float accum = 0.0f;
+
+                for (j = left; j < right; j++) {
+                    float x = fabsf(ref[j] * rfactor[b]);
+                    accum += x * x * x;
+                }
+                s->adm_den[b][i] = accum;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* Contrast masking of the detail losses by the additive impairments */
+static int adm_cm_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFFeaturesContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int l = td->scale;
+    const int w = s->adm_w[l + 1], h = s->adm_h[l + 1];
+    const float *rfactor = s->adm_rfactor[l];
+    int left, top, right, bottom, slice_start, slice_end;
+    int i, j, b, di, dj;
+
+    adm_border(w, h, &left, &top, &right, &bottom);
+    slice_start = top + ((bottom - top) * jobnr) / nb_jobs;
+    slice_end   = top + ((bottom - top) * (jobnr + 1)) / nb_jobs;
+
+    for (i = slice_start; i < slice_end; i++) {
+        float accum[3] = { 0.0f };
+        int rows[3];
+
+        for (di = 0; di < 3; di++)
+            rows[di] = mirror(i - 1 + di, h) * w;
+
+        for (j = left; j < right; j++) {
+            float thr = 0.0f;
+
+            for (b = 0; b < 3; b++) {
+                const float *a = s->adm_a[b];
+                for (di = 0; di < 3; di++) {
+                    for (dj = 0; dj < 3; dj++) {
+                        const float weight = di == 1 && dj == 1 ? 1.0f / 15 : 1.0f / 30;
+                        thr += weight * fabsf(a[rows[di] + mirror(j - 1 + dj, w)]);
+                    }
+                }
+            }
+
+            for (b = 0; b < 3; b++) {
+                float x = fabsf(s->adm_r[b][i * w + j] * rfactor[b]) - thr;
+                if (x > 0.0f)
+                    accum[b] += x * x * x;
+            }
+        }
+
+        for (b = 0; b < 3; b++)
+            s->adm_num[b][i] = accum[b];
+    }
+
+    return 0;
+}
+
+static void adm_scale_sums(VMAFFeaturesContext *s, int l, double *num, double *den)
+{
+    const int w = s->adm_w[l + 1], h = s->adm_h[l + 1];
+    int left, top, right, bottom, i, b;
+    float area_term;
+
+    adm_border(w, h, &left, &top, &right, &bottom);
+    area_term = powf((bottom - top) * (right - left) / 32.0f, 1.0f / 3.0f);
+
+    *num = *den = 0.0;
+    for (b = 0; b < 3; b++) {
+        float num_b = 0.0f, den_b = 0.0f;
+
+        for (i = top; i < bottom; i++) {
+            num_b += s->adm_num[b][i];
+            den_b += s->adm_den[b][i];
+        }
+        *num += powf(num_b, 1.0f / 3.0f) + area_term;
+        *den += powf(den_b, 1.0f / 3.0f) + area_term;
+    }
+}
+
+static void set_meta(AVDictionary **metadata, const char *key, int idx, double d)
+{
+    char value[128], key2[128];
+
+    snprintf(value, sizeof(value), "%f", d);
+    if (idx >= 0) {
+        snprintf(key2, sizeof(key2), "%s%d", key, idx);
+        av_dict_set(metadata, key2, value, 0);
+    } else {
+        av_dict_set(metadata, key, value, 0);
+    }
+}
+
+static void write_stats(VMAFFeaturesContext *s, double motion2)
+{
+    int l;
+
+    fprintf(s->stats_file, "n:%"PRId64" adm2:%f", s->nb_frames, s->prev_adm2);
+    for (l = 0; l < ADM_SCALES; l++)
+        fprintf(s->stats_file, " adm_scale%d:%f", l, s->prev_adm[l]);
+    for (l = 0; l < VIF_SCALES; l++)
+        fprintf(s->stats_file, " vif_scale%d:%f", l, s->prev_vif[l]);
+    fprintf(s->stats_file, " motion:%f motion2:%f\n", s->prev_motion, motion2);
+}
+
+static int do_vmaffeatures(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    VMAFFeaturesContext *s = ctx->priv;
+    AVFrame *master, *ref;
+    AVDictionary **metadata;
+    ThreadData td;
+    double vif[VIF_SCALES], adm[ADM_SCALES], adm2, motion;
+    double num = 0.0, den = 0.0, numden_limit;
+    int ret, i, l, nb_jobs;
+
+    ret = ff_framesync_dualinput_get(fs, &master, &ref);
+    if (ret < 0)
+        return ret;
+    if (!ref)
+        return ff_filter_frame(ctx->outputs[0], master);
+    metadata = &master->metadata;
+
+    td.main = master;
+    td.ref  = ref;
+    nb_jobs = FFMIN(s->nb_threads, s->vif_h[VIF_SCALES - 1]);
+
+    ctx->internal->execute(ctx, convert_slice, &td, NULL, nb_jobs);
+
+    for (l = 0; l < VIF_SCALES; l++) {
+        td.scale = l;
+        if (l)
+            ctx->internal->execute(ctx, vif_downscale_slice, &td, NULL, nb_jobs);
+        ctx->internal->execute(ctx, vif_slice, &td, NULL, nb_jobs);
+    }
+
+    for (l = 0; l < VIF_SCALES; l++) {
+        double vif_num = 0.0, vif_den = 0.0;
+
+        for (i = 0; i < s->vif_h[l]; i++) {
+            vif_num += s->vif_num[l][i];
+            vif_den += s->vif_den[l][i];
+        }
+        vif[l] = vif_den > 0.0 ? vif_num / vif_den : 1.0;
+    }
+
+    for (l = 0; l < ADM_SCALES; l++) {
+        double num_scale, den_scale;
+
+        td.scale = l;
+        ctx->internal->execute(ctx, adm_dwt_slice, &td, NULL, nb_jobs);
+        ctx->internal->execute(ctx, adm_decouple_slice, &td, NULL, nb_jobs);
+        ctx->internal->execute(ctx, adm_cm_slice, &td, NULL, nb_jobs);
+
+        adm_scale_sums(s, l, &num_scale, &den_scale);
+        adm[l] = den_scale > 0.0 ? num_scale / den_scale : 1.0;
+        num += num_scale;
+        den += den_scale;
+    }
+
+    numden_limit = 1e-10 * (s->width * s->height) / (1920.0 * 1080.0);
+    if (num < numden_limit)
+        num = 0.0;
+    if (den < numden_limit)
+        den = 0.0;
+    adm2 = den == 0.0 ? 1.0 : num / den;
+
+    motion = ff_vmafmotion_process(&s->motion, ref);
+
+    /* motion2 of a frame is the smaller of its motion and the next frame's,
+     * so the value of the previous frame is only known now */
+    if (s->nb_frames) {
+        double motion2 = FFMIN(s->prev_motion, motion);
+
+        s->motion2_sum += motion2;
+        set_meta(metadata, "lavfi.vmaf.motion2", -1, motion2);
+        if (s->stats_file)
+            write_stats(s, motion2);
+    }
+    s->nb_frames++;
+
+    for (l = 0; l < VIF_SCALES; l++) {
+        s->vif_sum[l] += vif[l];
+        s->prev_vif[l] = vif[l];
+        set_meta(metadata, "lavfi.vmaf.vif_scale", l, vif[l]);
+    }
+    for (l = 0; l < ADM_SCALES; l++) {
+        s->adm_sum[l] += adm[l];
+        s->prev_adm[l] = adm[l];
+        set_meta(metadata, "lavfi.vmaf.adm_scale", l, adm[l]);
+    }
+    s->adm2_sum += adm2;
+    s->motion_sum += motion;
+    s->prev_adm2 = adm2;
+    s->prev_motion = motion;
+    set_meta(metadata, "lavfi.vmaf.adm2", -1, adm2);
+    set_meta(metadata, "lavfi.vmaf.motion", -1, motion);
+
+    return ff_filter_frame(ctx->outputs[0], master);
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    VMAFFeaturesContext *s = ctx->priv;
+    int l, k;
+
+    if (s->stats_file_str) {
+        if (!strcmp(s->stats_file_str, "-")) {
+            s->stats_file = stdout;
+        } else {
+            s->stats_file = fopen(s->stats_file_str, "w");
+            if (!s->stats_file) {
+                int err = AVERROR(errno);
+                char buf[128];
+                av_strerror(err, buf, sizeof(buf));
+                av_log(ctx, AV_LOG_ERROR, "Could not open stats file %s: %s\n",
+                       s->stats_file_str, buf);
+                return err;
+            }
+        }
+    }
+
+    /* Normalized gaussians of widths 17, 9, 5 and 3, with sigma = width / 5 */
+    for (l = 0; l < VIF_SCALES; l++) {
+        const int fw = (VIF_MAX_FILTER >> l) + 1 - !l;
+        const double sigma = fw / 5.0;
+        double sum = 0.0;
+
+        s->vif_filter_width[l] = fw;
+        for (k = 0; k < fw; k++) {
+            const int x = k - fw / 2;
+            sum += exp(-(x * x) / (2.0 * sigma * sigma));
+        }
+        for (k = 0; k < fw; k++) {
+            const int x = k - fw / 2;
+            s->vif_filter[l][k] = exp(-(x * x) / (2.0 * sigma * sigma)) / sum;
+        }
+    }
+
+    for (l = 0; l < ADM_SCALES; l++) {
+        s->adm_rfactor[l][BAND_H] = 1.0f / dwt_quant_step(l, 1);
+        s->adm_rfactor[l][BAND_V] = 1.0f / dwt_quant_step(l, 1);
+        s->adm_rfactor[l][BAND_D] = 1.0f / dwt_quant_step(l, 2);
+    }
+
+    s->fs.on_event = do_vmaffeatures;
+    return 0;
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *fmts_list = NULL;
+    int format, ret;
+
+    for (format = 0; av_pix_fmt_desc_get(format); format++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+        if (!(desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_PAL)) &&
+            (desc->flags & AV_PIX_FMT_FLAG_PLANAR || desc->nb_components == 1) &&
+            (!(desc->flags & AV_PIX_FMT_FLAG_BE) == !HAVE_BIGENDIAN || desc->comp[0].depth == 8) &&
+            (desc->comp[0].depth == 8 || desc->comp[0].depth == 10) &&
+            (ret = ff_add_format(&fmts_list, format)) < 0)
+            return ret;
+    }
+
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_input_ref(AVFilterLink *inlink)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    AVFilterContext *ctx  = inlink->dst;
+    VMAFFeaturesContext *s = ctx->priv;
+    int l, b, line_len;
+
+    if (ctx->inputs[0]->w != ctx->inputs[1]->w ||
+        ctx->inputs[0]->h != ctx->inputs[1]->h) {
+        av_log(ctx, AV_LOG_ERROR, "Width and height of input videos must be same.\n");
+        return AVERROR(EINVAL);
+    }
+    if (ctx->inputs[0]->format != ctx->inputs[1]->format) {
+        av_log(ctx, AV_LOG_ERROR, "Inputs must be of same pixel format.\n");
+        return AVERROR(EINVAL);
+    }
+    if (inlink->w < 32 || inlink->h < 32) {
+        av_log(ctx, AV_LOG_ERROR, "Input videos must be at least 32x32.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->width  = inlink->w;
+    s->height = inlink->h;
+    s->depth  = desc->comp[0].depth;
+
+    for (l = 0; l < VIF_SCALES; l++) {
+        s->vif_w[l] = s->width  >> l;
+        s->vif_h[l] = s->height >> l;
+        s->vif_ref[l] = av_malloc_array(s->vif_w[l] * s->vif_h[l], sizeof(*s->vif_ref[l]));
+        s->vif_dis[l] = av_malloc_array(s->vif_w[l] * s->vif_h[l], sizeof(*s->vif_dis[l]));
+        s->vif_num[l] = av_malloc_array(s->vif_h[l], sizeof(*s->vif_num[l]));
+        s->vif_den[l] = av_malloc_array(s->vif_h[l], sizeof(*s->vif_den[l]));
+        if (!s->vif_ref[l] || !s->vif_dis[l] || !s->vif_num[l] || !s->vif_den[l])
+            return AVERROR(ENOMEM);
+    }
+
+    s->adm_w[0] = s->width;
+    s->adm_h[0] = s->height;
+    for (l = 0; l < ADM_SCALES; l++) {
+        const int size = ((s->adm_w[l] + 1) / 2) * ((s->adm_h[l] + 1) / 2);
+
+        s->adm_w[l + 1] = (s->adm_w[l] + 1) / 2;
+        s->adm_h[l + 1] = (s->adm_h[l] + 1) / 2;
+        for (b = 0; b < NB_BANDS; b++) {
+            s->adm_ref[l][b] = av_malloc_array(size, sizeof(*s->adm_ref[l][b]));
+            s->adm_dis[l][b] = av_malloc_array(size, sizeof(*s->adm_dis[l][b]));
+            if (!s->adm_ref[l][b] || !s->adm_dis[l][b])
+                return AVERROR(ENOMEM);
+        }
+    }
+    for (b = 0; b < 3; b++) {
+        s->adm_r[b]   = av_malloc_array(s->adm_w[1] * s->adm_h[1], sizeof(*s->adm_r[b]));
+        s->adm_a[b]   = av_malloc_array(s->adm_w[1] * s->adm_h[1], sizeof(*s->adm_a[b]));
+        s->adm_num[b] = av_calloc(s->adm_h[1], sizeof(*s->adm_num[b]));
+        s->adm_den[b] = av_calloc(s->adm_h[1], sizeof(*s->adm_den[b]));
+        if (!s->adm_r[b] || !s->adm_a[b] || !s->adm_num[b] || !s->adm_den[b])
+            return AVERROR(ENOMEM);
+    }
+
+    /* Five padded lines for the VIF statistics, the largest user */
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    line_len = s->width + 2 * (VIF_MAX_FILTER / 2);
+    s->line_buf = av_calloc(s->nb_threads, sizeof(*s->line_buf));
+    if (!s->line_buf)
+        return AVERROR(ENOMEM);
+    for (l = 0; l < s->nb_threads; l++) {
+        s->line_buf[l] = av_malloc_array(5 * line_len, sizeof(*s->line_buf[l]));
+        if (!s->line_buf[l])
+            return AVERROR(ENOMEM);
+    }
+
+    return ff_vmafmotion_init(&s->motion, s->width, s->height, inlink->format);
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    VMAFFeaturesContext *s = ctx->priv;
+    AVFilterLink *mainlink = ctx->inputs[0];
+    int ret;
+
+    ret = ff_framesync_init_dualinput(&s->fs, ctx);
+    if (ret < 0)
+        return ret;
+    outlink->w = mainlink->w;
+    outlink->h = mainlink->h;
+    outlink->time_base = mainlink->time_base;
+    outlink->sample_aspect_ratio = mainlink->sample_aspect_ratio;
+    outlink->frame_rate = mainlink->frame_rate;
+
+    if ((ret = ff_framesync_configure(&s->fs)) < 0)
+        return ret;
+
+    return 0;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    VMAFFeaturesContext *s = ctx->priv;
+    return ff_framesync_activate(&s->fs);
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    VMAFFeaturesContext *s = ctx->priv;
+    int l, b;
+
+    if (s->nb_frames > 0) {
+        char buf[256];
+
+        /* the last frame has no successor, its motion2 is its own motion */
+        if (s->stats_file)
+            write_stats(s, s->prev_motion);
+
+        buf[0] = 0;
+        for (l = 0; l < ADM_SCALES; l++)
+            av_strlcatf(buf, sizeof(buf), " adm_scale%d:%f", l, s->adm_sum[l] / s->nb_frames);
+        for (l = 0; l < VIF_SCALES; l++)
+            av_strlcatf(buf, sizeof(buf), " vif_scale%d:%f", l, s->vif_sum[l] / s->nb_frames);
+        av_log(ctx, AV_LOG_INFO, "VMAF features adm2:%f%s motion:%f motion2:%f\n",
+               s->adm2_sum / s->nb_frames, buf, s->motion_sum / s->nb_frames,
+               (s->motion2_sum + s->prev_motion) / s->nb_frames);
+    }
+
+    ff_vmafmotion_uninit(&s->motion);
+    ff_framesync_uninit(&s->fs);
+
+    if (s->stats_file && s->stats_file != stdout)
+        fclose(s->stats_file);
+
+    for (l = 0; l < VIF_SCALES; l++) {
+        av_freep(&s->vif_ref[l]);
+        av_freep(&s->vif_dis[l]);
+        av_freep(&s->vif_num[l]);
+        av_freep(&s->vif_den[l]);
+    }
+    for (l = 0; l < ADM_SCALES; l++) {
+        for (b = 0; b < NB_BANDS; b++) {
+            av_freep(&s->adm_ref[l][b]);
+            av_freep(&s->adm_dis[l][b]);
+        }
+    }
+    for (b = 0; b < 3; b++) {
+        av_freep(&s->adm_r[b]);
+        av_freep(&s->adm_a[b]);
+        av_freep(&s->adm_num[b]);
+        av_freep(&s->adm_den[b]);
+    }
+    for (l = 0; l < s->nb_threads && s->line_buf; l++)
+        av_freep(&s->line_buf[l]);
+    av_freep(&s->line_buf);
+}
+
+static const AVFilterPad vmaffeatures_inputs[] = {
+    {
+        .name         = "main",
+        .type         = AVMEDIA_TYPE_VIDEO,
+    },{
+        .name         = "reference",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input_ref,
+    },
+    { NULL }
+};
+
+static const AVFilterPad vmaffeatures_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_vmaffeatures = {
+    .name          = "vmaffeatures",
+    .description   = NULL_IF_CONFIG_SMALL("Calculate the VMAF features between two video streams."),
+    .preinit       = vmaffeatures_framesync_preinit,
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .activate      = activate,
+    .priv_size     = sizeof(VMAFFeaturesContext),
+    .priv_class    = &vmaffeatures_class,
+    .inputs        = vmaffeatures_inputs,
+    .outputs       = vmaffeatures_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
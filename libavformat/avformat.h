@@ -1944,6 +1944,16 @@ typedef struct AVFormatContext {
      * - decoding: set by user
      */
     int skip_estimate_duration_from_pts;
+
+    /**
+     * Maximum number of packets buffered by av_interleaved_write_frame()
+     * before it writes the earliest one regardless of missing streams.
+     * 0 means no limit. Not used by muxers doing their own interleaving
+     * or when chunk_size/chunk_duration are set.
+     *
+     * Muxing only, set by the caller before avformat_write_header().
+     */
+    int max_interleave_packets;
 } AVFormatContext;
 
 #if FF_API_FORMAT_GET_SET
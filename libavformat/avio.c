@@ -431,6 +431,55 @@ int ffurl_write(URLContext *h, const unsigned char *buf, int size)
                                   h->prot->url_write);
 }
 
+int ffurl_write_vec(URLContext *h, const URLIOVec *vec, int nb_vec)
+{
+    int64_t total = 0;
+    int i, len = 0;
+
+    if (!(h->flags & AVIO_FLAG_WRITE))
+        return AVERROR(EIO);
+    for (i = 0; i < nb_vec; i++)
+        total += vec[i].size;
+    /* avoid sending too big packets */
+    if (total > (h->max_packet_size ? h->max_packet_size : INT_MAX))
+        return AVERROR(EIO);
+
+    while (nb_vec > 0) {
+        int ret, written = 0;
+
+        if (h->prot->url_write_vec && nb_vec > 1) {
+            if (ff_check_interrupt(&h->interrupt_callback))
+                return AVERROR_EXIT;
+            ret = h->prot->url_write_vec(h, vec, FFMIN(nb_vec, URL_MAX_IOVEC));
+            /* leave waiting and retrying to ffurl_write() below */
+            if (ret == AVERROR(EINTR) || ret == AVERROR(EAGAIN))
+                ret = 0;
+            else if (ret < 0)
+                return ret;
+            written = ret;
+            len    += ret;
+            while (nb_vec > 0 && ret >= vec->size) {
+                ret -= vec->size;
+                vec++;
+                nb_vec--;
+            }
+            if (!nb_vec || (written && !ret))
+                continue;
+        } else {
+            ret = 0;
+        }
+
+        /* finish the current chunk with the single buffer write */
+        written = ffurl_write(h, vec->data + ret, vec->size - ret);
+        if (written < 0)
+            return written;
+        len += written;
+        vec++;
+        nb_vec--;
+    }
+    return len;
+}
+
 int64_t ffurl_seek(URLContext *h, int64_t pos, int whence)
 {
     int64_t ret;
@@ -150,23 +150,15 @@ void avio_context_free(AVIOContext **ps)
     av_freep(ps);
 }
 
-static void writeout(AVIOContext *s, const uint8_t *data, int len)
+static int io_write_packet(void *opaque, uint8_t *buf, int buf_size);
+
+static void writeout_update(AVIOContext *s, int len, int ret)
 {
-    if (!s->error) {
-        int ret = 0;
-        if (s->write_data_type)
-            ret = s->write_data_type(s->opaque, (uint8_t *)data,
-                                     len,
-                                     s->current_type,
-                                     s->last_time);
-        else if (s->write_packet)
-            ret = s->write_packet(s->opaque, (uint8_t *)data, len);
-        if (ret < 0) {
-            s->error = ret;
-        } else {
-            if (s->pos + len > s->written)
-                s->written = s->pos + len;
-        }
+    if (ret < 0) {
+        s->error = ret;
+    } else {
+        if (s->pos + len > s->written)
+            s->written = s->pos + len;
     }
     if (s->current_type == AVIO_DATA_MARKER_SYNC_POINT ||
         s->current_type == AVIO_DATA_MARKER_BOUNDARY_POINT) {
@@ -177,6 +169,23 @@ static void writeout(AVIOContext *s, const uint8_t *data, int len)
     s->pos += len;
 }
 
+static void writeout(AVIOContext *s, const uint8_t *data, int len)
+{
+    int ret = 0;
+
+    if (s->error) {
+        ret = s->error;
+    } else if (s->write_data_type) {
+        ret = s->write_data_type(s->opaque, (uint8_t *)data,
+                                 len,
+                                 s->current_type,
+                                 s->last_time);
+    } else if (s->write_packet) {
+        ret = s->write_packet(s->opaque, (uint8_t *)data, len);
+    }
+    writeout_update(s, len, ret);
+}
+
 static void flush_buffer(AVIOContext *s)
 {
     s->buf_ptr_max = FFMAX(s->buf_ptr, s->buf_ptr_max);
@@ -193,6 +202,56 @@ static void flush_buffer(AVIOContext *s)
         s->buf_end = s->buffer;
 }
 
+/**
+ * Whether the buffered data and following writes can be handed to the
+ * protocol as one vectored write.
+ */
+static int can_write_vec(AVIOContext *s)
+{
+    AVIOInternal *internal = s->opaque;
+
+    return s->write_flag && s->write_packet == io_write_packet &&
+           !s->write_data_type && !s->update_checksum &&
+           s->buf_ptr >= s->buf_ptr_max &&
+           internal->h->prot->url_write_vec;
+}
+
+/**
+ * Write buf together with the buffered data as one vectored write, without
+ * copying it into the buffer first. can_write_vec() must be true.
+ */
+static void writeout_vec(AVIOContext *s, const uint8_t *buf, int size)
+{
+    AVIOInternal *internal = s->opaque;
+    int max_size = s->max_packet_size ? s->max_packet_size : INT_MAX;
+
+    while (size > 0) {
+        URLIOVec iov[2];
+        int n = 0, len = 0, chunk;
+
+        /* a small rest is cheaper to copy than to pass on separately */
+        if (size < s->buf_end - s->buf_ptr) {
+            avio_write(s, buf, size);
+            return;
+        }
+        if (s->buf_ptr - s->buffer >= max_size)
+            flush_buffer(s);
+        if (s->buf_ptr > s->buffer) {
+            len = s->buf_ptr - s->buffer;
+            iov[n++] = (URLIOVec) { s->buffer, len };
+        }
+        /* no write may exceed max_packet_size */
+        chunk    = FFMIN(size, max_size - len);
+        iov[n++] = (URLIOVec) { buf, chunk };
+        len     += chunk;
+        buf     += chunk;
+        size    -= chunk;
+        writeout_update(s, len, s->error ? s->error :
+                        ffurl_write_vec(internal->h, iov, n));
+        s->buf_ptr = s->buf_ptr_max = s->buffer;
+    }
+}
+
 void avio_w8(AVIOContext *s, int b)
 {
     av_assert2(b>=-128 && b<=255);
@@ -222,6 +281,12 @@ void avio_write(AVIOContext *s, const unsigned char *buf, int size)
         writeout(s, buf, size);
         return;
     }
+    /* Data that does not fit into the buffer is passed on together with
+     * the buffered data instead of being copied in piecewise. */
+    if (size > s->buf_end - s->buf_ptr && can_write_vec(s)) {
+        writeout_vec(s, buf, size);
+        return;
+    }
     while (size > 0) {
         int len = FFMIN(s->buf_end - s->buf_ptr, size);
         memcpy(s->buf_ptr, buf, len);
@@ -24,16 +24,27 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "libavutil/timestamp.h"
 #include "avformat.h"
 #include "internal.h"
 #include "url.h"
 
+#if HAVE_THREADS
+#include <stdatomic.h>
+#endif
+
 typedef enum ConcatMatchMode {
     MATCH_ONE_TO_ONE,
     MATCH_EXACT_ID,
 } ConcatMatchMode;
 
+enum PrefetchState {
+    PREFETCH_NONE,
+    PREFETCH_BUSY,
+    PREFETCH_DONE,
+};
+
 typedef struct ConcatStream {
     AVBSFContext *bsf;
     int out_stream_index;
@@ -52,6 +63,8 @@ typedef struct {
     int64_t outpoint;
     AVDictionary *metadata;
     int nb_streams;
+    AVFormatContext *prefetched; ///< opened and probed by the prefetch thread
+    enum PrefetchState prefetch_state;
 } ConcatFile;
 
 typedef struct {
@@ -66,6 +79,18 @@ typedef struct {
     ConcatMatchMode stream_match_mode;
     unsigned auto_convert;
     int segment_time_metadata;
+    int lookahead;
+    int reuse_format;
+    AVInputFormat *iformat;     ///< format of the first file, if reuse_format
+#if HAVE_THREADS
+    pthread_t prefetch_thread;
+    pthread_mutex_t prefetch_mutex;
+    pthread_cond_t prefetch_cond;
+    int prefetch_running;
+    atomic_int prefetch_abort;
+    unsigned prefetch_start;    ///< first file the prefetch thread may open
+    unsigned prefetch_end;      ///< one past the last file it may open
+#endif
 } ConcatContext;
 
 static int concat_probe(AVProbeData *probe)
@@ -329,31 +354,255 @@ static int64_t get_best_effort_duration(ConcatFile *file, AVFormatContext *avf)
     return AV_NOPTS_VALUE;
 }
 
-static int open_file(AVFormatContext *avf, unsigned fileno)
+static int open_and_probe(AVFormatContext *avf, const char *url, AVInputFormat *fmt,
+                          const AVIOInterruptCB *icb, AVFormatContext **ps)
 {
-    ConcatContext *cat = avf->priv_data;
-    ConcatFile *file = &cat->files[fileno];
+    AVFormatContext *s;
     int ret;
 
-    if (cat->avf)
-        avformat_close_input(&cat->avf);
-
-    cat->avf = avformat_alloc_context();
-    if (!cat->avf)
+    if (!(s = avformat_alloc_context()))
         return AVERROR(ENOMEM);
 
-    cat->avf->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
-    cat->avf->interrupt_callback = avf->interrupt_callback;
+    s->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
+    s->interrupt_callback = *icb;
 
-    if ((ret = ff_copy_whiteblacklists(cat->avf, avf)) < 0)
+    if ((ret = ff_copy_whiteblacklists(s, avf)) < 0) {
+        avformat_free_context(s);
         return ret;
+    }
 
-    if ((ret = avformat_open_input(&cat->avf, file->url, NULL, NULL)) < 0 ||
-        (ret = avformat_find_stream_info(cat->avf, NULL)) < 0) {
-        av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
-        avformat_close_input(&cat->avf);
+    if ((ret = avformat_open_input(&s, url, fmt, NULL)) < 0) {
+        /* the file may not share the format of the first one after all */
+        if (fmt && ret != AVERROR_EXIT)
+            return open_and_probe(avf, url, NULL, icb, ps);
+        return ret;
+    }
+    if ((ret = avformat_find_stream_info(s, NULL)) < 0) {
+        avformat_close_input(&s);
         return ret;
     }
+    *ps = s;
+    return 0;
+}
+
+#if HAVE_THREADS
+static int prefetch_interrupt_cb(void *opaque)
+{
+    AVFormatContext *avf = opaque;
+    ConcatContext *cat = avf->priv_data;
+
+    return atomic_load(&cat->prefetch_abort) ||
+           ff_check_interrupt(&avf->interrupt_callback);
+}
+
+static void *prefetch_task(void *arg)
+{
+    AVFormatContext *avf = arg;
+    ConcatContext *cat = avf->priv_data;
+    AVIOInterruptCB icb = { prefetch_interrupt_cb, avf };
+
+    pthread_mutex_lock(&cat->prefetch_mutex);
+    while (!atomic_load(&cat->prefetch_abort)) {
+        ConcatFile *file = NULL;
+        AVFormatContext *s = NULL;
+        unsigned i;
+
+        for (i = cat->prefetch_start; i < cat->prefetch_end; i++) {
+            if (cat->files[i].prefetch_state == PREFETCH_NONE) {
+                file = &cat->files[i];
+                break;
+            }
+        }
+        if (!file) {
+            pthread_cond_wait(&cat->prefetch_cond, &cat->prefetch_mutex);
+            continue;
+        }
+
+        file->prefetch_state = PREFETCH_BUSY;
+        pthread_mutex_unlock(&cat->prefetch_mutex);
+
+        /* on failure the file is simply opened again when it is needed,
+         * so that errors are reported from the demuxing thread */
+        open_and_probe(avf, file->url, cat->iformat, &icb, &s);
+
+        pthread_mutex_lock(&cat->prefetch_mutex);
+        file->prefetched     = s;
+        file->prefetch_state = PREFETCH_DONE;
+        pthread_cond_broadcast(&cat->prefetch_cond);
+    }
+    pthread_mutex_unlock(&cat->prefetch_mutex);
+    return NULL;
+}
+
+static int prefetch_start(AVFormatContext *avf)
+{
+    ConcatContext *cat = avf->priv_data;
+    int ret;
+
+    atomic_init(&cat->prefetch_abort, 0);
+    cat->prefetch_start = cat->prefetch_end = 0;
+
+    if ((ret = pthread_mutex_init(&cat->prefetch_mutex, NULL))) {
+        av_log(avf, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", av_err2str(AVERROR(ret)));
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&cat->prefetch_cond, NULL))) {
+        av_log(avf, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", av_err2str(AVERROR(ret)));
+        pthread_mutex_destroy(&cat->prefetch_mutex);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_create(&cat->prefetch_thread, NULL, prefetch_task, avf))) {
+        av_log(avf, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&cat->prefetch_cond);
+        pthread_mutex_destroy(&cat->prefetch_mutex);
+        return AVERROR(ret);
+    }
+    cat->prefetch_running = 1;
+    return 0;
+}
+
+static void prefetch_stop(AVFormatContext *avf)
+{
+    ConcatContext *cat = avf->priv_data;
+    unsigned i;
+
+    if (!cat->prefetch_running)
+        return;
+
+    pthread_mutex_lock(&cat->prefetch_mutex);
+    atomic_store(&cat->prefetch_abort, 1);
+    pthread_cond_signal(&cat->prefetch_cond);
+    pthread_mutex_unlock(&cat->prefetch_mutex);
+    pthread_join(cat->prefetch_thread, NULL);
+
+    pthread_cond_destroy(&cat->prefetch_cond);
+    pthread_mutex_destroy(&cat->prefetch_mutex);
+    cat->prefetch_running = 0;
+
+    for (i = 0; i < cat->nb_files; i++) {
+        if (cat->files[i].prefetched)
+            avformat_close_input(&cat->files[i].prefetched);
+        cat->files[i].prefetch_state = PREFETCH_NONE;
+    }
+}
+
+/**
+ * Move the prefetch window to the files following fileno and drop the
+ * contexts which fell out of it, except the one of fileno.
+ * Must be called with prefetch_mutex held.
+ */
+static void prefetch_move_window(ConcatContext *cat, unsigned fileno)
+{
+    unsigned i;
+
+    cat->prefetch_start = fileno + 1;
+    cat->prefetch_end   = fileno + 1 + FFMIN(cat->lookahead, cat->nb_files - fileno - 1);
+    for (i = 0; i < cat->nb_files; i++) {
+        ConcatFile *f = &cat->files[i];
+        if (f->prefetch_state != PREFETCH_DONE || i == fileno ||
+            (i >= cat->prefetch_start && i < cat->prefetch_end))
+            continue;
+        if (f->prefetched)
+            avformat_close_input(&f->prefetched);
+        f->prefetch_state = PREFETCH_NONE;
+    }
+}
+
+/**
+ * Move the prefetch window to the files following fileno and return the
+ * context prefetched for fileno, if any. The caller owns the returned
+ * context.
+ */
+static AVFormatContext *prefetch_get(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatFile *file = &cat->files[fileno];
+    AVFormatContext *s = NULL;
+
+    if (!cat->prefetch_running)
+        return NULL;
+
+    pthread_mutex_lock(&cat->prefetch_mutex);
+    prefetch_move_window(cat, fileno);
+
+    while (file->prefetch_state == PREFETCH_BUSY)
+        pthread_cond_wait(&cat->prefetch_cond, &cat->prefetch_mutex);
+    if (file->prefetch_state == PREFETCH_DONE) {
+        s = file->prefetched;
+        if (s)
+            s->interrupt_callback = avf->interrupt_callback;
+        file->prefetched     = NULL;
+        file->prefetch_state = PREFETCH_NONE;
+    }
+    pthread_cond_signal(&cat->prefetch_cond);
+    pthread_mutex_unlock(&cat->prefetch_mutex);
+
+    return s;
+}
+
+/**
+ * Put the prefetch window back after fileno, whose context is already
+ * open, e.g. after a failed seek moved it elsewhere.
+ */
+static void prefetch_reset(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatFile *file = &cat->files[fileno];
+
+    if (!cat->prefetch_running)
+        return;
+
+    pthread_mutex_lock(&cat->prefetch_mutex);
+    prefetch_move_window(cat, fileno);
+    if (file->prefetch_state == PREFETCH_DONE) {
+        if (file->prefetched)
+            avformat_close_input(&file->prefetched);
+        file->prefetch_state = PREFETCH_NONE;
+    }
+    pthread_cond_signal(&cat->prefetch_cond);
+    pthread_mutex_unlock(&cat->prefetch_mutex);
+}
+#else
+static int prefetch_start(AVFormatContext *avf)
+{
+    av_log(avf, AV_LOG_WARNING, "lookahead requires threading support, ignoring it\n");
+    return 0;
+}
+
+static void prefetch_stop(AVFormatContext *avf)
+{
+}
+
+static AVFormatContext *prefetch_get(AVFormatContext *avf, unsigned fileno)
+{
+    return NULL;
+}
+
+static void prefetch_reset(AVFormatContext *avf, unsigned fileno)
+{
+}
+#endif
+
+static int open_file(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatFile *file = &cat->files[fileno];
+    int ret;
+
+    if (cat->avf)
+        avformat_close_input(&cat->avf);
+
+    cat->avf = prefetch_get(avf, fileno);
+    if (!cat->avf) {
+        ret = open_and_probe(avf, file->url, cat->iformat,
+                             &avf->interrupt_callback, &cat->avf);
+        if (ret < 0) {
+            av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
+            return ret;
+        }
+    }
+    if (cat->reuse_format && !cat->iformat)
+        cat->iformat = cat->avf->iformat;
     cat->cur_file = file;
     file->start_time = !fileno ? 0 :
                        cat->files[fileno - 1].start_time +
@@ -382,6 +631,7 @@ static int concat_read_close(AVFormatContext *avf)
     ConcatContext *cat = avf->priv_data;
     unsigned i, j;
 
+    prefetch_stop(avf);
     for (i = 0; i < cat->nb_files; i++) {
         av_freep(&cat->files[i].url);
         for (j = 0; j < cat->files[i].nb_streams; j++) {
@@ -514,6 +764,12 @@ static int concat_read_header(AVFormatContext *avf)
                                                MATCH_ONE_TO_ONE;
     if ((ret = open_file(avf, 0)) < 0)
         goto fail;
+    if (cat->lookahead > 0 && cat->nb_files > 1) {
+        if ((ret = prefetch_start(avf)) < 0)
+            goto fail;
+        /* only moves the window, the first file is already open */
+        prefetch_get(avf, 0);
+    }
     av_bprint_finalize(&bp, NULL);
     return 0;
 
@@ -752,6 +1008,7 @@ static int concat_seek(AVFormatContext *avf, int stream,
         }
         cat->avf      = cur_avf_saved;
         cat->cur_file = cur_file_saved;
+        prefetch_reset(avf, cat->cur_file - cat->files);
     } else {
         if (cat->cur_file != cur_file_saved) {
             avformat_close_input(&cur_avf_saved);
@@ -771,6 +1028,10 @@ static const AVOption options[] = {
       OFFSET(auto_convert), AV_OPT_TYPE_BOOL, {.i64 = 1}, 0, 1, DEC },
     { "segment_time_metadata", "output file segment start time and duration as packet metadata",
       OFFSET(segment_time_metadata), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
+    { "lookahead", "number of following files to open and probe in the background",
+      OFFSET(lookahead), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1024, DEC },
+    { "reuse_format", "assume all files have the container format of the first one",
+      OFFSET(reuse_format), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
     { NULL }
 };
 
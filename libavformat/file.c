@@ -19,6 +19,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _GNU_SOURCE /* O_DIRECT, syscall() */
+
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
@@ -34,7 +36,16 @@
 #include <unistd.h>
 #endif
 #include <sys/stat.h>
+#if HAVE_WRITEV
+#include <sys/uio.h>
+#endif
 #include <stdlib.h>
+#if HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -65,23 +76,88 @@
 #  endif
 #endif
 
+#if HAVE_IO_URING && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && \
+    defined(__NR_io_uring_register)
+#define FILE_IO_URING 1
+#else
+#define FILE_IO_URING 0
+#endif
+
+/* buffer and offset alignment required for O_DIRECT */
+#define DIRECT_ALIGN 4096
+
 /* standard file protocol */
 
+enum ChunkState {
+    CHUNK_FREE,
+    CHUNK_QUEUED,
+    CHUNK_DONE,
+};
+
+/**
+ * A request of the chunked I/O used with io_uring or O_DIRECT.
+ */
+typedef struct FileChunk {
+    uint8_t *data;          ///< DIRECT_ALIGN aligned
+    uint8_t *alloc;
+    int64_t pos;            ///< file offset of data[0]
+    int size;               ///< bytes requested, or filled for writes
+    int res;                ///< result of the completed request
+    int consumed;           ///< bytes already returned by reads
+    enum ChunkState state;
+} FileChunk;
+
+#if FILE_IO_URING
+typedef struct FileRing {
+    int fd;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map, *cq_map;
+    size_t sq_map_size, cq_map_size, sqes_size;
+    unsigned to_submit;
+} FileRing;
+#endif
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
     int trunc;
     int blocksize;
     int follow;
+    int io_uring;
+    int io_depth;
+    int io_size;
+    int o_direct;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
+
+    /* chunked I/O, used if chunks is not NULL */
+    FileChunk *chunks;
+    int nb_chunks;
+    int head;               ///< oldest read in flight, or chunk being filled
+    int nb_queued;          ///< reads queued from head on
+    int nb_inflight;
+    int write;
+    int direct;             ///< O_DIRECT currently set on fd
+    int64_t pos;            ///< logical position of the protocol
+    int64_t read_ahead_pos; ///< position of the next read to queue
+#if FILE_IO_URING
+    FileRing ring;
+    int use_ring;
+#endif
 } FileContext;
 
 static const AVOption file_options[] = {
     { "truncate", "truncate existing files on write", offsetof(FileContext, trunc), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "io_uring", "keep several requests in flight using io_uring", offsetof(FileContext, io_uring), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "io_depth", "set the number of io_uring requests in flight", offsetof(FileContext, io_depth), AV_OPT_TYPE_INT, { .i64 = 8 }, 1, 256, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "io_size", "set the size of each io_uring or O_DIRECT request", offsetof(FileContext, io_size), AV_OPT_TYPE_INT, { .i64 = 262144 }, DIRECT_ALIGN, 1 << 26, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "o_direct", "bypass the page cache when writing", offsetof(FileContext, o_direct), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
     { NULL }
 };
 
@@ -104,11 +180,381 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if FILE_IO_URING
+/**
+ * Check that the kernel supports the read and write opcodes. Kernels before
+ * 5.6 set up the ring but fail every such request with EINVAL, and also
+ * reject the probe itself.
+ */
+static int ring_probe(FileRing *r)
+{
+    struct io_uring_probe *probe;
+    int ret = 0;
+
+    probe = av_mallocz(sizeof(*probe) + 256 * sizeof(*probe->ops));
+    if (!probe)
+        return AVERROR(ENOMEM);
+    if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+        ret = AVERROR(errno);
+    else if (probe->last_op < FFMAX(IORING_OP_READ, IORING_OP_WRITE) ||
+             !(probe->ops[IORING_OP_READ].flags  & IO_URING_OP_SUPPORTED) ||
+             !(probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED))
+        ret = AVERROR(ENOSYS);
+    av_free(probe);
+    return ret;
+}
+
+static int ring_init(FileRing *r, unsigned entries)
+{
+    struct io_uring_params p = { 0 };
+    int fd, ret;
+
+    fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0)
+        return AVERROR(errno);
+    r->fd = fd;
+    if ((ret = ring_probe(r)) < 0)
+        return ret;
+
+    r->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_map_size = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_size   = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sq_map = mmap(NULL, r->sq_map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, IORING_OFF_SQ_RING);
+    r->cq_map = mmap(NULL, r->cq_map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, IORING_OFF_CQ_RING);
+    r->sqes   = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, IORING_OFF_SQES);
+    if (r->sq_map == MAP_FAILED || r->cq_map == MAP_FAILED ||
+        r->sqes == MAP_FAILED)
+        return AVERROR(errno);
+
+    r->sq_tail  = (unsigned *)((uint8_t *)r->sq_map + p.sq_off.tail);
+    r->sq_mask  = (unsigned *)((uint8_t *)r->sq_map + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)((uint8_t *)r->sq_map + p.sq_off.array);
+    r->cq_head  = (unsigned *)((uint8_t *)r->cq_map + p.cq_off.head);
+    r->cq_tail  = (unsigned *)((uint8_t *)r->cq_map + p.cq_off.tail);
+    r->cq_mask  = (unsigned *)((uint8_t *)r->cq_map + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)((uint8_t *)r->cq_map + p.cq_off.cqes);
+    return 0;
+}
+
+static void ring_free(FileRing *r)
+{
+    if (r->sq_map && r->sq_map != MAP_FAILED)
+        munmap(r->sq_map, r->sq_map_size);
+    if (r->cq_map && r->cq_map != MAP_FAILED)
+        munmap(r->cq_map, r->cq_map_size);
+    if (r->sqes && r->sqes != MAP_FAILED)
+        munmap(r->sqes, r->sqes_size);
+    if (r->fd > 0)
+        close(r->fd);
+    memset(r, 0, sizeof(*r));
+}
+
+/* The ring never holds more requests than chunks, so a slot is always free. */
+static void ring_queue(FileContext *c, int idx, int write)
+{
+    FileRing *r = &c->ring;
+    FileChunk *chunk = &c->chunks[idx];
+    unsigned tail = *r->sq_tail;
+    unsigned i = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[i];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd        = c->fd;
+    sqe->addr      = (uintptr_t)chunk->data;
+    sqe->len       = chunk->size;
+    sqe->off       = chunk->pos;
+    sqe->user_data = idx;
+    r->sq_array[i] = i;
+    atomic_store_explicit((atomic_uint *)r->sq_tail, tail + 1, memory_order_release);
+
+    r->to_submit++;
+    chunk->state = CHUNK_QUEUED;
+    c->nb_inflight++;
+}
+
+/**
+ * Submit the queued requests and collect the completed ones, waiting for
+ * at least min_complete of them.
+ */
+static int ring_reap(FileContext *c, int min_complete)
+{
+    FileRing *r = &c->ring;
+    unsigned head, tail;
+
+    while (r->to_submit || min_complete) {
+        int ret = syscall(__NR_io_uring_enter, r->fd, r->to_submit, min_complete,
+                          min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return AVERROR(errno);
+        }
+        r->to_submit -= FFMIN(ret, r->to_submit);
+        break;
+    }
+
+    head = *r->cq_head;
+    tail = atomic_load_explicit((atomic_uint *)r->cq_tail, memory_order_acquire);
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        FileChunk *chunk = &c->chunks[cqe->user_data];
+        chunk->res   = cqe->res;
+        chunk->state = CHUNK_DONE;
+        c->nb_inflight--;
+    }
+    atomic_store_explicit((atomic_uint *)r->cq_head, head, memory_order_release);
+    return 0;
+}
+#endif /* FILE_IO_URING */
+
+static int set_direct(FileContext *c, int direct)
+{
+#ifdef O_DIRECT
+    int flags = fcntl(c->fd, F_GETFL);
+
+    if (flags == -1 ||
+        fcntl(c->fd, F_SETFL, direct ? flags | O_DIRECT : flags & ~O_DIRECT) == -1)
+        return AVERROR(errno);
+    c->direct = direct;
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
+static int chunks_drain(FileContext *c)
+{
+#if FILE_IO_URING
+    while (c->nb_inflight > 0) {
+        int ret = ring_reap(c, 1);
+        if (ret < 0)
+            return ret;
+    }
+#endif
+    return 0;
+}
+
+static int pwrite_full(FileContext *c, const uint8_t *buf, int size, int64_t pos)
+{
+    while (size > 0) {
+        ssize_t ret = pwrite(c->fd, buf, size, pos);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return AVERROR(errno);
+        }
+        buf  += ret;
+        pos  += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+/**
+ * Check a completed write and write out what it left over.
+ */
+static int chunk_write_done(FileContext *c, FileChunk *chunk)
+{
+    int direct = c->direct;
+    int ret = chunk->res;
+
+    chunk->state = CHUNK_FREE;
+    if (ret < 0)
+        return ret;
+    if (ret < chunk->size) {
+        /* the rest is unlikely to be aligned */
+        if (direct && ((ret = chunks_drain(c)) < 0 || (ret = set_direct(c, 0)) < 0))
+            return ret;
+        ret = pwrite_full(c, chunk->data + chunk->res, chunk->size - chunk->res,
+                          chunk->pos + chunk->res);
+        if (ret < 0)
+            return ret;
+        if (direct && (ret = set_direct(c, 1)) < 0)
+            return ret;
+    }
+    return 0;
+}
+
+/**
+ * Write out the chunk being filled and move on to the next one.
+ */
+static int chunk_write_submit(FileContext *c)
+{
+    FileChunk *chunk = &c->chunks[c->head];
+    int aligned = !(chunk->pos % DIRECT_ALIGN) && !(chunk->size % DIRECT_ALIGN);
+    int ret;
+
+    if (!chunk->size)
+        return 0;
+
+    if (c->o_direct && aligned != c->direct) {
+        /* O_DIRECT needs aligned requests, drop it for the others */
+        if ((ret = chunks_drain(c)) < 0 || (ret = set_direct(c, aligned)) < 0)
+            return ret;
+    }
+#if FILE_IO_URING
+    if (c->use_ring) {
+        FileChunk *next;
+
+        ring_queue(c, c->head, 1);
+        c->head = (c->head + 1) % c->nb_chunks;
+        next    = &c->chunks[c->head];
+        while (next->state == CHUNK_QUEUED)
+            if ((ret = ring_reap(c, 1)) < 0)
+                return ret;
+        if (next->state == CHUNK_DONE && (ret = chunk_write_done(c, next)) < 0)
+            return ret;
+        /* completions of other chunks are checked when they come up again */
+        next->pos  = chunk->pos + chunk->size;
+        next->size = 0;
+        return 0;
+    }
+#endif
+    ret = pwrite_full(c, chunk->data, chunk->size, chunk->pos);
+    chunk->pos += chunk->size;
+    chunk->size = 0;
+    return ret;
+}
+
+/**
+ * Write out everything and wait for it to complete.
+ */
+static int chunks_flush(FileContext *c)
+{
+    int i, ret = 0;
+
+    if (c->write) {
+        int64_t pos = c->chunks[c->head].pos + c->chunks[c->head].size;
+        ret = chunk_write_submit(c);
+        if (ret >= 0)
+            ret = chunks_drain(c);
+        for (i = 0; i < c->nb_chunks && ret >= 0; i++)
+            if (c->chunks[i].state == CHUNK_DONE)
+                ret = chunk_write_done(c, &c->chunks[i]);
+        c->chunks[c->head].pos  = pos;
+        c->chunks[c->head].size = 0;
+    } else {
+        ret = chunks_drain(c);
+        for (i = 0; i < c->nb_chunks; i++)
+            c->chunks[i].state = CHUNK_FREE;
+        c->nb_queued = 0;
+    }
+    return ret;
+}
+
+static int chunks_read(URLContext *h, unsigned char *buf, int size)
+{
+#if FILE_IO_URING
+    FileContext *c = h->priv_data;
+    int len = 0, ret;
+
+    /* keep the queue full so the device always has work */
+    while (c->nb_queued < c->nb_chunks) {
+        int idx = (c->head + c->nb_queued) % c->nb_chunks;
+        FileChunk *chunk = &c->chunks[idx];
+
+        chunk->pos      = c->read_ahead_pos;
+        chunk->size     = c->io_size;
+        chunk->consumed = 0;
+        ring_queue(c, idx, 0);
+        c->read_ahead_pos += c->io_size;
+        c->nb_queued++;
+    }
+    if ((ret = ring_reap(c, 0)) < 0)
+        return ret;
+
+    while (len < size) {
+        FileChunk *chunk = &c->chunks[c->head];
+        int n;
+
+        if (chunk->state != CHUNK_DONE) {
+            if (len)
+                break;
+            if ((ret = ring_reap(c, 1)) < 0)
+                return ret;
+            continue;
+        }
+        if (chunk->res < 0) {
+            ret = chunk->res;
+            chunks_flush(c);
+            c->read_ahead_pos = c->pos;
+            return len ? len : ret;
+        }
+        if (chunk->res == chunk->consumed)
+            return len ? len : AVERROR_EOF;
+
+        n = FFMIN(size - len, chunk->res - chunk->consumed);
+        memcpy(buf + len, chunk->data + chunk->consumed, n);
+        chunk->consumed += n;
+        c->pos          += n;
+        len             += n;
+
+        if (chunk->consumed == chunk->size) {
+            chunk->state = CHUNK_FREE;
+            c->head = (c->head + 1) % c->nb_chunks;
+            c->nb_queued--;
+        } else if (chunk->consumed == chunk->res) {
+            /* short read, the following requests are misplaced */
+            if ((ret = chunks_flush(c)) < 0)
+                return ret;
+            c->read_ahead_pos = c->pos;
+            break;
+        }
+    }
+    return len;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
+static int chunks_write(URLContext *h, const unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    int len = 0;
+
+    while (len < size) {
+        FileChunk *chunk = &c->chunks[c->head];
+        int n = FFMIN(size - len, c->io_size - chunk->size);
+
+        memcpy(chunk->data + chunk->size, buf + len, n);
+        chunk->size += n;
+        c->pos      += n;
+        len         += n;
+        if (chunk->size == c->io_size) {
+            int ret = chunk_write_submit(c);
+            if (ret < 0)
+                return ret;
+        }
+    }
+    return len;
+}
+
+static void chunks_free(FileContext *c)
+{
+    int i;
+
+    for (i = 0; i < c->nb_chunks; i++)
+        av_freep(&c->chunks[i].alloc);
+    av_freep(&c->chunks);
+    c->nb_chunks = 0;
+#if FILE_IO_URING
+    if (c->use_ring)
+        ring_free(&c->ring);
+    c->use_ring = 0;
+#endif
+}
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (c->chunks)
+        return chunks_read(h, buf, size);
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -122,10 +568,32 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (c->chunks)
+        return chunks_write(h, buf, size);
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
 }
 
+#if HAVE_WRITEV
+static int file_write_vec(URLContext *h, const URLIOVec *vec, int nb_vec)
+{
+    FileContext *c = h->priv_data;
+    struct iovec iov[URL_MAX_IOVEC];
+    int i, size = 0, ret;
+
+    if (c->chunks)
+        return file_write(h, vec[0].data, vec[0].size);
+    nb_vec = FFMIN(nb_vec, URL_MAX_IOVEC);
+    for (i = 0; i < nb_vec && size < c->blocksize; i++) {
+        iov[i].iov_base = (void *)vec[i].data;
+        iov[i].iov_len  = FFMIN(vec[i].size, c->blocksize - size);
+        size += iov[i].iov_len;
+    }
+    ret = writev(c->fd, iov, i);
+    return (ret == -1) ? AVERROR(errno) : ret;
+}
+#endif
+
 static int file_get_handle(URLContext *h)
 {
     FileContext *c = h->priv_data;
@@ -203,6 +671,57 @@ static int file_move(URLContext *h_src, URLContext *h_dst)
 
 #if CONFIG_FILE_PROTOCOL
 
+static int file_open_chunks(URLContext *h, int flags)
+{
+    FileContext *c = h->priv_data;
+    int i, ret;
+
+    c->write = !!(flags & AVIO_FLAG_WRITE);
+    if (c->write && c->o_direct) {
+        c->io_size = FFALIGN(c->io_size, DIRECT_ALIGN);
+        if ((ret = set_direct(c, 1)) < 0) {
+            av_log(h, AV_LOG_WARNING, "Cannot use O_DIRECT: %s\n", av_err2str(ret));
+            c->o_direct = 0;
+        }
+    }
+#if FILE_IO_URING
+    if (c->io_uring && (c->write || !c->follow)) {
+        ret = ring_init(&c->ring, c->io_depth);
+        if (ret < 0) {
+            av_log(h, AV_LOG_WARNING, "io_uring unavailable (%s), "
+                   "falling back to synchronous I/O\n", av_err2str(ret));
+            ring_free(&c->ring);
+        } else {
+            c->use_ring = 1;
+        }
+    }
+    if (!c->use_ring && !(c->write && c->o_direct))
+        return 0;
+    c->nb_chunks = c->use_ring ? c->io_depth : 1;
+#else
+    if (c->io_uring)
+        av_log(h, AV_LOG_WARNING, "io_uring is not supported by this build\n");
+    if (!(c->write && c->o_direct))
+        return 0;
+    c->nb_chunks = 1;
+#endif
+
+    c->chunks = av_mallocz_array(c->nb_chunks, sizeof(*c->chunks));
+    if (!c->chunks)
+        goto fail;
+    for (i = 0; i < c->nb_chunks; i++) {
+        FileChunk *chunk = &c->chunks[i];
+        chunk->alloc = av_malloc(c->io_size + DIRECT_ALIGN);
+        if (!chunk->alloc)
+            goto fail;
+        chunk->data = (uint8_t *)FFALIGN((uintptr_t)chunk->alloc, DIRECT_ALIGN);
+    }
+    return 0;
+fail:
+    chunks_free(c);
+    return AVERROR(ENOMEM);
+}
+
 static int file_open(URLContext *h, const char *filename, int flags)
 {
     FileContext *c = h->priv_data;
@@ -238,6 +757,16 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (!h->is_streamed && flags & AVIO_FLAG_WRITE)
         h->min_packet_size = h->max_packet_size = 262144;
 
+    /* chunked I/O needs a regular file that is only read or only written */
+    if ((c->io_uring || c->o_direct) && !h->is_streamed && S_ISREG(st.st_mode) &&
+        (flags & AVIO_FLAG_READ_WRITE) != AVIO_FLAG_READ_WRITE) {
+        int ret = file_open_chunks(h, flags);
+        if (ret < 0) {
+            close(fd);
+            return ret;
+        }
+    }
+
     return 0;
 }
 
@@ -247,10 +776,36 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
-    if (whence == AVSEEK_SIZE) {
+    if (whence == AVSEEK_SIZE || (c->chunks && whence == SEEK_END)) {
         struct stat st;
+        /* pending writes must be on disk to get the correct size */
+        if (c->chunks && c->write && (ret = chunks_flush(c)) < 0)
+            return ret;
         ret = fstat(c->fd, &st);
-        return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
+        if (ret < 0)
+            return AVERROR(errno);
+        if (whence == AVSEEK_SIZE)
+            return S_ISFIFO(st.st_mode) ? 0 : st.st_size;
+        pos   += st.st_size;
+        whence = SEEK_SET;
+    }
+
+    if (c->chunks) {
+        /* all I/O uses explicit offsets, the fd position is not used */
+        if (whence == SEEK_CUR)
+            pos += c->pos;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        if (pos != c->pos) {
+            if ((ret = chunks_flush(c)) < 0)
+                return ret;
+            if (c->write)
+                c->chunks[c->head].pos = pos;
+            c->read_ahead_pos = c->pos = pos;
+        }
+        return pos;
     }
 
     ret = lseek(c->fd, pos, whence);
@@ -261,7 +816,15 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    return close(c->fd);
+    int ret = 0;
+
+    if (c->chunks) {
+        ret = chunks_flush(c);
+        chunks_free(c);
+    }
+    if (close(c->fd) < 0 && ret >= 0)
+        ret = AVERROR(errno);
+    return ret;
 }
 
 static int file_open_dir(URLContext *h)
@@ -353,6 +916,9 @@ const URLProtocol ff_file_protocol = {
     .url_open            = file_open,
     .url_read            = file_read,
     .url_write           = file_write,
+#if HAVE_WRITEV
+    .url_write_vec       = file_write_vec,
+#endif
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
@@ -399,6 +965,9 @@ const URLProtocol ff_pipe_protocol = {
     .url_open            = pipe_open,
     .url_read            = file_read,
     .url_write           = file_write,
+#if HAVE_WRITEV
+    .url_write_vec       = file_write_vec,
+#endif
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
     .priv_data_size      = sizeof(FileContext),
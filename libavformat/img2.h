@@ -61,6 +61,9 @@ typedef struct VideoDemuxData {
     int start_number_range;
     int frame_size;
     int ts_from_file;
+    int prefetch;           /**< Set by a private option. */
+    char **filenames;       /**< sequence pattern expanded up front, indexed from img_first */
+    struct ImgPrefetchContext *pf;
 } VideoDemuxData;
 
 typedef struct IdStrMap {
@@ -29,6 +29,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/thread.h"
 #include "libavcodec/gif.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -50,6 +51,9 @@
 
 #endif /* HAVE_GLOB */
 
+/* sequences longer than this are not expanded up front */
+#define MAX_EXPANDED_FILENAMES (1 << 18)
+
 static const int sizes[][2] = {
     { 640, 480 },
     { 720, 480 },
@@ -160,6 +164,336 @@ fail:
     return -1;
 }
 
+static int expand_sequence(VideoDemuxData *s, int first_index, int last_index)
+{
+    char buf[1024];
+    int i;
+
+    if (last_index - (int64_t)first_index >= MAX_EXPANDED_FILENAMES)
+        return 0;
+
+    s->filenames = av_mallocz_array(last_index - first_index + 1, sizeof(*s->filenames));
+    if (!s->filenames)
+        return AVERROR(ENOMEM);
+
+    for (i = first_index; i <= last_index; i++) {
+        /* a path without a number is only valid for the first image,
+         * leave the entry NULL otherwise like ff_img_read_packet() would */
+        if (av_get_frame_filename(buf, sizeof(buf), s->path, i) < 0 && i > 1)
+            continue;
+        s->filenames[i - first_index] = av_strdup(buf);
+        if (!s->filenames[i - first_index])
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+static void free_filenames(VideoDemuxData *s)
+{
+    int i;
+
+    if (!s->filenames)
+        return;
+    for (i = 0; i <= s->img_last - s->img_first; i++)
+        av_free(s->filenames[i]);
+    av_freep(&s->filenames);
+}
+
+static const char *img_filename(VideoDemuxData *s, int index, char *buf, int buf_size)
+{
+    if (s->pattern_type == PT_NONE)
+        return s->path;
+#if HAVE_GLOB
+    if (s->use_glob)
+        return s->globstate.gl_pathv[index];
+#endif
+    if (s->filenames && index >= s->img_first && index <= s->img_last)
+        return s->filenames[index - s->img_first];
+    if (av_get_frame_filename(buf, buf_size, s->path, index) < 0 && index > 1)
+        return NULL;
+    return buf;
+}
+
+static void probe_codec_id(AVCodecParameters *par, const uint8_t *buf, int buf_size,
+                           const char *filename)
+{
+    AVProbeData pd = { 0 };
+    AVInputFormat *ifmt;
+    int score = 0;
+
+    pd.buf      = (uint8_t *)buf;
+    pd.buf_size = buf_size;
+    pd.filename = filename;
+
+    ifmt = av_probe_input_format3(&pd, 1, &score);
+    if (ifmt && ifmt->read_packet == ff_img_read_packet && ifmt->raw_codec_id)
+        par->codec_id = ifmt->raw_codec_id;
+}
+
+#if HAVE_THREADS
+enum SlotState {
+    SLOT_EMPTY,
+    SLOT_BUSY,
+    SLOT_DONE,
+};
+
+typedef struct PrefetchSlot {
+    enum SlotState state;
+    unsigned generation;
+    int index;
+    int ret;
+    AVPacket pkt;
+} PrefetchSlot;
+
+typedef struct ImgPrefetchContext {
+    AVFormatContext *s1;
+    pthread_t *threads;
+    int nb_threads;
+    PrefetchSlot *slots;
+    int nb_slots;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned generation;    ///< bumped on seek, stale reads are discarded
+    int next_index;         ///< next image to be claimed by a worker
+    int abort;
+} ImgPrefetchContext;
+
+static int prefetch_read_file(AVFormatContext *s1, int index, AVPacket *pkt)
+{
+    VideoDemuxData *s = s1->priv_data;
+    char buf[1024];
+    const char *filename = img_filename(s, index, buf, sizeof(buf));
+    AVIOContext *pb = NULL;
+    int64_t size;
+    int ret;
+
+    if (!filename)
+        return AVERROR(EIO);
+
+    ret = s1->io_open(s1, &pb, filename, AVIO_FLAG_READ, NULL);
+    if (ret < 0) {
+        av_log(s1, AV_LOG_ERROR, "Could not open file : %s\n", filename);
+        return AVERROR(EIO);
+    }
+
+    size = avio_size(pb);
+    if (size < 0) {
+        ret = size;
+    } else if (size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+        ret = AVERROR(ERANGE);
+    } else {
+        ret = av_get_packet(pb, pkt, size);
+        if (!ret)
+            ret = AVERROR_EOF;
+    }
+    ff_format_io_close(s1, &pb);
+    if (ret < 0)
+        return ret;
+    pkt->pos = -1;
+
+    if (s->ts_from_file) {
+        struct stat img_stat;
+        if (stat(filename, &img_stat)) {
+            av_packet_unref(pkt);
+            return AVERROR(EIO);
+        }
+        pkt->pts = (int64_t)img_stat.st_mtime;
+#if HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+        if (s->ts_from_file == 2)
+            pkt->pts = 1000000000*pkt->pts + img_stat.st_mtim.tv_nsec;
+#endif
+    }
+    return 0;
+}
+
+static void *prefetch_worker(void *arg)
+{
+    ImgPrefetchContext *pf = arg;
+    VideoDemuxData *s = pf->s1->priv_data;
+
+    pthread_mutex_lock(&pf->mutex);
+    while (!pf->abort) {
+        PrefetchSlot *slot = NULL;
+        int i, ret;
+
+        if (pf->next_index <= s->img_last) {
+            for (i = 0; i < pf->nb_slots; i++) {
+                if (pf->slots[i].state == SLOT_EMPTY) {
+                    slot = &pf->slots[i];
+                    break;
+                }
+            }
+        }
+        if (!slot) {
+            pthread_cond_wait(&pf->cond, &pf->mutex);
+            continue;
+        }
+
+        slot->state      = SLOT_BUSY;
+        slot->generation = pf->generation;
+        slot->index      = pf->next_index++;
+        if (s->loop && pf->next_index > s->img_last)
+            pf->next_index = s->img_first;
+        pthread_mutex_unlock(&pf->mutex);
+
+        ret = prefetch_read_file(pf->s1, slot->index, &slot->pkt);
+
+        pthread_mutex_lock(&pf->mutex);
+        slot->ret = ret;
+        if (slot->generation != pf->generation) {
+            av_packet_unref(&slot->pkt);
+            slot->state = SLOT_EMPTY;
+        } else {
+            slot->state = SLOT_DONE;
+        }
+        pthread_cond_broadcast(&pf->cond);
+    }
+    pthread_mutex_unlock(&pf->mutex);
+    return NULL;
+}
+
+/* must be called with the mutex held */
+static void prefetch_flush(ImgPrefetchContext *pf, int index)
+{
+    int i;
+
+    pf->generation++;
+    for (i = 0; i < pf->nb_slots; i++) {
+        if (pf->slots[i].state == SLOT_DONE) {
+            av_packet_unref(&pf->slots[i].pkt);
+            pf->slots[i].state = SLOT_EMPTY;
+        }
+    }
+    pf->next_index = index;
+    pthread_cond_broadcast(&pf->cond);
+}
+
+static void prefetch_uninit(VideoDemuxData *s)
+{
+    ImgPrefetchContext *pf = s->pf;
+    int i;
+
+    if (!pf)
+        return;
+
+    pthread_mutex_lock(&pf->mutex);
+    pf->abort = 1;
+    pthread_cond_broadcast(&pf->cond);
+    pthread_mutex_unlock(&pf->mutex);
+
+    for (i = 0; i < pf->nb_threads; i++)
+        pthread_join(pf->threads[i], NULL);
+    for (i = 0; i < pf->nb_slots; i++)
+        av_packet_unref(&pf->slots[i].pkt);
+
+    pthread_cond_destroy(&pf->cond);
+    pthread_mutex_destroy(&pf->mutex);
+    av_freep(&pf->threads);
+    av_freep(&pf->slots);
+    av_freep(&s->pf);
+}
+
+static int prefetch_init(AVFormatContext *s1)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgPrefetchContext *pf;
+    int i, ret;
+
+    pf = s->pf = av_mallocz(sizeof(*pf));
+    if (!pf)
+        return AVERROR(ENOMEM);
+
+    pf->s1         = s1;
+    pf->next_index = s->img_number;
+    pf->nb_slots   = s->prefetch;
+    pf->slots      = av_mallocz_array(pf->nb_slots, sizeof(*pf->slots));
+    pf->threads    = av_mallocz_array(s->prefetch, sizeof(*pf->threads));
+    if (!pf->slots || !pf->threads) {
+        av_freep(&pf->slots);
+        av_freep(&pf->threads);
+        av_freep(&s->pf);
+        return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < pf->nb_slots; i++)
+        av_init_packet(&pf->slots[i].pkt);
+
+    pthread_mutex_init(&pf->mutex, NULL);
+    pthread_cond_init(&pf->cond, NULL);
+
+    for (i = 0; i < s->prefetch; i++) {
+        ret = pthread_create(&pf->threads[i], NULL, prefetch_worker, pf);
+        if (ret) {
+            av_log(s1, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(AVERROR(ret)));
+            prefetch_uninit(s);
+            return AVERROR(ret);
+        }
+        pf->nb_threads++;
+    }
+    return 0;
+}
+
+static int prefetch_read_packet(AVFormatContext *s1, AVPacket *pkt)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgPrefetchContext *pf = s->pf;
+    AVCodecParameters *par = s1->streams[0]->codecpar;
+    PrefetchSlot *slot;
+    int i, ret;
+
+    pthread_mutex_lock(&pf->mutex);
+    for (;;) {
+        slot = NULL;
+        for (i = 0; i < pf->nb_slots; i++) {
+            if (pf->slots[i].state != SLOT_EMPTY &&
+                pf->slots[i].generation == pf->generation &&
+                pf->slots[i].index == s->img_number) {
+                slot = &pf->slots[i];
+                break;
+            }
+        }
+        if (slot && slot->state == SLOT_DONE)
+            break;
+        /* a failed read is retried from scratch */
+        if (!slot && pf->next_index != s->img_number)
+            prefetch_flush(pf, s->img_number);
+        pthread_cond_wait(&pf->cond, &pf->mutex);
+    }
+    ret = slot->ret;
+    av_packet_move_ref(pkt, &slot->pkt);
+    slot->state = SLOT_EMPTY;
+    pthread_cond_broadcast(&pf->cond);
+    pthread_mutex_unlock(&pf->mutex);
+
+    if (ret < 0)
+        return ret;
+
+    if (par->codec_id == AV_CODEC_ID_NONE) {
+        uint8_t header[PROBE_BUF_MIN + AVPROBE_PADDING_SIZE];
+        char buf[1024];
+        const char *filename = img_filename(s, s->img_number, buf, sizeof(buf));
+        int size = FFMIN(pkt->size, PROBE_BUF_MIN);
+
+        memcpy(header, pkt->data, size);
+        memset(header + size, 0, sizeof(header) - size);
+        probe_codec_id(par, header, size, filename);
+    }
+    if (par->codec_id == AV_CODEC_ID_RAWVIDEO && !par->width)
+        infer_size(&par->width, &par->height, pkt->size);
+
+    pkt->stream_index = 0;
+    pkt->flags       |= AV_PKT_FLAG_KEY;
+    if (s->ts_from_file)
+        av_add_index_entry(s1->streams[0], s->img_number, pkt->pts, 0, 0, AVINDEX_KEYFRAME);
+    else
+        pkt->pts = s->pts;
+
+    s->img_count++;
+    s->img_number++;
+    s->pts++;
+    return 0;
+}
+#endif
+
 static int img_read_probe(AVProbeData *p)
 {
     if (p->filename && ff_guess_image2_codec(p->filename)) {
@@ -271,6 +605,7 @@ int ff_img_read_header(AVFormatContext *s1)
         }
         }
         if ((s->pattern_type == PT_GLOB_SEQUENCE && !s->use_glob) || s->pattern_type == PT_SEQUENCE) {
+            int ret;
             if (find_image_range(s1->pb, &first_index, &last_index, s->path,
                                  s->start_number, s->start_number_range) < 0) {
                 av_log(s1, AV_LOG_ERROR,
@@ -278,6 +613,14 @@ int ff_img_read_header(AVFormatContext *s1)
                        s->path, s->start_number, s->start_number + s->start_number_range - 1);
                 return AVERROR(ENOENT);
             }
+            /* the names are only looked up repeatedly by the prefetch */
+            if (s->prefetch > 0 && !s->is_pipe && !s1->pb && !s->split_planes &&
+                (ret = expand_sequence(s, first_index, last_index)) < 0) {
+                s->img_first = first_index;
+                s->img_last  = last_index;
+                free_filenames(s);
+                return ret;
+            }
         } else if (s->pattern_type == PT_GLOB) {
 #if HAVE_GLOB
             int gerr;
@@ -370,6 +713,19 @@ int ff_img_read_header(AVFormatContext *s1)
         pix_fmt != AV_PIX_FMT_NONE)
         st->codecpar->format = pix_fmt;
 
+    if (s->prefetch > 0 && !s->is_pipe && !s1->pb &&
+        s->pattern_type != PT_NONE && !s->split_planes) {
+#if HAVE_THREADS
+        int ret = prefetch_init(s1);
+        if (ret < 0) {
+            free_filenames(s);
+            return ret;
+        }
+#else
+        av_log(s1, AV_LOG_WARNING, "prefetch requires threading support, ignoring it\n");
+#endif
+    }
+
     return 0;
 }
 
@@ -390,12 +746,21 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
         if (s->img_number > s->img_last)
             return AVERROR_EOF;
+#if HAVE_THREADS
+        if (s->pf)
+            return prefetch_read_packet(s1, pkt);
+#endif
         if (s->pattern_type == PT_NONE) {
             av_strlcpy(filename_bytes, s->path, sizeof(filename_bytes));
         } else if (s->use_glob) {
 #if HAVE_GLOB
             filename = s->globstate.gl_pathv[s->img_number];
 #endif
+        } else if (s->filenames) {
+            const char *name = s->filenames[s->img_number - s->img_first];
+            if (!name)
+                return AVERROR(EIO);
+            av_strlcpy(filename_bytes, name, sizeof(filename_bytes));
         } else {
         if (av_get_frame_filename(filename_bytes, sizeof(filename_bytes),
                                   s->path,
@@ -423,24 +788,15 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
 
         if (par->codec_id == AV_CODEC_ID_NONE) {
-            AVProbeData pd = { 0 };
-            AVInputFormat *ifmt;
             uint8_t header[PROBE_BUF_MIN + AVPROBE_PADDING_SIZE];
             int ret;
-            int score = 0;
 
             ret = avio_read(f[0], header, PROBE_BUF_MIN);
             if (ret < 0)
                 return ret;
             memset(header + ret, 0, sizeof(header) - ret);
             avio_skip(f[0], -ret);
-            pd.buf = header;
-            pd.buf_size = ret;
-            pd.filename = filename;
-
-            ifmt = av_probe_input_format3(&pd, 1, &score);
-            if (ifmt && ifmt->read_packet == ff_img_read_packet && ifmt->raw_codec_id)
-                par->codec_id = ifmt->raw_codec_id;
+            probe_codec_id(par, header, ret, filename);
         }
 
         if (par->codec_id == AV_CODEC_ID_RAWVIDEO && !par->width)
@@ -533,8 +889,12 @@ fail:
 
 static int img_read_close(struct AVFormatContext* s1)
 {
-#if HAVE_GLOB
     VideoDemuxData *s = s1->priv_data;
+#if HAVE_THREADS
+    prefetch_uninit(s);
+#endif
+    free_filenames(s);
+#if HAVE_GLOB
     if (s->use_glob) {
         globfree(&s->globstate);
     }
@@ -552,13 +912,20 @@ static int img_read_seek(AVFormatContext *s, int stream_index, int64_t timestamp
         if(index < 0)
             return -1;
         s1->img_number = st->index_entries[index].pos;
-        return 0;
+    } else {
+        if (timestamp < 0 || !s1->loop && timestamp > s1->img_last - s1->img_first)
+            return -1;
+        s1->img_number = timestamp%(s1->img_last - s1->img_first + 1) + s1->img_first;
+        s1->pts = timestamp;
     }
 
-    if (timestamp < 0 || !s1->loop && timestamp > s1->img_last - s1->img_first)
-        return -1;
-    s1->img_number = timestamp%(s1->img_last - s1->img_first + 1) + s1->img_first;
-    s1->pts = timestamp;
+#if HAVE_THREADS
+    if (s1->pf) {
+        pthread_mutex_lock(&s1->pf->mutex);
+        prefetch_flush(s1->pf, s1->img_number);
+        pthread_mutex_unlock(&s1->pf->mutex);
+    }
+#endif
     return 0;
 }
 
@@ -583,6 +950,7 @@ const AVOption ff_img_options[] = {
     { "none", "none",                   0, AV_OPT_TYPE_CONST,    {.i64 = 0   }, 0, 2,       DEC, "ts_type" },
     { "sec",  "second precision",       0, AV_OPT_TYPE_CONST,    {.i64 = 1   }, 0, 2,       DEC, "ts_type" },
     { "ns",   "nano second precision",  0, AV_OPT_TYPE_CONST,    {.i64 = 2   }, 0, 2,       DEC, "ts_type" },
+    { "prefetch",     "number of files to read ahead in parallel threads", OFFSET(prefetch), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 256, DEC },
     { NULL },
 };
 
@@ -70,6 +70,39 @@ struct AVFormatInternal {
      */
     int nb_interleaved_streams;
 
+    /**
+     * Min-heap of the indices of the streams with packets queued for
+     * interleaving, ordered by the first queued packet of each stream.
+     * It replaces packet_buffer in ff_interleave_packet_per_dts() when the
+     * muxer does no interleaving of its own and chunking is disabled.
+     * Muxing only.
+     */
+    int *interleave_heap;
+    int nb_interleave_heap;
+    int use_interleave_heap;
+
+    /**
+     * Number of streams which count as not interleaved while they have no
+     * packet queued, and how many of them currently do have one.
+     * Muxing only.
+     */
+    int nb_noninterleaved_candidates;
+    int nb_queued_candidates;
+
+    /**
+     * Largest dts in AV_TIME_BASE_Q of the last queued packet of any
+     * stream, and the index of that stream. Muxing only.
+     */
+    int64_t interleave_max_dts;
+    int interleave_max_dts_stream;
+
+    /**
+     * Number of packets queued for interleaving and its high-water mark.
+     * Muxing only.
+     */
+    int interleave_queue_size;
+    int interleave_queue_peak;
+
     /**
      * This buffer is only needed when packets were already buffered but
      * not decoded, for example to get the codec parameters in MPEG
@@ -192,6 +225,13 @@ struct AVStreamInternal {
     int need_context_update;
 
     FFFrac *priv_pts;
+
+    /**
+     * First packet queued for interleaving, the last one is
+     * AVStream.last_in_packet_buffer. Only used with
+     * AVFormatInternal.interleave_heap.
+     */
+    struct AVPacketList *interleave_head;
 };
 
 #ifdef __GNUC__
@@ -145,6 +145,8 @@ typedef struct MatroskaMuxContext {
     int have_video;
 
     int reserve_cues_space;
+    int cues_space_estimated;
+    int direct_clusters;
     int cluster_size_limit;
     int64_t cues_pos;
     int64_t cluster_time_limit;
@@ -574,10 +576,11 @@ static int mkv_add_cuepoint(mkv_cues *cues, int stream, int tracknum, int64_t ts
     return 0;
 }
 
-static int64_t mkv_write_cues(AVFormatContext *s, mkv_cues *cues, mkv_track *tracks, int num_tracks)
+static int64_t mkv_write_cues(AVFormatContext *s, AVIOContext *pb, mkv_cues *cues,
+                              mkv_track *tracks, int num_tracks)
 {
     MatroskaMuxContext *mkv = s->priv_data;
-    AVIOContext *dyn_cp, *pb = s->pb;
+    AVIOContext *dyn_cp;
     ebml_master cues_element;
     int64_t currentpos;
     int i, j, ret;
@@ -634,6 +637,107 @@ static int64_t mkv_write_cues(AVFormatContext *s, mkv_cues *cues, mkv_track *tra
     return currentpos;
 }
 
+/**
+ * Size of the Cues element mkv_write_cues() would write to the output.
+ */
+static int64_t mkv_cues_size(AVFormatContext *s)
+{
+    MatroskaMuxContext *mkv = s->priv_data;
+    AVIOContext *pb;
+    int64_t ret;
+
+    if ((ret = ffio_open_null_buf(&pb)) < 0)
+        return ret;
+    ret = mkv_write_cues(s, pb, mkv->cues, mkv->tracks, s->nb_streams);
+    ret = ret < 0 ? ret : ffio_close_null_buf(pb);
+    if (ret < 0)
+        return ret;
+    /* a CRC32 element is only written to seekable outputs */
+    if (mkv->write_crc && mkv->mode != MODE_WEBM)
+        ret += 6;
+    return ret;
+}
+
+/**
+ * Estimate the number of keyframes of a video stream, each of which
+ * gets a cue, from its frame rate and keyframe interval.
+ *
+ * There is no keyframe interval in AVCodecParameters, it is read from the
+ * deprecated AVStream.codec. That holds the encoder's gop_size when ffmpeg
+ * encodes the stream and the default of 12 otherwise. Once AVStream.codec
+ * is removed, every frame is counted as a keyframe, which overestimates
+ * the cues of inter-coded video.
+ *
+ * @return the number of keyframes, or -1 if the frame rate is unknown
+ */
+static int64_t mkv_estimate_keyframes(AVStream *st, double duration)
+{
+    const AVCodecDescriptor *desc = avcodec_descriptor_get(st->codecpar->codec_id);
+    AVRational rate = st->avg_frame_rate;
+    int keyint = 1;
+
+    if (!rate.num || !rate.den)
+        rate = st->r_frame_rate;
+#if FF_API_LAVF_AVCTX
+FF_DISABLE_DEPRECATION_WARNINGS
+    if ((!rate.num || !rate.den) && st->codec->time_base.num)
+        rate = av_inv_q(st->codec->time_base);
+    /* filled from the encoder context by the ffmpeg tool */
+    if (!(desc && (desc->props & AV_CODEC_PROP_INTRA_ONLY)) &&
+        st->codec->gop_size > 0)
+        keyint = st->codec->gop_size;
+FF_ENABLE_DEPRECATION_WARNINGS
+#endif
+    if (!rate.num || !rate.den)
+        return -1;
+
+    return ceil(duration * av_q2d(rate) / keyint);
+}
+
+/**
+ * Estimate the space needed for the cues from the stream durations:
+ * one CuePoint per keyframe for video and one per second for subtitles.
+ *
+ * @return the number of bytes to reserve, 0 if they cannot be estimated
+ */
+static int mkv_estimate_cues_space(AVFormatContext *s)
+{
+    int64_t entries = 0;
+    int i;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        AVCodecParameters *par = st->codecpar;
+        double duration;
+
+        if (par->codec_type != AVMEDIA_TYPE_VIDEO &&
+            par->codec_type != AVMEDIA_TYPE_SUBTITLE)
+            continue;
+        if (st->duration <= 0) {
+            av_log(s, AV_LOG_WARNING, "Duration of stream %d unknown, "
+                   "not reserving space for the cues.\n", i);
+            return 0;
+        }
+        duration = st->duration * av_q2d(st->time_base);
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+            int64_t keyframes = mkv_estimate_keyframes(st, duration);
+            if (keyframes < 0) {
+                av_log(s, AV_LOG_WARNING, "Frame rate of stream %d unknown, "
+                       "not reserving space for the cues.\n", i);
+                return 0;
+            }
+            entries += keyframes;
+        } else {
+            entries += ceil(duration);
+        }
+    }
+    if (!entries)
+        return 0;
+
+    /* Cues header and CRC32, and each CuePoint with its header */
+    return FFMIN(18 + entries * (MAX_CUEPOINT_SIZE(1) + 4), INT_MAX);
+}
+
 static int put_xiph_codecpriv(AVFormatContext *s, AVIOContext *pb, AVCodecParameters *par)
 {
     const uint8_t *header_start[3];
@@ -2257,12 +2361,76 @@ static int mkv_write_vtt_blocks(AVFormatContext *s, AVIOContext *pb, AVPacket *p
     return pkt->duration;
 }
 
-static void mkv_start_new_cluster(AVFormatContext *s, AVPacket *pkt)
+static int mkv_cluster_has_crc(AVFormatContext *s)
 {
     MatroskaMuxContext *mkv = s->priv_data;
 
-    end_ebml_master_crc32(s->pb, &mkv->dyn_bc, mkv, mkv->cluster);
+    return (s->pb->seekable & AVIO_SEEKABLE_NORMAL) &&
+           mkv->write_crc && mkv->mode != MODE_WEBM;
+}
+
+static int mkv_start_cluster(AVFormatContext *s, int64_t ts)
+{
+    MatroskaMuxContext *mkv = s->priv_data;
+    int ret;
+
+    mkv->cluster_pos = avio_tell(s->pb);
+    if (mkv->direct_clusters) {
+        /* On unseekable outputs the cluster keeps its unknown size. */
+        mkv->cluster = start_ebml_master(s->pb, MATROSKA_ID_CLUSTER, 0);
+        if (mkv_cluster_has_crc(s)) {
+            put_ebml_void(s->pb, 6);
+            ffio_init_checksum(s->pb, ff_crcEDB88320_update, UINT32_MAX);
+        }
+        put_ebml_uint(s->pb, MATROSKA_ID_CLUSTERTIMECODE, FFMAX(0, ts));
+    } else {
+        ret = start_ebml_master_crc32(s->pb, &mkv->dyn_bc, mkv, &mkv->cluster, MATROSKA_ID_CLUSTER, 0);
+        if (ret < 0)
+            return ret;
+        put_ebml_uint(mkv->dyn_bc, MATROSKA_ID_CLUSTERTIMECODE, FFMAX(0, ts));
+    }
+    mkv->cluster_pts = FFMAX(0, ts);
+
+    return 0;
+}
+
+static void mkv_end_cluster(AVFormatContext *s)
+{
+    MatroskaMuxContext *mkv = s->priv_data;
+
+    if (!mkv->direct_clusters) {
+        if (mkv->dyn_bc)
+            end_ebml_master_crc32(s->pb, &mkv->dyn_bc, mkv, mkv->cluster);
+    } else if (s->pb->seekable & AVIO_SEEKABLE_NORMAL) {
+        if (mkv_cluster_has_crc(s)) {
+            uint8_t crc[4];
+            int64_t pos;
+
+            AV_WL32(crc, ffio_get_checksum(s->pb) ^ UINT32_MAX);
+            pos = avio_tell(s->pb);
+            avio_seek(s->pb, mkv->cluster.pos, SEEK_SET);
+            put_ebml_binary(s->pb, EBML_ID_CRC32, crc, sizeof(crc));
+            avio_seek(s->pb, pos, SEEK_SET);
+        }
+        end_ebml_master(s->pb, mkv->cluster);
+    }
     mkv->cluster_pos = -1;
+}
+
+/**
+ * Whether writing the packet needs a BlockGroup, whose size has to be
+ * filled in by seeking back once it is written.
+ */
+static int mkv_needs_blockgroup(AVCodecParameters *par, AVPacket *pkt)
+{
+    return par->codec_type == AVMEDIA_TYPE_SUBTITLE ||
+           av_packet_get_side_data(pkt, AV_PKT_DATA_SKIP_SAMPLES, NULL) ||
+           av_packet_get_side_data(pkt, AV_PKT_DATA_MATROSKA_BLOCKADDITIONAL, NULL);
+}
+
+static void mkv_start_new_cluster(AVFormatContext *s, AVPacket *pkt)
+{
+    mkv_end_cluster(s);
     if (s->pb->seekable & AVIO_SEEKABLE_NORMAL)
         av_log(s, AV_LOG_DEBUG,
                "Starting new cluster at offset %" PRIu64 " bytes, "
@@ -2394,6 +2562,7 @@ static int mkv_write_packet_internal(AVFormatContext *s, AVPacket *pkt, int add_
     int64_t ts = mkv->tracks[pkt->stream_index].write_dts ? pkt->dts : pkt->pts;
     int64_t relative_packet_pos;
     int dash_tracknum = mkv->is_dash ? mkv->dash_track_number : pkt->stream_index + 1;
+    AVIOContext *group_bc = NULL;
 
     if (ts == AV_NOPTS_VALUE) {
         av_log(s, AV_LOG_ERROR, "Can't write packet with unknown timestamp\n");
@@ -2410,22 +2579,31 @@ static int mkv_write_packet_internal(AVFormatContext *s, AVPacket *pkt, int add_
     }
 
     if (mkv->cluster_pos == -1) {
-        mkv->cluster_pos = avio_tell(s->pb);
-        ret = start_ebml_master_crc32(s->pb, &mkv->dyn_bc, mkv, &mkv->cluster, MATROSKA_ID_CLUSTER, 0);
+        ret = mkv_start_cluster(s, ts);
         if (ret < 0)
             return ret;
-        put_ebml_uint(mkv->dyn_bc, MATROSKA_ID_CLUSTERTIMECODE, FFMAX(0, ts));
-        mkv->cluster_pts = FFMAX(0, ts);
     }
-    pb = mkv->dyn_bc;
 
-    relative_packet_pos = avio_tell(pb);
+    if (mkv->direct_clusters) {
+        relative_packet_pos = avio_tell(s->pb) - mkv->cluster.pos;
+        /* Seeking back in the output would break the cluster CRC or fail,
+         * so block groups are still assembled in memory. */
+        if (mkv_needs_blockgroup(par, pkt)) {
+            if ((ret = avio_open_dyn_buf(&group_bc)) < 0)
+                return ret;
+            pb = group_bc;
+        }
+    } else {
+        pb = mkv->dyn_bc;
+        relative_packet_pos = avio_tell(pb);
+    }
 
     if (par->codec_type != AVMEDIA_TYPE_SUBTITLE) {
         mkv_write_block(s, pb, MATROSKA_ID_SIMPLEBLOCK, pkt, keyframe);
         if ((s->pb->seekable & AVIO_SEEKABLE_NORMAL) && (par->codec_type == AVMEDIA_TYPE_VIDEO && keyframe || add_cue)) {
             ret = mkv_add_cuepoint(mkv->cues, pkt->stream_index, dash_tracknum, ts, mkv->cluster_pos, relative_packet_pos, -1);
-            if (ret < 0) return ret;
+            if (ret < 0)
+                goto fail;
         }
     } else {
         if (par->codec_id == AV_CODEC_ID_WEBVTT) {
@@ -2452,7 +2630,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
             ret = mkv_add_cuepoint(mkv->cues, pkt->stream_index, dash_tracknum, ts,
                                    mkv->cluster_pos, relative_packet_pos, duration);
             if (ret < 0)
-                return ret;
+                goto fail;
         }
     }
 
@@ -2462,7 +2640,16 @@ FF_ENABLE_DEPRECATION_WARNINGS
         mkv->stream_durations[pkt->stream_index] =
             FFMAX(mkv->stream_durations[pkt->stream_index], ts + duration);
 
-    return 0;
+    ret = 0;
+fail:
+    if (group_bc) {
+        uint8_t *buf;
+        int size = avio_close_dyn_buf(group_bc, &buf);
+        if (ret >= 0)
+            avio_write(s->pb, buf, size);
+        av_free(buf);
+    }
+    return ret;
 }
 
 static int mkv_write_packet(AVFormatContext *s, AVPacket *pkt)
@@ -2487,7 +2674,10 @@ static int mkv_write_packet(AVFormatContext *s, AVPacket *pkt)
 
     // start a new cluster every 5 MB or 5 sec, or 32k / 1 sec for streaming or
     // after 4k and on a keyframe
-    cluster_size = avio_tell(mkv->dyn_bc);
+    if (mkv->direct_clusters)
+        cluster_size = mkv->cluster_pos != -1 ? avio_tell(s->pb) - mkv->cluster.pos : 0;
+    else
+        cluster_size = avio_tell(mkv->dyn_bc);
 
     if (mkv->is_dash && codec_type == AVMEDIA_TYPE_VIDEO) {
         // WebM DASH specification states that the first block of every cluster
@@ -2546,8 +2736,7 @@ static int mkv_write_flush_packet(AVFormatContext *s, AVPacket *pkt)
 
     if (!pkt) {
         if (mkv->cluster_pos != -1) {
-            end_ebml_master_crc32(s->pb, &mkv->dyn_bc, mkv, mkv->cluster);
-            mkv->cluster_pos = -1;
+            mkv_end_cluster(s);
             if (s->pb->seekable & AVIO_SEEKABLE_NORMAL)
                 av_log(s, AV_LOG_DEBUG,
                        "Flushing cluster at offset %" PRIu64 " bytes\n",
@@ -2579,9 +2768,8 @@ static int mkv_write_trailer(AVFormatContext *s)
         }
     }
 
-    if (mkv->dyn_bc) {
-        end_ebml_master_crc32(pb, &mkv->dyn_bc, mkv, mkv->cluster);
-    }
+    if (mkv->cluster_pos != -1)
+        mkv_end_cluster(s);
 
     ret = mkv_write_chapters(s);
     if (ret < 0)
@@ -2590,13 +2778,27 @@ static int mkv_write_trailer(AVFormatContext *s)
 
     if ((pb->seekable & AVIO_SEEKABLE_NORMAL) && !mkv->is_live) {
         if (mkv->cues->num_entries) {
-            if (mkv->reserve_cues_space) {
+            int reserved = mkv->reserve_cues_space;
+
+            if (reserved && mkv->cues_space_estimated) {
+                int64_t size = mkv_cues_size(s);
+                if (size < 0)
+                    return size;
+                if (size > reserved || size == reserved - 1) {
+                    av_log(s, AV_LOG_WARNING,
+                           "Estimated space for cues too small: %d "
+                           "(needed: %" PRId64 "), writing them at the end.\n",
+                           reserved, size);
+                    reserved = 0;
+                }
+            }
+            if (reserved) {
                 int64_t cues_end;
 
                 currentpos = avio_tell(pb);
                 avio_seek(pb, mkv->cues_pos, SEEK_SET);
 
-                cuespos  = mkv_write_cues(s, mkv->cues, mkv->tracks, s->nb_streams);
+                cuespos  = mkv_write_cues(s, pb, mkv->cues, mkv->tracks, s->nb_streams);
                 cues_end = avio_tell(pb);
                 if (cues_end > cuespos + mkv->reserve_cues_space) {
                     av_log(s, AV_LOG_ERROR,
@@ -2612,7 +2814,7 @@ static int mkv_write_trailer(AVFormatContext *s)
 
                 avio_seek(pb, currentpos, SEEK_SET);
             } else {
-                cuespos = mkv_write_cues(s, mkv->cues, mkv->tracks, s->nb_streams);
+                cuespos = mkv_write_cues(s, pb, mkv->cues, mkv->tracks, s->nb_streams);
             }
 
             ret = mkv_add_seekhead_entry(mkv->main_seekhead, MATROSKA_ID_CUES,
@@ -2705,6 +2907,7 @@ static int webm_query_codec(enum AVCodecID codec_id, int std_compliance)
 
 static int mkv_init(struct AVFormatContext *s)
 {
+    MatroskaMuxContext *mkv = s->priv_data;
     int i;
 
     if (s->nb_streams > MAX_TRACKS) {
@@ -2733,6 +2936,12 @@ static int mkv_init(struct AVFormatContext *s)
         s->internal->avoid_negative_ts_use_pts = 1;
     }
 
+    // the stream durations are still in the caller's time bases here
+    if (mkv->reserve_cues_space < 0) {
+        mkv->reserve_cues_space   = mkv_estimate_cues_space(s);
+        mkv->cues_space_estimated = 1;
+    }
+
     for (i = 0; i < s->nb_streams; i++) {
         // ms precision is the de-facto standard timescale for mkv files
         avpriv_set_pts_info(s->streams[i], 64, 1, 1000);
@@ -2788,7 +2997,8 @@ static const AVCodecTag additional_subtitle_tags[] = {
 #define OFFSET(x) offsetof(MatroskaMuxContext, x)
 #define FLAGS AV_OPT_FLAG_ENCODING_PARAM
 static const AVOption options[] = {
-    { "reserve_index_space", "Reserve a given amount of space (in bytes) at the beginning of the file for the index (cues).", OFFSET(reserve_cues_space), AV_OPT_TYPE_INT,   { .i64 = 0 },   0, INT_MAX,   FLAGS },
+    { "reserve_index_space", "Reserve a given amount of space (in bytes) at the beginning of the file for the index (cues).", OFFSET(reserve_cues_space), AV_OPT_TYPE_INT,   { .i64 = 0 },  -1, INT_MAX,   FLAGS, "reserve_index_space" },
+    { "auto", "estimate the space from the stream durations", 0, AV_OPT_TYPE_CONST, { .i64 = -1 }, 0, 0, FLAGS, "reserve_index_space" },
     { "cluster_size_limit",  "Store at most the provided amount of bytes in a cluster. ",                                     OFFSET(cluster_size_limit), AV_OPT_TYPE_INT  , { .i64 = -1 }, -1, INT_MAX,   FLAGS },
     { "cluster_time_limit",  "Store at most the provided number of milliseconds in a cluster.",                               OFFSET(cluster_time_limit), AV_OPT_TYPE_INT64, { .i64 = -1 }, -1, INT64_MAX, FLAGS },
     { "dash", "Create a WebM file conforming to WebM DASH specification", OFFSET(is_dash), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
@@ -2796,6 +3006,7 @@ static const AVOption options[] = {
     { "live", "Write files assuming it is a live stream.", OFFSET(is_live), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
     { "allow_raw_vfw", "allow RAW VFW mode", OFFSET(allow_raw_vfw), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
     { "write_crc32", "write a CRC32 element inside every Level 1 element", OFFSET(write_crc), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, FLAGS },
+    { "direct_clusters", "write clusters directly to the output instead of buffering them", OFFSET(direct_clusters), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
     { NULL },
 };
 
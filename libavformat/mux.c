@@ -240,6 +240,17 @@ static int validate_codec_tag(AVFormatContext *s, AVStream *st)
 }
 
 
+/**
+ * Whether an empty queue of this stream counts as a stream without
+ * interleaved packets for max_interleave_delta.
+ */
+static int counts_as_noninterleaved(const AVStream *st)
+{
+    return st->codecpar->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
+           st->codecpar->codec_id   != AV_CODEC_ID_VP8 &&
+           st->codecpar->codec_id   != AV_CODEC_ID_VP9;
+}
+
 static int init_muxer(AVFormatContext *s, AVDictionary **options)
 {
     int ret = 0, i;
@@ -382,6 +393,19 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
         if (par->codec_type != AVMEDIA_TYPE_ATTACHMENT)
             s->internal->nb_interleaved_streams++;
+        if (counts_as_noninterleaved(st))
+            s->internal->nb_noninterleaved_candidates++;
+    }
+
+    if (!of->interleave_packet && !s->max_chunk_size && !s->max_chunk_duration) {
+        s->internal->interleave_heap = av_malloc_array(s->nb_streams,
+                                                       sizeof(*s->internal->interleave_heap));
+        if (!s->internal->interleave_heap) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        s->internal->use_interleave_heap       = 1;
+        s->internal->interleave_max_dts_stream = -1;
     }
 
     if (!s->priv_data && of->priv_data_size > 0) {
@@ -916,13 +940,10 @@ int av_write_frame(AVFormatContext *s, AVPacket *pkt)
 
 #define CHUNK_START 0x1000
 
-int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
-                             int (*compare)(AVFormatContext *, AVPacket *, AVPacket *))
+static int alloc_queued_packet(AVPacketList **ppktl, AVPacket *pkt)
 {
+    AVPacketList *this_pktl;
     int ret;
-    AVPacketList **next_point, *this_pktl;
-    AVStream *st   = s->streams[pkt->stream_index];
-    int chunked    = s->max_chunk_size || s->max_chunk_duration;
 
     this_pktl      = av_mallocz(sizeof(AVPacketList));
     if (!this_pktl)
@@ -940,6 +961,20 @@ int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
             return ret;
         }
     }
+    *ppktl = this_pktl;
+    return 0;
+}
+
+int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
+                             int (*compare)(AVFormatContext *, AVPacket *, AVPacket *))
+{
+    int ret;
+    AVPacketList **next_point, *this_pktl;
+    AVStream *st   = s->streams[pkt->stream_index];
+    int chunked    = s->max_chunk_size || s->max_chunk_duration;
+
+    if ((ret = alloc_queued_packet(&this_pktl, pkt)) < 0)
+        return ret;
 
     if (s->streams[pkt->stream_index]->last_in_packet_buffer) {
         next_point = &(st->last_in_packet_buffer->next);
@@ -1017,6 +1052,225 @@ static int interleave_compare_dts(AVFormatContext *s, AVPacket *next,
     return comp > 0;
 }
 
+/*
+ * With the interleave heap, the packets of each stream are kept in their own
+ * queue, in the order they were written, and the heap orders the streams by
+ * their first queued packet. As the dts of a stream is monotonic, this gives
+ * the same output order as inserting into the sorted packet_buffer, but in
+ * O(log(nb_streams)) per packet instead of a walk over the buffer.
+ */
+
+static AVPacket *interleave_heap_top(AVFormatContext *s)
+{
+    AVStream *st = s->streams[s->internal->interleave_heap[0]];
+    return &st->internal->interleave_head->pkt;
+}
+
+/* whether the first packet of stream a goes before the one of stream b */
+static int interleave_heap_less(AVFormatContext *s, int a, int b)
+{
+    return interleave_compare_dts(s, &s->streams[b]->internal->interleave_head->pkt,
+                                     &s->streams[a]->internal->interleave_head->pkt);
+}
+
+static void interleave_heap_sift_up(AVFormatContext *s, int i)
+{
+    int *heap = s->internal->interleave_heap;
+
+    while (i > 0) {
+        int parent = (i - 1) >> 1;
+        if (!interleave_heap_less(s, heap[i], heap[parent]))
+            break;
+        FFSWAP(int, heap[i], heap[parent]);
+        i = parent;
+    }
+}
+
+static void interleave_heap_sift_down(AVFormatContext *s, int i)
+{
+    int *heap = s->internal->interleave_heap;
+    int n     = s->internal->nb_interleave_heap;
+
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && interleave_heap_less(s, heap[child + 1], heap[child]))
+            child++;
+        if (!interleave_heap_less(s, heap[child], heap[i]))
+            break;
+        FFSWAP(int, heap[i], heap[child]);
+        i = child;
+    }
+}
+
+static void interleave_heap_update_max_dts(AVFormatContext *s)
+{
+    AVFormatInternal *si = s->internal;
+    int i;
+
+    si->interleave_max_dts_stream = -1;
+    for (i = 0; i < si->nb_interleave_heap; i++) {
+        AVStream *st = s->streams[si->interleave_heap[i]];
+        int64_t last_dts = av_rescale_q(st->last_in_packet_buffer->pkt.dts,
+                                        st->time_base, AV_TIME_BASE_Q);
+
+        if (si->interleave_max_dts_stream < 0 || last_dts > si->interleave_max_dts) {
+            si->interleave_max_dts        = last_dts;
+            si->interleave_max_dts_stream = st->index;
+        }
+    }
+}
+
+static int interleave_heap_add(AVFormatContext *s, AVPacket *pkt)
+{
+    AVFormatInternal *si = s->internal;
+    AVStream *st = s->streams[pkt->stream_index];
+    AVPacketList *pktl;
+    int64_t last_dts;
+    int ret;
+
+    if ((ret = alloc_queued_packet(&pktl, pkt)) < 0)
+        return ret;
+    av_packet_unref(pkt);
+
+    if (st->last_in_packet_buffer) {
+        st->last_in_packet_buffer->next = pktl;
+        st->last_in_packet_buffer       = pktl;
+    } else {
+        st->internal->interleave_head = st->last_in_packet_buffer = pktl;
+        si->interleave_heap[si->nb_interleave_heap++] = st->index;
+        interleave_heap_sift_up(s, si->nb_interleave_heap - 1);
+        if (counts_as_noninterleaved(st))
+            si->nb_queued_candidates++;
+    }
+
+    /* the maximum only ever drops when its stream runs empty, see
+     * interleave_heap_pop() */
+    last_dts = av_rescale_q(pktl->pkt.dts, st->time_base, AV_TIME_BASE_Q);
+    if (si->interleave_max_dts_stream < 0 || last_dts >= si->interleave_max_dts) {
+        si->interleave_max_dts        = last_dts;
+        si->interleave_max_dts_stream = st->index;
+    }
+
+    si->interleave_queue_size++;
+    si->interleave_queue_peak = FFMAX(si->interleave_queue_peak,
+                                      si->interleave_queue_size);
+    return 0;
+}
+
+static AVPacketList *interleave_heap_pop(AVFormatContext *s)
+{
+    AVFormatInternal *si = s->internal;
+    AVStream *st = s->streams[si->interleave_heap[0]];
+    AVPacketList *pktl = st->internal->interleave_head;
+
+    st->internal->interleave_head = pktl->next;
+    pktl->next = NULL;
+    if (st->internal->interleave_head) {
+        interleave_heap_sift_down(s, 0);
+    } else {
+        st->last_in_packet_buffer = NULL;
+        if (counts_as_noninterleaved(st))
+            si->nb_queued_candidates--;
+        si->interleave_heap[0] = si->interleave_heap[--si->nb_interleave_heap];
+        interleave_heap_sift_down(s, 0);
+        if (st->index == si->interleave_max_dts_stream)
+            interleave_heap_update_max_dts(s);
+    }
+    si->interleave_queue_size--;
+    return pktl;
+}
+
+static int interleave_packet_heap(AVFormatContext *s, AVPacket *out,
+                                  AVPacket *pkt, int flush)
+{
+    AVFormatInternal *si = s->internal;
+    AVPacketList *pktl;
+    int stream_count, noninterleaved_count;
+    int ret;
+    int eof = flush;
+
+    if (pkt) {
+        if ((ret = interleave_heap_add(s, pkt)) < 0)
+            return ret;
+    }
+
+    stream_count         = si->nb_interleave_heap;
+    noninterleaved_count = si->nb_noninterleaved_candidates - si->nb_queued_candidates;
+
+    if (si->nb_interleaved_streams == stream_count)
+        flush = 1;
+
+    if (s->max_interleave_delta > 0 &&
+        stream_count &&
+        !flush &&
+        si->nb_interleaved_streams == stream_count+noninterleaved_count
+    ) {
+        AVPacket *top_pkt = interleave_heap_top(s);
+        int64_t top_dts = av_rescale_q(top_pkt->dts,
+                                       s->streams[top_pkt->stream_index]->time_base,
+                                       AV_TIME_BASE_Q);
+        int64_t delta_dts = si->interleave_max_dts - top_dts;
+
+        if (delta_dts > s->max_interleave_delta) {
+            av_log(s, AV_LOG_DEBUG,
+                   "Delay between the first packet and last packet in the "
+                   "muxing queue is %"PRId64" > %"PRId64": forcing output\n",
+                   delta_dts, s->max_interleave_delta);
+            flush = 1;
+        }
+    }
+
+    if (s->max_interleave_packets > 0 &&
+        !flush &&
+        si->interleave_queue_size > s->max_interleave_packets) {
+        av_log(s, AV_LOG_DEBUG,
+               "Number of packets in the muxing queue is %d > %d: forcing output\n",
+               si->interleave_queue_size, s->max_interleave_packets);
+        flush = 1;
+    }
+
+    if (stream_count &&
+        eof &&
+        (s->flags & AVFMT_FLAG_SHORTEST) &&
+        si->shortest_end == AV_NOPTS_VALUE) {
+        AVPacket *top_pkt = interleave_heap_top(s);
+
+        si->shortest_end = av_rescale_q(top_pkt->dts,
+                                        s->streams[top_pkt->stream_index]->time_base,
+                                        AV_TIME_BASE_Q);
+    }
+
+    if (si->shortest_end != AV_NOPTS_VALUE) {
+        while (si->nb_interleave_heap) {
+            AVPacket *top_pkt = interleave_heap_top(s);
+            int64_t top_dts = av_rescale_q(top_pkt->dts,
+                                        s->streams[top_pkt->stream_index]->time_base,
+                                        AV_TIME_BASE_Q);
+
+            if (si->shortest_end + 1 >= top_dts)
+                break;
+
+            pktl = interleave_heap_pop(s);
+            av_packet_unref(&pktl->pkt);
+            av_freep(&pktl);
+            flush = 0;
+        }
+    }
+
+    if (stream_count && flush) {
+        pktl = interleave_heap_pop(s);
+        *out = pktl->pkt;
+        av_freep(&pktl);
+
+        return 1;
+    } else {
+        av_init_packet(out);
+        return 0;
+    }
+}
+
 int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
                                  AVPacket *pkt, int flush)
 {
@@ -1026,6 +1280,9 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
     int i, ret;
     int eof = flush;
 
+    if (s->internal->use_interleave_heap)
+        return interleave_packet_heap(s, out, pkt, flush);
+
     if (pkt) {
         if ((ret = ff_interleave_add_packet(s, pkt, interleave_compare_dts)) < 0)
             return ret;
@@ -1034,9 +1291,7 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
     for (i = 0; i < s->nb_streams; i++) {
         if (s->streams[i]->last_in_packet_buffer) {
             ++stream_count;
-        } else if (s->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
-                   s->streams[i]->codecpar->codec_id != AV_CODEC_ID_VP8 &&
-                   s->streams[i]->codecpar->codec_id != AV_CODEC_ID_VP9) {
+        } else if (counts_as_noninterleaved(s->streams[i])) {
             ++noninterleaved_count;
         }
     }
@@ -1140,6 +1395,9 @@ int ff_interleaved_peek(AVFormatContext *s, int stream,
                         AVPacket *pkt, int add_offset)
 {
     AVPacketList *pktl = s->internal->packet_buffer;
+
+    if (s->internal->use_interleave_heap)
+        pktl = s->streams[stream]->internal->interleave_head;
     while (pktl) {
         if (pktl->pkt.stream_index == stream) {
             *pkt = pktl->pkt;
@@ -1268,6 +1526,10 @@ int av_write_trailer(AVFormatContext *s)
             goto fail;
     }
 
+    if (s->internal->use_interleave_heap)
+        av_log(s, AV_LOG_VERBOSE, "Muxing queue peaked at %d packets\n",
+               s->internal->interleave_queue_peak);
+
 fail:
     if (s->oformat->write_trailer) {
         if (!(s->oformat->flags & AVFMT_NOFILE) && s->pb)
@@ -31,6 +31,9 @@
 #if HAVE_POLL_H
 #include <poll.h>
 #endif
+#if HAVE_WRITEV
+#include <sys/uio.h>
+#endif
 
 typedef struct TCPContext {
     const AVClass *class;
@@ -261,6 +264,31 @@ static int tcp_write(URLContext *h, const uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+#if HAVE_WRITEV
+static int tcp_write_vec(URLContext *h, const URLIOVec *vec, int nb_vec)
+{
+    TCPContext *s = h->priv_data;
+    struct iovec iov[URL_MAX_IOVEC];
+    struct msghdr msg = { 0 };
+    int i, ret;
+
+    if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+        ret = ff_network_wait_fd_timeout(s->fd, 1, h->rw_timeout, &h->interrupt_callback);
+        if (ret)
+            return ret;
+    }
+    nb_vec = FFMIN(nb_vec, URL_MAX_IOVEC);
+    for (i = 0; i < nb_vec; i++) {
+        iov[i].iov_base = (void *)vec[i].data;
+        iov[i].iov_len  = vec[i].size;
+    }
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = nb_vec;
+    ret = sendmsg(s->fd, &msg, MSG_NOSIGNAL);
+    return ret < 0 ? ff_neterrno() : ret;
+}
+#endif
+
 static int tcp_shutdown(URLContext *h, int flags)
 {
     TCPContext *s = h->priv_data;
@@ -316,6 +344,9 @@ const URLProtocol ff_tcp_protocol = {
     .url_accept          = tcp_accept,
     .url_read            = tcp_read,
     .url_write           = tcp_write,
+#if HAVE_WRITEV
+    .url_write_vec       = tcp_write_vec,
+#endif
     .url_close           = tcp_close,
     .url_get_file_handle = tcp_get_file_handle,
     .url_get_short_seek  = tcp_get_window_size,
@@ -35,6 +35,19 @@
 
 extern const AVClass ffurl_context_class;
 
+/**
+ * Maximum number of chunks passed to URLProtocol.url_write_vec at once.
+ */
+#define URL_MAX_IOVEC 16
+
+/**
+ * A chunk of data for a vectored write.
+ */
+typedef struct URLIOVec {
+    const uint8_t *data;
+    int size;
+} URLIOVec;
+
 typedef struct URLContext {
     const AVClass *av_class;    /**< information for av_log(). Set by url_open(). */
     const struct URLProtocol *prot;
@@ -77,6 +90,12 @@ typedef struct URLProtocol {
      */
     int     (*url_read)( URLContext *h, unsigned char *buf, int size);
     int     (*url_write)(URLContext *h, const unsigned char *buf, int size);
+    /**
+     * Write the chunks of vec (at most URL_MAX_IOVEC) in order, as a single
+     * write if possible. Same return value semantics as url_write; partial
+     * writes may end inside any chunk.
+     */
+    int     (*url_write_vec)(URLContext *h, const URLIOVec *vec, int nb_vec);
     int64_t (*url_seek)( URLContext *h, int64_t pos, int whence);
     int     (*url_close)(URLContext *h);
     int (*url_read_pause)(URLContext *h, int pause);
@@ -202,6 +221,15 @@ int ffurl_read_complete(URLContext *h, unsigned char *buf, int size);
  */
 int ffurl_write(URLContext *h, const unsigned char *buf, int size);
 
+/**
+ * Write the chunks of vec in order to the resource accessed by h, using
+ * the protocol's vectored write if it has one.
+ *
+ * @return the number of bytes actually written, or a negative value
+ * corresponding to an AVERROR code in case of failure
+ */
+int ffurl_write_vec(URLContext *h, const URLIOVec *vec, int nb_vec);
+
 /**
  * Change the position that will be used by the next read/write
  * operation on the resource accessed by h.
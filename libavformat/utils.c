@@ -4353,6 +4353,9 @@ static void free_stream(AVStream **pst)
         av_freep(&st->internal->priv_pts);
         av_bsf_free(&st->internal->extract_extradata.bsf);
         av_packet_free(&st->internal->extract_extradata.pkt);
+        if (st->internal->interleave_head)
+            ff_packet_list_free(&st->internal->interleave_head,
+                                &st->last_in_packet_buffer);
     }
     av_freep(&st->internal);
 
@@ -4417,6 +4420,7 @@ void avformat_free_context(AVFormatContext *s)
     av_freep(&s->chapters);
     av_dict_free(&s->metadata);
     av_dict_free(&s->internal->id3v2_meta);
+    av_freep(&s->internal->interleave_heap);
     av_freep(&s->streams);
     flush_packet_queue(s);
     av_freep(&s->internal);
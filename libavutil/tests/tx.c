@@ -0,0 +1,429 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Transform tests, checked against a direct double precision evaluation.
+ * Run with -b [len] to benchmark instead.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavutil/tx.h"
+
+enum SampleKind { KIND_FLOAT, KIND_DOUBLE, KIND_INT32 };
+
+static const struct {
+    const char *name;
+    enum AVTXType fft, mdct;
+    enum SampleKind kind;
+    int size;
+    double tolerance;
+} types[] = {
+    { "float",  AV_TX_FLOAT_FFT,  AV_TX_FLOAT_MDCT,  KIND_FLOAT,  sizeof(float),   1e-5  },
+    { "double", AV_TX_DOUBLE_FFT, AV_TX_DOUBLE_MDCT, KIND_DOUBLE, sizeof(double),  1e-12 },
+    { "int32",  AV_TX_INT32_FFT,  AV_TX_INT32_MDCT,  KIND_INT32,  sizeof(int32_t), 1e-5  },
+};
+
+static const int fft_lens[] = {
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 12, 15, 16, 20, 21, 30, 32, 45, 48, 60,
+    64, 120, 128, 196, 200, 240, 256, 480, 512, 960, 1001, 1024, 1920, 2048,
+    4096,
+};
+
+static const int mdct_lens[] = {
+    4, 8, 16, 28, 32, 36, 60, 64, 120, 128, 240, 256, 480, 512, 960, 1024,
+};
+
+static void to_type(void *dst, const double *src, int n, enum SampleKind kind,
+                    double range)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        switch (kind) {
+        case KIND_FLOAT:  ((float   *)dst)[i] = src[i];                  break;
+        case KIND_DOUBLE: ((double  *)dst)[i] = src[i];                  break;
+        case KIND_INT32:  ((int32_t *)dst)[i] = lrint(src[i] * range);   break;
+        }
+    }
+}
+
+static void from_type(double *dst, const void *src, int n, ptrdiff_t stride,
+                      enum SampleKind kind, double range)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        switch (kind) {
+        case KIND_FLOAT:  dst[i] = ((const float   *)src)[i*stride];         break;
+        case KIND_DOUBLE: dst[i] = ((const double  *)src)[i*stride];         break;
+        case KIND_INT32:  dst[i] = ((const int32_t *)src)[i*stride] / range; break;
+        }
+    }
+}
+
+static int fft_ref(double *out, const double *in, int len, int inv)
+{
+    double *tab = av_malloc_array(2*len, sizeof(*tab));
+    int i, j;
+
+    if (!tab)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < len; i++) {
+        tab[2*i]     = cos(2 * M_PI * i / len);
+        tab[2*i + 1] = (inv ? 1 : -1) * sin(2 * M_PI * i / len);
+    }
+
+    for (i = 0; i < len; i++) {
+        double re = 0.0, im = 0.0;
+        for (j = 0; j < len; j++) {
+            int k = ((int64_t)i * j) % len;
+            double c = tab[2*k], s = tab[2*k + 1];
+            re += in[2*j] * c - in[2*j + 1] * s;
+            im += in[2*j] * s + in[2*j + 1] * c;
+        }
+        out[2*i]     = re;
+        out[2*i + 1] = im;
+    }
+
+    av_free(tab);
+    return 0;
+}
+
+/* len is the frame size, the window is 2*len */
+static void mdct_ref(double *out, const double *in, int len, double scale)
+{
+    int i, k, n = 2*len;
+
+    for (k = 0; k < len; k++) {
+        double sum = 0.0;
+        for (i = 0; i < n; i++) {
+            double a = 2 * M_PI * (2*i + 1 + n/2) * (2*k + 1) / (4.0 * n);
+            sum += in[i] * cos(a);
+        }
+        out[k] = sum * scale;
+    }
+}
+
+/* The middle half of the inverse MDCT */
+static void imdct_ref(double *out, const double *in, int len, double scale)
+{
+    int i, k, n = 2*len;
+
+    for (i = 0; i < len; i++) {
+        double sum = 0.0;
+        for (k = 0; k < len; k++) {
+            double a = M_PI * (2*(i + n/4) + 1 + n/2) * (2*k + 1) / (2.0 * n);
+            sum += in[k] * cos(a);
+        }
+        out[i] = -sum * scale;
+    }
+}
+
+static double rel_error(const double *a, const double *ref, int n)
+{
+    double err = 0.0, pow = 0.0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        err += (a[i] - ref[i]) * (a[i] - ref[i]);
+        pow += ref[i] * ref[i];
+    }
+
+    return pow > 0.0 ? sqrt(err / pow) : sqrt(err);
+}
+
+static void fill_random(AVLFG *prng, double *buf, int n, double amp)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        buf[i] = amp * ((av_lfg_get(prng) / (double)UINT32_MAX) * 2.0 - 1.0);
+}
+
+static int test_fft(AVLFG *prng, int t, int len, int inv, int inplace)
+{
+    const double range = 2147483648.0;
+    AVTXContext *ctx;
+    av_tx_fn fn;
+    double *in, *ref, *res;
+    void *src, *dst;
+    double err;
+    int ret;
+
+    in  = av_malloc_array(2*len, sizeof(*in));
+    ref = av_malloc_array(2*len, sizeof(*ref));
+    res = av_malloc_array(2*len, sizeof(*res));
+    src = av_malloc_array(2*len, types[t].size);
+    dst = av_malloc_array(2*len, types[t].size);
+    if (!in || !ref || !res || !src || !dst) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = av_tx_init(&ctx, &fn, types[t].fft, inv, len, NULL,
+                     inplace ? AV_TX_INPLACE : 0);
+    if (ret < 0) {
+        printf("%s fft: init failed for len %d\n", types[t].name, len);
+        goto end;
+    }
+
+    /* Leave headroom for the growth of the fixed point transform */
+    fill_random(prng, in, 2*len, 0.5 / len);
+    if ((ret = fft_ref(ref, in, len, inv)) < 0) {
+        av_tx_uninit(&ctx);
+        goto end;
+    }
+
+    to_type(src, in, 2*len, types[t].kind, range);
+    fn(ctx, inplace ? src : dst, src, sizeof(AVComplexFloat));
+    from_type(res, inplace ? src : dst, 2*len, 1, types[t].kind, range);
+    av_tx_uninit(&ctx);
+
+    err = rel_error(res, ref, 2*len);
+    if (err > types[t].tolerance) {
+        printf("%s %sfft%s len %d: error %g\n", types[t].name, inv ? "i" : "",
+               inplace ? " inplace" : "", len, err);
+        ret = 1;
+    }
+
+end:
+    av_free(in);
+    av_free(ref);
+    av_free(res);
+    av_free(src);
+    av_free(dst);
+    return ret;
+}
+
+/* Forward and inverse transforms should give back the input times len */
+static int test_fft_roundtrip(AVLFG *prng, int t, int len)
+{
+    const double range = 2147483648.0;
+    AVTXContext *fwd, *inv;
+    av_tx_fn fwd_fn, inv_fn;
+    double *in, *res;
+    void *src, *tmp;
+    double err;
+    int i, ret;
+
+    in  = av_malloc_array(2*len, sizeof(*in));
+    res = av_malloc_array(2*len, sizeof(*res));
+    src = av_malloc_array(2*len, types[t].size);
+    tmp = av_malloc_array(2*len, types[t].size);
+    if (!in || !res || !src || !tmp) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    if ((ret = av_tx_init(&fwd, &fwd_fn, types[t].fft, 0, len, NULL, 0)) < 0)
+        goto end;
+    if ((ret = av_tx_init(&inv, &inv_fn, types[t].fft, 1, len, NULL, 0)) < 0) {
+        av_tx_uninit(&fwd);
+        goto end;
+    }
+
+    fill_random(prng, in, 2*len, 0.5 / len);
+    to_type(src, in, 2*len, types[t].kind, range);
+    fwd_fn(fwd, tmp, src, 0);
+    inv_fn(inv, src, tmp, 0);
+    from_type(res, src, 2*len, 1, types[t].kind, range);
+    av_tx_uninit(&fwd);
+    av_tx_uninit(&inv);
+
+    for (i = 0; i < 2*len; i++)
+        in[i] *= len;
+    /* Fixed point inputs only keep a few significant bits at this size */
+    err = rel_error(res, in, 2*len);
+    if (err > types[t].tolerance * 100) {
+        printf("%s fft roundtrip len %d: error %g\n", types[t].name, len, err);
+        ret = 1;
+    }
+
+end:
+    av_free(in);
+    av_free(res);
+    av_free(src);
+    av_free(tmp);
+    return ret;
+}
+
+static int test_mdct(AVLFG *prng, int t, int len, int inv, double scale,
+                     int stride)
+{
+    const double range = 2147483648.0;
+    const int in_len = inv ? len : 2*len;
+    AVTXContext *ctx;
+    av_tx_fn fn;
+    double *in, *ref, *res;
+    void *src, *dst;
+    float scale_f = scale;
+    double err;
+    int ret;
+
+    in  = av_malloc_array(2*len, sizeof(*in));
+    ref = av_malloc_array(len, sizeof(*ref));
+    res = av_malloc_array(len, sizeof(*res));
+    src = av_mallocz_array(2*len*stride, types[t].size);
+    dst = av_mallocz_array(len*stride, types[t].size);
+    if (!in || !ref || !res || !src || !dst) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = av_tx_init(&ctx, &fn, types[t].mdct, inv, len,
+                     types[t].kind == KIND_DOUBLE ? (void *)&scale : (void *)&scale_f, 0);
+    if (ret < 0) {
+        printf("%s mdct: init failed for len %d\n", types[t].name, len);
+        goto end;
+    }
+
+    fill_random(prng, in, in_len, 0.5 / len);
+    if (inv)
+        imdct_ref(ref, in, len, scale);
+    else
+        mdct_ref(ref, in, len, scale);
+
+    if (inv) {
+        /* strided input */
+        double *spread = av_mallocz_array(len*stride, sizeof(*spread));
+        int i;
+        if (!spread) {
+            av_tx_uninit(&ctx);
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        for (i = 0; i < len; i++)
+            spread[i*stride] = in[i];
+        to_type(src, spread, len*stride, types[t].kind, range);
+        av_free(spread);
+        fn(ctx, dst, src, stride * types[t].size);
+        from_type(res, dst, len, 1, types[t].kind, range);
+    } else {
+        to_type(src, in, in_len, types[t].kind, range);
+        fn(ctx, dst, src, stride * types[t].size);
+        from_type(res, dst, len, stride, types[t].kind, range);
+    }
+    av_tx_uninit(&ctx);
+
+    err = rel_error(res, ref, len);
+    if (err > types[t].tolerance) {
+        printf("%s %smdct len %d scale %g stride %d: error %g\n",
+               types[t].name, inv ? "i" : "", len, scale, stride, err);
+        ret = 1;
+    }
+
+end:
+    av_free(in);
+    av_free(ref);
+    av_free(res);
+    av_free(src);
+    av_free(dst);
+    return ret;
+}
+
+static int bench(int len)
+{
+    int t, mdct;
+
+    for (t = 0; t < FF_ARRAY_ELEMS(types); t++) {
+        for (mdct = 0; mdct < 2; mdct++) {
+            AVTXContext *ctx;
+            av_tx_fn fn;
+            void *src, *dst;
+            float scale_f = 1.0f;
+            double scale = 1.0;
+            int64_t time_start, duration;
+            int i, nb_its = 1;
+
+            if (av_tx_init(&ctx, &fn, mdct ? types[t].mdct : types[t].fft, 0, len,
+                           types[t].kind == KIND_DOUBLE ? (void *)&scale : (void *)&scale_f, 0) < 0) {
+                printf("%s %s %d: unsupported\n", types[t].name,
+                       mdct ? "mdct" : "fft", len);
+                continue;
+            }
+            src = av_mallocz_array(4*len, types[t].size);
+            dst = av_mallocz_array(4*len, types[t].size);
+            if (!src || !dst) {
+                av_free(src);
+                av_free(dst);
+                av_tx_uninit(&ctx);
+                return AVERROR(ENOMEM);
+            }
+
+            /* run for at least one second */
+            for (;;) {
+                time_start = av_gettime_relative();
+                for (i = 0; i < nb_its; i++)
+                    fn(ctx, dst, src, types[t].size);
+                duration = av_gettime_relative() - time_start;
+                if (duration >= 1000000)
+                    break;
+                nb_its *= 2;
+            }
+            printf("%-6s %-4s %6d: %10.3f us\n", types[t].name,
+                   mdct ? "mdct" : "fft", len, (double)duration / nb_its);
+
+            av_free(src);
+            av_free(dst);
+            av_tx_uninit(&ctx);
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    AVLFG prng;
+    int t, i, inv, ret = 0;
+
+    if (argc > 1 && !strcmp(argv[1], "-b"))
+        return bench(argc > 2 ? atoi(argv[2]) : 1024);
+
+    av_lfg_init(&prng, 1);
+
+    for (t = 0; t < FF_ARRAY_ELEMS(types); t++) {
+        for (i = 0; i < FF_ARRAY_ELEMS(fft_lens); i++) {
+            for (inv = 0; inv < 2; inv++) {
+                ret |= test_fft(&prng, t, fft_lens[i], inv, 0);
+                ret |= test_fft(&prng, t, fft_lens[i], inv, 1);
+            }
+        }
+        ret |= test_fft_roundtrip(&prng, t, 131072);
+        ret |= test_fft_roundtrip(&prng, t, 3 * 32768);
+        for (i = 0; i < FF_ARRAY_ELEMS(mdct_lens); i++) {
+            for (inv = 0; inv < 2; inv++) {
+                ret |= test_mdct(&prng, t, mdct_lens[i], inv, 1.0, 1);
+                ret |= test_mdct(&prng, t, mdct_lens[i], inv, 0.5, 3);
+                ret |= test_mdct(&prng, t, mdct_lens[i], inv, -1.0, 1);
+            }
+        }
+    }
+
+    return !!ret;
+}
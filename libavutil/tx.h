@@ -0,0 +1,156 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_TX_H
+#define AVUTIL_TX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * @ingroup lavu_tx
+ * Transform API (FFT and MDCT) for arbitrary lengths.
+ */
+
+/**
+ * @defgroup lavu_tx Transforms
+ * @ingroup lavu_math
+ *
+ * Complex FFTs and MDCTs of any length, in float, double and 32 bit
+ * fixed point precision.
+ *
+ * Lengths of the form m*2^k with m one of 1, 3, 5 or 15 use fast
+ * dedicated code; any other odd factor m is supported but costs
+ * O(len * m) operations.
+ *
+ * @{
+ */
+
+typedef struct AVTXContext AVTXContext;
+
+typedef struct AVComplexFloat {
+    float re, im;
+} AVComplexFloat;
+
+typedef struct AVComplexDouble {
+    double re, im;
+} AVComplexDouble;
+
+typedef struct AVComplexInt32 {
+    int32_t re, im;
+} AVComplexInt32;
+
+enum AVTXType {
+    /**
+     * Standard complex to complex FFT with sample data type AVComplexFloat.
+     * Output is not 1/len normalized. Scaling currently unsupported.
+     * The stride parameter is ignored.
+     */
+    AV_TX_FLOAT_FFT  = 0,
+    /**
+     * Standard MDCT with sample data type of float and a scale type of
+     * float. Length is the frame size, not the window size (which is 2x
+     * frame) and must be a multiple of 4.
+     * For forward transforms, the input is 2*len samples and the stride
+     * specifies the spacing between each sample in the output array in
+     * bytes.
+     * For inverse transforms, the stride specifies the spacing between each
+     * sample in the input array in bytes, and the output is the middle half
+     * of the inverse transform (len samples) in a flat array, as the rest
+     * follows from symmetry.
+     * Stride must be a non-zero multiple of the sample size.
+     */
+    AV_TX_FLOAT_MDCT = 1,
+    /**
+     * Same as AV_TX_FLOAT_FFT with a data type of AVComplexDouble.
+     */
+    AV_TX_DOUBLE_FFT = 2,
+    /**
+     * Same as AV_TX_FLOAT_MDCT with data and scale type of double.
+     */
+    AV_TX_DOUBLE_MDCT = 3,
+    /**
+     * Same as AV_TX_FLOAT_FFT with a data type of AVComplexInt32, in Q31.
+     * There is no implicit scaling, so the input must leave enough headroom
+     * for the log2(len) bits of growth of the transform.
+     */
+    AV_TX_INT32_FFT = 4,
+    /**
+     * Same as AV_TX_FLOAT_MDCT with a data type of int32_t, but with a
+     * float scale type whose absolute value must not exceed 1.0.
+     * Like AV_TX_INT32_FFT there is no implicit scaling.
+     */
+    AV_TX_INT32_MDCT = 5,
+};
+
+/**
+ * Function pointer to a function to perform the transform.
+ *
+ * @note Using a different context than the one allocated during av_tx_init()
+ * is not allowed.
+ *
+ * @param s the transform context
+ * @param out the output array
+ * @param in the input array
+ * @param stride the input or output stride in bytes (depending on the type
+ *               of the transform), ignored by FFTs
+ *
+ * The out and in arrays must be aligned to the maximum required by the CPU
+ * architecture. Unless AV_TX_INPLACE was given to av_tx_init(), they must
+ * not overlap.
+ */
+typedef void (*av_tx_fn)(AVTXContext *s, void *out, void *in, ptrdiff_t stride);
+
+/**
+ * Flags for av_tx_init()
+ */
+enum AVTXFlags {
+    /**
+     * Allows the out and in arrays of FFTs to be the same.
+     * Not supported by MDCTs.
+     */
+    AV_TX_INPLACE = 1ULL << 0,
+};
+
+/**
+ * Initialize a transform context with the given configuration.
+ *
+ * @param ctx the context to allocate, will be NULL on error
+ * @param tx pointer to the transform function pointer to set
+ * @param type type the type of transform
+ * @param inv whether to do an inverse or a forward transform
+ * @param len the size of the transform in samples
+ * @param scale pointer to the value to scale the output if supported by type
+ * @param flags a bitmask of AVTXFlags or 0
+ *
+ * @return 0 on success, negative error code on failure
+ */
+int av_tx_init(AVTXContext **ctx, av_tx_fn *tx, enum AVTXType type,
+               int inv, int len, const void *scale, uint64_t flags);
+
+/**
+ * Frees a context and sets ctx to NULL, does nothing when ctx == NULL
+ */
+void av_tx_uninit(AVTXContext **ctx);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_TX_H */
@@ -0,0 +1,136 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_TX_PRIV_H
+#define AVUTIL_TX_PRIV_H
+
+#include "tx.h"
+#include <stddef.h>
+#include <string.h>
+#include "thread.h"
+#include "mem.h"
+#include "avassert.h"
+#include "attributes.h"
+#include "common.h"
+#include "libm.h"
+#include "mathematics.h"
+
+#ifdef TX_FLOAT
+#define TX_NAME(x) x ## _float
+#define SCALE_TYPE float
+typedef float TXSample;
+typedef AVComplexFloat TXComplex;
+#elif defined(TX_DOUBLE)
+#define TX_NAME(x) x ## _double
+#define SCALE_TYPE double
+typedef double TXSample;
+typedef AVComplexDouble TXComplex;
+#elif defined(TX_INT32)
+#define TX_NAME(x) x ## _int32
+#define SCALE_TYPE float
+typedef int32_t TXSample;
+typedef AVComplexInt32 TXComplex;
+#else
+typedef void TXComplex;
+#endif
+
+#if defined(TX_FLOAT) || defined(TX_DOUBLE)
+
+#define MULT(x, y) ((x) * (y))
+
+#define CMUL(dre, dim, are, aim, bre, bim) do {                                \
+        (dre) = (are) * (bre) - (aim) * (bim);                                 \
+        (dim) = (are) * (bim) + (aim) * (bre);                                 \
+    } while (0)
+
+#define RESCALE(x) (x)
+
+#define FOLD(a, b) ((a) + (b))
+
+#elif defined(TX_INT32)
+
+/* Q31 multiplication, properly rounded */
+#define MULT(x, y) ((int32_t)(((int64_t)(x) * (y) + 0x40000000) >> 31))
+
+#define CMUL(dre, dim, are, aim, bre, bim) do {                                \
+        int64_t accu;                                                          \
+        (accu)  = (int64_t)(bre) * (are);                                      \
+        (accu) -= (int64_t)(bim) * (aim);                                      \
+        (dre)   = (int)(((accu) + 0x40000000) >> 31);                          \
+        (accu)  = (int64_t)(bim) * (are);                                      \
+        (accu) += (int64_t)(bre) * (aim);                                      \
+        (dim)   = (int)(((accu) + 0x40000000) >> 31);                          \
+    } while (0)
+
+#define RESCALE(x) (av_clip64(llrint((x) * 2147483648.0), INT32_MIN, INT32_MAX))
+
+#define FOLD(a, b) ((int32_t)((unsigned)(a) + (unsigned)(b)))
+
+#endif
+
+#define BF(x, y, a, b) do {                                                    \
+        (x) = (a) - (b);                                                       \
+        (y) = (a) + (b);                                                       \
+    } while (0)
+
+#define CMUL3(c, a, b)                                                         \
+    CMUL((c).re, (c).im, (a).re, (a).im, (b).re, (b).im)
+
+typedef struct CosTabsInitOnce {
+    void (*func)(void);
+    AVOnce control;
+} CosTabsInitOnce;
+
+/* Used by the transforms, do not use directly */
+struct AVTXContext {
+    int n;              /* Non-power-of-two part */
+    int m;              /* Power-of-two part */
+    int inv;            /* Is inverse */
+    int type;           /* Type */
+    uint64_t flags;     /* Flags */
+
+    TXComplex *exptab;  /* MDCT pre/post rotation twiddles */
+    TXComplex *dfttab;  /* Twiddles of the naive DFT of the odd part */
+    TXComplex *tmp;     /* Temporary buffer needed for all compound transforms */
+    TXComplex *mdct_buf; /* FFT input and output of MDCTs */
+    int        *pfatab; /* Input/Output mapping for compound transforms */
+    int        *revtab; /* Input mapping for power of two transforms */
+    int   *inplace_idx; /* Permutation cycle starts for in-place transforms */
+    int nb_inplace_idx; /* Number of entries in inplace_idx */
+
+    av_tx_fn fft;       /* FFT of an MDCT */
+};
+
+/* Shared functions */
+int ff_tx_type_is_mdct(enum AVTXType type);
+int ff_tx_gen_compound_mapping(AVTXContext *s);
+int ff_tx_gen_ptwo_revtab(AVTXContext *s);
+int ff_tx_gen_ptwo_inplace_revtab_idx(AVTXContext *s);
+
+/* Templated init functions */
+int ff_tx_init_mdct_fft_float(AVTXContext *s, av_tx_fn *tx,
+                              enum AVTXType type, int inv, int len,
+                              const void *scale, uint64_t flags);
+int ff_tx_init_mdct_fft_double(AVTXContext *s, av_tx_fn *tx,
+                               enum AVTXType type, int inv, int len,
+                               const void *scale, uint64_t flags);
+int ff_tx_init_mdct_fft_int32(AVTXContext *s, av_tx_fn *tx,
+                              enum AVTXType type, int inv, int len,
+                              const void *scale, uint64_t flags);
+
+#endif /* AVUTIL_TX_PRIV_H */
@@ -0,0 +1,659 @@
+/*
+ * Copyright (c) 2008 Loren Merritt
+ * Copyright (c) 2002 Fabrice Bellard
+ * Partly based on libdjbfft by D. J. Bernstein
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* All costabs for a type are defined here */
+#define COSTABLE(size) \
+    static DECLARE_ALIGNED(32, TXSample, TX_NAME(ff_cos_##size))[size/2]
+
+COSTABLE(16);
+COSTABLE(32);
+COSTABLE(64);
+COSTABLE(128);
+COSTABLE(256);
+COSTABLE(512);
+COSTABLE(1024);
+COSTABLE(2048);
+COSTABLE(4096);
+COSTABLE(8192);
+COSTABLE(16384);
+COSTABLE(32768);
+COSTABLE(65536);
+COSTABLE(131072);
+
+static TXSample * const cos_tabs[18] = {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    TX_NAME(ff_cos_16),
+    TX_NAME(ff_cos_32),
+    TX_NAME(ff_cos_64),
+    TX_NAME(ff_cos_128),
+    TX_NAME(ff_cos_256),
+    TX_NAME(ff_cos_512),
+    TX_NAME(ff_cos_1024),
+    TX_NAME(ff_cos_2048),
+    TX_NAME(ff_cos_4096),
+    TX_NAME(ff_cos_8192),
+    TX_NAME(ff_cos_16384),
+    TX_NAME(ff_cos_32768),
+    TX_NAME(ff_cos_65536),
+    TX_NAME(ff_cos_131072),
+};
+
+/* cos(2*pi*x/m) for 0<=x<=m/4, followed by its reverse */
+static av_always_inline void init_cos_tabs_idx(int index)
+{
+    int i;
+    int m = 1 << index;
+    double freq = 2*M_PI/m;
+    TXSample *tab = cos_tabs[index];
+
+    for (i = 0; i <= m/4; i++)
+        tab[i] = RESCALE(cos(i*freq));
+    for (i = 1; i < m/4; i++)
+        tab[m/2 - i] = tab[i];
+}
+
+#define INIT_FF_COS_TABS_FUNC(index, size)                                     \
+static av_cold void init_cos_tabs_ ## size (void)                             \
+{                                                                              \
+    init_cos_tabs_idx(index);                                                  \
+}
+
+INIT_FF_COS_TABS_FUNC(4, 16)
+INIT_FF_COS_TABS_FUNC(5, 32)
+INIT_FF_COS_TABS_FUNC(6, 64)
+INIT_FF_COS_TABS_FUNC(7, 128)
+INIT_FF_COS_TABS_FUNC(8, 256)
+INIT_FF_COS_TABS_FUNC(9, 512)
+INIT_FF_COS_TABS_FUNC(10, 1024)
+INIT_FF_COS_TABS_FUNC(11, 2048)
+INIT_FF_COS_TABS_FUNC(12, 4096)
+INIT_FF_COS_TABS_FUNC(13, 8192)
+INIT_FF_COS_TABS_FUNC(14, 16384)
+INIT_FF_COS_TABS_FUNC(15, 32768)
+INIT_FF_COS_TABS_FUNC(16, 65536)
+INIT_FF_COS_TABS_FUNC(17, 131072)
+
+/* Constants of the 3 and 5 point transforms */
+static TXSample TX_NAME(ff_cos_53)[6];
+
+static av_cold void ff_init_53_tabs(void)
+{
+    TX_NAME(ff_cos_53)[0] = RESCALE(cos(2 * M_PI / 6));
+    TX_NAME(ff_cos_53)[1] = RESCALE(sin(2 * M_PI / 3));
+    TX_NAME(ff_cos_53)[2] = RESCALE(cos(2 * M_PI / 5));
+    TX_NAME(ff_cos_53)[3] = RESCALE(cos(4 * M_PI / 5));
+    TX_NAME(ff_cos_53)[4] = RESCALE(sin(2 * M_PI / 5));
+    TX_NAME(ff_cos_53)[5] = RESCALE(sin(4 * M_PI / 5));
+}
+
+static AVOnce tabs_53_once = AV_ONCE_INIT;
+
+static CosTabsInitOnce cos_tabs_init_once[] = {
+    { init_cos_tabs_16, AV_ONCE_INIT },
+    { init_cos_tabs_32, AV_ONCE_INIT },
+    { init_cos_tabs_64, AV_ONCE_INIT },
+    { init_cos_tabs_128, AV_ONCE_INIT },
+    { init_cos_tabs_256, AV_ONCE_INIT },
+    { init_cos_tabs_512, AV_ONCE_INIT },
+    { init_cos_tabs_1024, AV_ONCE_INIT },
+    { init_cos_tabs_2048, AV_ONCE_INIT },
+    { init_cos_tabs_4096, AV_ONCE_INIT },
+    { init_cos_tabs_8192, AV_ONCE_INIT },
+    { init_cos_tabs_16384, AV_ONCE_INIT },
+    { init_cos_tabs_32768, AV_ONCE_INIT },
+    { init_cos_tabs_65536, AV_ONCE_INIT },
+    { init_cos_tabs_131072, AV_ONCE_INIT },
+};
+
+static av_cold void init_cos_tabs(int index)
+{
+    ff_thread_once(&cos_tabs_init_once[index - 4].control,
+                    cos_tabs_init_once[index - 4].func);
+}
+
+static av_always_inline void fft3(TXComplex *out, TXComplex *in,
+                                  ptrdiff_t stride)
+{
+    const TXSample c = TX_NAME(ff_cos_53)[0], s = TX_NAME(ff_cos_53)[1];
+    TXComplex sum, diff;
+    TXSample re, im;
+
+    BF(diff.re, sum.re, in[1].re, in[2].re);
+    BF(diff.im, sum.im, in[1].im, in[2].im);
+
+    out[0*stride].re = in[0].re + sum.re;
+    out[0*stride].im = in[0].im + sum.im;
+
+    re = in[0].re - MULT(sum.re, c);
+    im = in[0].im - MULT(sum.im, c);
+    diff.re = MULT(diff.re, s);
+    diff.im = MULT(diff.im, s);
+
+    out[1*stride].re = re + diff.im;
+    out[1*stride].im = im - diff.re;
+    out[2*stride].re = re - diff.im;
+    out[2*stride].im = im + diff.re;
+}
+
+static av_always_inline void fft5(TXComplex *out, TXComplex *in,
+                                  ptrdiff_t stride)
+{
+    const TXSample c1 = TX_NAME(ff_cos_53)[2], c2 = TX_NAME(ff_cos_53)[3];
+    const TXSample s1 = TX_NAME(ff_cos_53)[4], s2 = TX_NAME(ff_cos_53)[5];
+    TXComplex t1, t2, d1, d2, a1, a2, b1, b2;
+
+    BF(d1.re, t1.re, in[1].re, in[4].re);
+    BF(d1.im, t1.im, in[1].im, in[4].im);
+    BF(d2.re, t2.re, in[2].re, in[3].re);
+    BF(d2.im, t2.im, in[2].im, in[3].im);
+
+    out[0*stride].re = in[0].re + t1.re + t2.re;
+    out[0*stride].im = in[0].im + t1.im + t2.im;
+
+    a1.re = in[0].re + MULT(t1.re, c1) + MULT(t2.re, c2);
+    a1.im = in[0].im + MULT(t1.im, c1) + MULT(t2.im, c2);
+    a2.re = in[0].re + MULT(t1.re, c2) + MULT(t2.re, c1);
+    a2.im = in[0].im + MULT(t1.im, c2) + MULT(t2.im, c1);
+
+    b1.re = MULT(d1.re, s1) + MULT(d2.re, s2);
+    b1.im = MULT(d1.im, s1) + MULT(d2.im, s2);
+    b2.re = MULT(d1.re, s2) - MULT(d2.re, s1);
+    b2.im = MULT(d1.im, s2) - MULT(d2.im, s1);
+
+    out[1*stride].re = a1.re + b1.im;
+    out[1*stride].im = a1.im - b1.re;
+    out[4*stride].re = a1.re - b1.im;
+    out[4*stride].im = a1.im + b1.re;
+    out[2*stride].re = a2.re + b2.im;
+    out[2*stride].im = a2.im - b2.re;
+    out[3*stride].re = a2.re - b2.im;
+    out[3*stride].im = a2.im + b2.re;
+}
+
+/*
+ * Good-Thomas 3x5 transform. The input is expected in the order given by
+ * the compound mapping, i.e. five groups of three.
+ */
+static av_always_inline void fft15(TXComplex *out, TXComplex *in,
+                                   ptrdiff_t stride)
+{
+    static const uint8_t out_map[15] = {
+        0,  6, 12,  3,  9,
+       10,  1,  7, 13,  4,
+        5, 11,  2,  8, 14,
+    };
+    TXComplex tmp[15], t[5];
+    int i, j;
+
+    for (i = 0; i < 5; i++)
+        fft3(tmp + i, in + i*3, 5);
+
+    for (i = 0; i < 3; i++) {
+        fft5(t, tmp + i*5, 1);
+        for (j = 0; j < 5; j++)
+            out[out_map[i*5 + j]*stride] = t[j];
+    }
+}
+
+/* Direct O(n^2) DFT, for odd factors without a dedicated transform */
+static void naive_fft(AVTXContext *s, TXComplex *out, TXComplex *in,
+                      ptrdiff_t stride)
+{
+    const int n = s->n;
+    const TXComplex *tab = s->dfttab;
+    int i, j;
+
+    for (i = 0; i < n; i++) {
+        TXComplex sum = in[0];
+        int idx = 0;
+        for (j = 1; j < n; j++) {
+            TXComplex t;
+            idx += i;
+            if (idx >= n)
+                idx -= n;
+            CMUL3(t, in[j], tab[idx]);
+            sum.re += t.re;
+            sum.im += t.im;
+        }
+        out[i*stride] = sum;
+    }
+}
+
+#define BUTTERFLIES(a0,a1,a2,a3) {\
+    BF(t3, t5, t5, t1);\
+    BF(a2.re, a0.re, a0.re, t5);\
+    BF(a3.im, a1.im, a1.im, t3);\
+    BF(t4, t6, t2, t6);\
+    BF(a3.re, a1.re, a1.re, t4);\
+    BF(a2.im, a0.im, a0.im, t6);\
+}
+
+// force loading all the inputs before storing any.
+// this is slightly slower for small data, but avoids store->load aliasing
+// for addresses separated by large powers of 2.
+#define BUTTERFLIES_BIG(a0,a1,a2,a3) {\
+    TXSample r0=a0.re, i0=a0.im, r1=a1.re, i1=a1.im;\
+    BF(t3, t5, t5, t1);\
+    BF(a2.re, a0.re, r0, t5);\
+    BF(a3.im, a1.im, i1, t3);\
+    BF(t4, t6, t2, t6);\
+    BF(a3.re, a1.re, r1, t4);\
+    BF(a2.im, a0.im, i0, t6);\
+}
+
+#define TRANSFORM(a0,a1,a2,a3,wre,wim) {\
+    CMUL(t1, t2, a2.re, a2.im, wre, -wim);\
+    CMUL(t5, t6, a3.re, a3.im, wre,  wim);\
+    BUTTERFLIES(a0,a1,a2,a3)\
+}
+
+#define TRANSFORM_ZERO(a0,a1,a2,a3) {\
+    t1 = a2.re;\
+    t2 = a2.im;\
+    t5 = a3.re;\
+    t6 = a3.im;\
+    BUTTERFLIES(a0,a1,a2,a3)\
+}
+
+/* z[0...8n-1], w[1...2n-1] */
+#define PASS(name)\
+static void name(TXComplex *z, const TXSample *wre, unsigned int n)\
+{\
+    TXSample t1, t2, t3, t4, t5, t6;\
+    int o1 = 2*n;\
+    int o2 = 4*n;\
+    int o3 = 6*n;\
+    const TXSample *wim = wre+o1;\
+    n--;\
+\
+    TRANSFORM_ZERO(z[0],z[o1],z[o2],z[o3]);\
+    TRANSFORM(z[1],z[o1+1],z[o2+1],z[o3+1],wre[1],wim[-1]);\
+    do {\
+        z += 2;\
+        wre += 2;\
+        wim -= 2;\
+        TRANSFORM(z[0],z[o1],z[o2],z[o3],wre[0],wim[0]);\
+        TRANSFORM(z[1],z[o1+1],z[o2+1],z[o3+1],wre[1],wim[-1]);\
+    } while(--n);\
+}
+
+PASS(pass)
+#undef BUTTERFLIES
+#define BUTTERFLIES BUTTERFLIES_BIG
+PASS(pass_big)
+
+#define DECL_FFT(n,n2,n4)\
+static void fft##n(TXComplex *z)\
+{\
+    fft##n2(z);\
+    fft##n4(z+n4*2);\
+    fft##n4(z+n4*3);\
+    pass(z,TX_NAME(ff_cos_##n),n4/2);\
+}
+
+static void fft1(TXComplex *z)
+{
+}
+
+static void fft2(TXComplex *z)
+{
+    TXComplex tmp;
+
+    BF(tmp.re, z[0].re, z[0].re, z[1].re);
+    BF(tmp.im, z[0].im, z[0].im, z[1].im);
+    z[1] = tmp;
+}
+
+static void fft4(TXComplex *z)
+{
+    TXSample t1, t2, t3, t4, t5, t6, t7, t8;
+
+    BF(t3, t1, z[0].re, z[1].re);
+    BF(t8, t6, z[3].re, z[2].re);
+    BF(z[2].re, z[0].re, t1, t6);
+    BF(t4, t2, z[0].im, z[1].im);
+    BF(t7, t5, z[2].im, z[3].im);
+    BF(z[3].im, z[1].im, t4, t8);
+    BF(z[3].re, z[1].re, t3, t7);
+    BF(z[2].im, z[0].im, t2, t5);
+}
+
+static void fft8(TXComplex *z)
+{
+    const TXSample sqrthalf = RESCALE(M_SQRT1_2);
+    TXSample t1, t2, t3, t4, t5, t6;
+
+    fft4(z);
+
+    BF(t1, z[5].re, z[4].re, -z[5].re);
+    BF(t2, z[5].im, z[4].im, -z[5].im);
+    BF(t5, z[7].re, z[6].re, -z[7].re);
+    BF(t6, z[7].im, z[6].im, -z[7].im);
+
+    BUTTERFLIES(z[0],z[2],z[4],z[6]);
+    TRANSFORM(z[1],z[3],z[5],z[7],sqrthalf,sqrthalf);
+}
+
+static void fft16(TXComplex *z)
+{
+    const TXSample sqrthalf = RESCALE(M_SQRT1_2);
+    TXSample t1, t2, t3, t4, t5, t6;
+    TXSample cos_16_1 = TX_NAME(ff_cos_16)[1];
+    TXSample cos_16_3 = TX_NAME(ff_cos_16)[3];
+
+    fft8(z);
+    fft4(z+8);
+    fft4(z+12);
+
+    TRANSFORM_ZERO(z[0],z[4],z[8],z[12]);
+    TRANSFORM(z[2],z[6],z[10],z[14],sqrthalf,sqrthalf);
+    TRANSFORM(z[1],z[5],z[9],z[13],cos_16_1,cos_16_3);
+    TRANSFORM(z[3],z[7],z[11],z[15],cos_16_3,cos_16_1);
+}
+
+DECL_FFT(32,16,8)
+DECL_FFT(64,32,16)
+DECL_FFT(128,64,32)
+DECL_FFT(256,128,64)
+DECL_FFT(512,256,128)
+#define pass pass_big
+DECL_FFT(1024,512,256)
+DECL_FFT(2048,1024,512)
+DECL_FFT(4096,2048,1024)
+DECL_FFT(8192,4096,2048)
+DECL_FFT(16384,8192,4096)
+DECL_FFT(32768,16384,8192)
+DECL_FFT(65536,32768,16384)
+DECL_FFT(131072,65536,32768)
+
+static void (* const fft_dispatch[])(TXComplex*) = {
+    fft1, fft2, fft4, fft8, fft16, fft32, fft64, fft128, fft256, fft512,
+    fft1024, fft2048, fft4096, fft8192, fft16384, fft32768, fft65536, fft131072
+};
+
+#define DECL_COMP_FFT(N)                                                       \
+static void compound_fft_##N##xM(AVTXContext *s, void *_out,                   \
+                                 void *_in, ptrdiff_t stride)                  \
+{                                                                              \
+    const int m = s->m, *in_map = s->pfatab, *out_map = in_map + N*m;          \
+    TXComplex *in = _in;                                                       \
+    TXComplex *out = _out;                                                     \
+    TXComplex fft##N##in[N];                                                   \
+    void (*fftp)(TXComplex *z) = fft_dispatch[av_log2(m)];                     \
+    int i, j;                                                                  \
+                                                                               \
+    for (i = 0; i < m; i++) {                                                  \
+        for (j = 0; j < N; j++)                                                \
+            fft##N##in[j] = in[in_map[i*N + j]];                               \
+        fft##N(s->tmp + s->revtab[i], fft##N##in, m);                          \
+    }                                                                          \
+                                                                               \
+    for (i = 0; i < N; i++)                                                    \
+        fftp(s->tmp + m*i);                                                    \
+                                                                               \
+    for (i = 0; i < N*m; i++)                                                  \
+        out[i] = s->tmp[out_map[i]];                                           \
+}
+
+DECL_COMP_FFT(3)
+DECL_COMP_FFT(5)
+DECL_COMP_FFT(15)
+
+static void compound_fft_naive_xM(AVTXContext *s, void *_out,
+                                  void *_in, ptrdiff_t stride)
+{
+    const int n = s->n, m = s->m, *in_map = s->pfatab, *out_map = in_map + n*m;
+    TXComplex *in = _in;
+    TXComplex *out = _out;
+    TXComplex *fftnin = s->tmp + n*m;
+    void (*fftp)(TXComplex *z) = fft_dispatch[av_log2(m)];
+    int i, j;
+
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < n; j++)
+            fftnin[j] = in[in_map[i*n + j]];
+        naive_fft(s, s->tmp + s->revtab[i], fftnin, m);
+    }
+
+    for (i = 0; i < n; i++)
+        fftp(s->tmp + m*i);
+
+    for (i = 0; i < n*m; i++)
+        out[i] = s->tmp[out_map[i]];
+}
+
+static void monolithic_fft(AVTXContext *s, void *_out, void *_in,
+                           ptrdiff_t stride)
+{
+    TXComplex *in = _in;
+    TXComplex *out = _out;
+    int i, m = s->m, mb = av_log2(m);
+
+    if (s->flags & AV_TX_INPLACE && in == out) {
+        for (i = 0; i < s->nb_inplace_idx; i++) {
+            int src = s->inplace_idx[i];
+            int dst = s->revtab[src];
+            TXComplex tmp = out[src];
+            do {
+                FFSWAP(TXComplex, tmp, out[dst]);
+                dst = s->revtab[dst];
+            } while (dst != src);
+            out[src] = tmp;
+        }
+    } else {
+        for (i = 0; i < m; i++)
+            out[s->revtab[i]] = in[i];
+    }
+
+    fft_dispatch[mb](out);
+}
+
+static void mdct(AVTXContext *s, void *_dst, void *_src, ptrdiff_t stride)
+{
+    TXSample *src = _src, *dst = _dst;
+    TXComplex *exp = s->exptab;
+    const int n4 = s->n*s->m, n2 = 2*n4, n = 2*n2, n8 = n4 >> 1, n3 = 3*n4;
+    TXComplex *z = s->mdct_buf, *o = z + n4;
+    int i;
+
+    stride /= sizeof(*dst);
+
+    /* pre rotation */
+    for (i = 0; i < n8; i++) {
+        TXSample re, im;
+
+        re = FOLD(-src[2*i + n3], -src[n3 - 1 - 2*i]);
+        im = FOLD(-src[n4 + 2*i], +src[n4 - 1 - 2*i]);
+        CMUL(z[i].re, z[i].im, re, im, -exp[i].re, exp[i].im);
+
+        re = FOLD( src[2*i], -src[n2 - 1 - 2*i]);
+        im = FOLD(-src[n2 + 2*i], -src[n - 1 - 2*i]);
+        CMUL(z[n8 + i].re, z[n8 + i].im, re, im,
+             -exp[n8 + i].re, exp[n8 + i].im);
+    }
+
+    s->fft(s, o, z, sizeof(*z));
+
+    /* post rotation */
+    for (i = 0; i < n8; i++) {
+        TXSample r0, i0, r1, i1;
+        const int i0_idx = n8 - i - 1, i1_idx = n8 + i;
+
+        CMUL(i1, r0, o[i0_idx].re, o[i0_idx].im,
+             -exp[i0_idx].im, -exp[i0_idx].re);
+        CMUL(i0, r1, o[i1_idx].re, o[i1_idx].im,
+             -exp[i1_idx].im, -exp[i1_idx].re);
+        dst[(2*i0_idx + 0)*stride] = r0;
+        dst[(2*i0_idx + 1)*stride] = i0;
+        dst[(2*i1_idx + 0)*stride] = r1;
+        dst[(2*i1_idx + 1)*stride] = i1;
+    }
+}
+
+static void imdct(AVTXContext *s, void *_dst, void *_src, ptrdiff_t stride)
+{
+    TXComplex *dst = _dst;
+    TXSample *src = _src;
+    TXComplex *exp = s->exptab;
+    const int n4 = s->n*s->m, n2 = 2*n4, n8 = n4 >> 1;
+    TXComplex *z = s->mdct_buf, *o = z + n4;
+    const TXSample *in1, *in2;
+    int i;
+
+    stride /= sizeof(*src);
+    in1 = src;
+    in2 = src + (n2 - 1)*stride;
+
+    /* pre rotation */
+    for (i = 0; i < n4; i++) {
+        CMUL(z[i].re, z[i].im, *in2, *in1, exp[i].re, exp[i].im);
+        in1 += 2*stride;
+        in2 -= 2*stride;
+    }
+
+    s->fft(s, o, z, sizeof(*z));
+
+    /* post rotation + reordering */
+    for (i = 0; i < n8; i++) {
+        TXSample r0, i0, r1, i1;
+        const int i0_idx = n8 - i - 1, i1_idx = n8 + i;
+
+        CMUL(r0, i1, o[i0_idx].im, o[i0_idx].re,
+             exp[i0_idx].im, exp[i0_idx].re);
+        CMUL(r1, i0, o[i1_idx].im, o[i1_idx].re,
+             exp[i1_idx].im, exp[i1_idx].re);
+        dst[i0_idx].re = r0;
+        dst[i0_idx].im = i0;
+        dst[i1_idx].re = r1;
+        dst[i1_idx].im = i1;
+    }
+}
+
+static int gen_mdct_exptab(AVTXContext *s, int len4, double scale)
+{
+    const double theta = (scale < 0 ? len4 : 0) + 1.0/8.0;
+    int i;
+
+    if (!(s->exptab = av_malloc_array(len4, sizeof(*s->exptab))))
+        return AVERROR(ENOMEM);
+
+    scale = sqrt(fabs(scale));
+    for (i = 0; i < len4; i++) {
+        const double alpha = M_PI_2 * (i + theta) / len4;
+        s->exptab[i].re = RESCALE(-cos(alpha) * scale);
+        s->exptab[i].im = RESCALE(-sin(alpha) * scale);
+    }
+
+    return 0;
+}
+
+static int gen_dft_tab(AVTXContext *s)
+{
+    const int n = s->n;
+    int i;
+
+    if (!(s->dfttab = av_malloc_array(n, sizeof(*s->dfttab))))
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < n; i++) {
+        const double alpha = 2 * M_PI * i / n;
+        s->dfttab[i].re = RESCALE( cos(alpha));
+        s->dfttab[i].im = RESCALE(-sin(alpha));
+    }
+
+    return 0;
+}
+
+int TX_NAME(ff_tx_init_mdct_fft)(AVTXContext *s, av_tx_fn *tx,
+                                 enum AVTXType type, int inv, int len,
+                                 const void *scale, uint64_t flags)
+{
+    const int is_mdct = ff_tx_type_is_mdct(type);
+    const int max_ptwo = 1 << (FF_ARRAY_ELEMS(fft_dispatch) - 1);
+    int i, err, n, m;
+
+    if (is_mdct) {
+        /* The pre and post rotations work on pairs of FFT bins */
+        if (len & 3)
+            return AVERROR(EINVAL);
+        len >>= 1;
+    }
+
+    m = len & -len;
+    n = len / m;
+    if (m > max_ptwo)
+        return AVERROR(EINVAL);
+
+    s->n     = n;
+    s->m     = m;
+    s->inv   = inv;
+    s->type  = type;
+    s->flags = flags;
+
+    if ((flags & AV_TX_INPLACE) && is_mdct)
+        return AVERROR(EINVAL);
+
+    ff_thread_once(&tabs_53_once, ff_init_53_tabs);
+    for (i = 4; i <= av_log2(m); i++)
+        init_cos_tabs(i);
+
+    if ((err = ff_tx_gen_ptwo_revtab(s)))
+        return err;
+
+    if (n > 1) {
+        if ((err = ff_tx_gen_compound_mapping(s)))
+            return err;
+        /* The naive transform gathers its input past the end */
+        if (!(s->tmp = av_malloc_array(len + n, sizeof(*s->tmp))))
+            return AVERROR(ENOMEM);
+        switch (n) {
+        case  3: s->fft = compound_fft_3xM;  break;
+        case  5: s->fft = compound_fft_5xM;  break;
+        case 15: s->fft = compound_fft_15xM; break;
+        default:
+            if ((err = gen_dft_tab(s)))
+                return err;
+            s->fft = compound_fft_naive_xM;
+            break;
+        }
+    } else {
+        if ((flags & AV_TX_INPLACE) &&
+            (err = ff_tx_gen_ptwo_inplace_revtab_idx(s)))
+            return err;
+        s->fft = monolithic_fft;
+    }
+
+    if (is_mdct) {
+        if ((err = gen_mdct_exptab(s, len, scale ? *((SCALE_TYPE *)scale) : 1.0)))
+            return err;
+        if (!(s->mdct_buf = av_malloc_array(2*len, sizeof(*s->mdct_buf))))
+            return AVERROR(ENOMEM);
+        *tx = inv ? imdct : mdct;
+    } else {
+        *tx = s->fft;
+    }
+
+    return 0;
+}
@@ -312,9 +312,41 @@ static void check_idct_multiple(void)
     }
 }
 
+static void check_startcode(void)
+{
+#define BUF_SIZE 1024
+    LOCAL_ALIGNED_16(uint8_t, buf, [BUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE]);
+    H264DSPContext h;
+    int i, size, zero;
+    declare_func(int, const uint8_t *buf, int size);
+
+    ff_h264dsp_init(&h, 8, 1);
+    if (check_func(h.startcode_find_candidate, "startcode_find_candidate")) {
+        for (i = 0; i < BUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE; i++)
+            buf[i] = 1 + rnd() % 255;
+        for (zero = 0; zero <= BUF_SIZE; zero += 1 + rnd() % 97) {
+            for (size = 0; size <= BUF_SIZE; size += 1 + rnd() % 61) {
+                if (zero < BUF_SIZE)
+                    buf[zero] = 0;
+                /* the C version may return any value >= size if there is no
+                 * zero in the first size bytes */
+                if (FFMIN(call_ref(buf, size), size) != FFMIN(call_new(buf, size), size))
+                    fail();
+                if (zero < BUF_SIZE)
+                    buf[zero] = 1 + rnd() % 255;
+            }
+        }
+        buf[BUF_SIZE / 2] = 0;
+        bench_new(buf, BUF_SIZE);
+    }
+}
+
 void checkasm_check_h264dsp(void)
 {
     check_idct();
     check_idct_multiple();
     report("idct");
+
+    check_startcode();
+    report("startcode");
 }
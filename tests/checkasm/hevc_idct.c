@@ -59,6 +59,94 @@ static void check_idct(HEVCDSPContext h, int bit_depth)
     }
 }
 
+/* up-right diagonal scan of an n x n block, as used for the coefficients */
+static void diag_scan(uint8_t *scan_x, uint8_t *scan_y, int n)
+{
+    int d, x, i = 0;
+
+    for (d = 0; d < 2 * n - 1; d++) {
+        for (x = FFMAX(0, d - n + 1); x <= FFMIN(d, n - 1); x++) {
+            scan_x[i]   = x;
+            scan_y[i++] = d - x;
+        }
+    }
+}
+
+/* Fill the coefficients up to a random last significant one in diagonal
+ * scan order and derive col_limit from it like hevc_cabac.c does. */
+static int randomize_sparse(int16_t *coeffs, int log2_size)
+{
+    uint8_t sub_x[64], sub_y[64], pos_x[16], pos_y[16];
+    int size = 1 << log2_size, nb_sub = size * size / 16;
+    int last, n, x, y, max_xy, col_limit;
+
+    diag_scan(sub_x, sub_y, size / 4);
+    diag_scan(pos_x, pos_y, 4);
+
+    memset(coeffs, 0, sizeof(*coeffs) * size * size);
+    last = 1 + rnd() % (nb_sub * 16 - 1);
+    for (n = 0; n <= last; n++) {
+        x = sub_x[n >> 4] * 4 + pos_x[n & 15];
+        y = sub_y[n >> 4] * 4 + pos_y[n & 15];
+        if (n == last || rnd() & 1)
+            coeffs[y * size + x] = (int16_t)rnd() | (n == last);
+    }
+
+    max_xy    = FFMAX(x, y);
+    col_limit = x + y + 4;
+    if (max_xy < 4)
+        col_limit = FFMIN(4, col_limit);
+    else if (max_xy < 8)
+        col_limit = FFMIN(8, col_limit);
+    else if (max_xy < 12)
+        col_limit = FFMIN(24, col_limit);
+    return col_limit;
+}
+
+static void check_idct_sparse(HEVCDSPContext h, int bit_depth)
+{
+    int i, j;
+    LOCAL_ALIGNED(32, int16_t, coeffs0, [32 * 32]);
+    LOCAL_ALIGNED(32, int16_t, coeffs1, [32 * 32]);
+
+    for (i = 2; i <= 5; i++) {
+        int block_size = 1 << i;
+        int size = block_size * block_size;
+        declare_func(void, int16_t *coeffs, int col_limit);
+
+        if (check_func(h.idct[i - 2], "hevc_idct_%dx%d_sparse_%d", block_size, block_size, bit_depth)) {
+            int col_limit = 0;
+
+            for (j = 0; j < 32; j++) {
+                col_limit = randomize_sparse(coeffs0, i);
+                memcpy(coeffs1, coeffs0, sizeof(*coeffs0) * size);
+                call_ref(coeffs0, col_limit);
+                call_new(coeffs1, col_limit);
+                if (memcmp(coeffs0, coeffs1, sizeof(*coeffs0) * size))
+                    fail();
+            }
+            bench_new(coeffs1, col_limit);
+        }
+    }
+}
+
+static void check_transform_luma(HEVCDSPContext h, int bit_depth)
+{
+    LOCAL_ALIGNED(32, int16_t, coeffs0, [4 * 4]);
+    LOCAL_ALIGNED(32, int16_t, coeffs1, [4 * 4]);
+    declare_func(void, int16_t *coeffs);
+
+    randomize_buffers(coeffs0, 4 * 4);
+    memcpy(coeffs1, coeffs0, sizeof(*coeffs0) * 4 * 4);
+    if (check_func(h.transform_4x4_luma, "hevc_transform_4x4_luma_%d", bit_depth)) {
+        call_ref(coeffs0);
+        call_new(coeffs1);
+        if (memcmp(coeffs0, coeffs1, sizeof(*coeffs0) * 4 * 4))
+            fail();
+        bench_new(coeffs1);
+    }
+}
+
 static void check_idct_dc(HEVCDSPContext h, int bit_depth)
 {
     int i;
@@ -102,4 +190,20 @@ void checkasm_check_hevc_idct(void)
         check_idct(h, bit_depth);
     }
     report("idct");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_idct_sparse(h, bit_depth);
+    }
+    report("idct_sparse");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_transform_luma(h, bit_depth);
+    }
+    report("transform_luma");
 }
@@ -0,0 +1,189 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+
+#include "libavcodec/avcodec.h"
+
+#include "libavcodec/hevcdsp.h"
+
+#include "checkasm.h"
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x03ff03ff, 0x0fff0fff };
+static const int sizes[10] = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+static const int weights[] = { -128, 1, 64, 127 };
+static const int denoms[]  = { 0, 3, 7 };
+static const int offsets[] = { -128, 0, 127 };
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define SRC_STRIDE   (2 * MAX_PB_SIZE)
+// the interpolation filters read up to 3 rows/columns before the block
+#define SRC_OFFSET   (4 * SRC_STRIDE)
+#define BUF_SIZE     (SRC_STRIDE * (MAX_PB_SIZE + 8) + AV_INPUT_BUFFER_PADDING_SIZE)
+#define DST_SIZE     (2 * MAX_PB_SIZE * MAX_PB_SIZE)
+
+#define randomize_buffers(buf0, buf1, size)                 \
+    do {                                                    \
+        uint32_t mask = pixel_mask[(bit_depth - 8) >> 1];   \
+        int k;                                              \
+        for (k = 0; k < size; k += 4) {                     \
+            uint32_t r = rnd() & mask;                      \
+            AV_WN32A(buf0 + k, r);                          \
+            AV_WN32A(buf1 + k, r);                          \
+        }                                                   \
+    } while (0)
+
+#define randomize_src2(buf, size)                           \
+    do {                                                    \
+        int k;                                              \
+        for (k = 0; k < size; k++)                          \
+            buf[k] = rnd() & 0x3fff;                        \
+    } while (0)
+
+static const char *const pel_names[2][2][2] = {
+    { { "epel_pixels", "epel_h" }, { "epel_v", "epel_hv" } },
+    { { "qpel_pixels", "qpel_h" }, { "qpel_v", "qpel_hv" } },
+};
+
+static void check_uni_w(HEVCDSPContext *h, int bit_depth, int qpel)
+{
+    LOCAL_ALIGNED_32(uint8_t, src0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_SIZE]);
+    int size, my, mx, d, w, o;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src, ptrdiff_t srcstride,
+                 int height, int denom, int wx, int ox, intptr_t mx, intptr_t my, int width);
+
+    for (my = 0; my < 2; my++) {
+        for (mx = 0; mx < 2; mx++) {
+            for (size = 1; size < 10; size++) {
+                int width = sizes[size];
+                ptrdiff_t stride = width * SIZEOF_PIXEL;
+                void (*func)(uint8_t *, ptrdiff_t, uint8_t *, ptrdiff_t,
+                             int, int, int, int, intptr_t, intptr_t, int);
+
+                func = qpel ? h->put_hevc_qpel_uni_w[size][my][mx]
+                            : h->put_hevc_epel_uni_w[size][my][mx];
+                if (!check_func(func, "put_hevc_uni_w_%s%d_%d",
+                                pel_names[qpel][my][mx], width, bit_depth))
+                    continue;
+
+                for (d = 0; d < FF_ARRAY_ELEMS(denoms); d++) {
+                    for (w = 0; w < FF_ARRAY_ELEMS(weights); w++) {
+                        for (o = 0; o < FF_ARRAY_ELEMS(offsets); o++) {
+                            randomize_buffers(src0, src1, BUF_SIZE);
+                            memset(dst0, 0, DST_SIZE);
+                            memset(dst1, 0, DST_SIZE);
+                            call_ref(dst0, stride, src0 + SRC_OFFSET, SRC_STRIDE, width,
+                                     denoms[d], weights[w], offsets[o], mx, my, width);
+                            call_new(dst1, stride, src1 + SRC_OFFSET, SRC_STRIDE, width,
+                                     denoms[d], weights[w], offsets[o], mx, my, width);
+                            if (memcmp(dst0, dst1, DST_SIZE))
+                                fail();
+                        }
+                    }
+                }
+                bench_new(dst1, stride, src1 + SRC_OFFSET, SRC_STRIDE, width,
+                          denoms[1], weights[2], offsets[2], mx, my, width);
+            }
+        }
+    }
+}
+
+static void check_bi_w(HEVCDSPContext *h, int bit_depth, int qpel)
+{
+    LOCAL_ALIGNED_32(uint8_t, src0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, src2, [MAX_PB_SIZE * MAX_PB_SIZE]);
+    int size, my, mx, d, w, o;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src, ptrdiff_t srcstride,
+                 int16_t *src2, int height, int denom, int wx0, int wx1,
+                 int ox0, int ox1, intptr_t mx, intptr_t my, int width);
+
+    for (my = 0; my < 2; my++) {
+        for (mx = 0; mx < 2; mx++) {
+            for (size = 1; size < 10; size++) {
+                int width = sizes[size];
+                ptrdiff_t stride = width * SIZEOF_PIXEL;
+                void (*func)(uint8_t *, ptrdiff_t, uint8_t *, ptrdiff_t, int16_t *,
+                             int, int, int, int, int, int, intptr_t, intptr_t, int);
+
+                func = qpel ? h->put_hevc_qpel_bi_w[size][my][mx]
+                            : h->put_hevc_epel_bi_w[size][my][mx];
+                if (!check_func(func, "put_hevc_bi_w_%s%d_%d",
+                                pel_names[qpel][my][mx], width, bit_depth))
+                    continue;
+
+                for (d = 0; d < FF_ARRAY_ELEMS(denoms); d++) {
+                    for (w = 0; w < FF_ARRAY_ELEMS(weights); w++) {
+                        for (o = 0; o < FF_ARRAY_ELEMS(offsets); o++) {
+                            int wx1 = weights[FF_ARRAY_ELEMS(weights) - 1 - w];
+                            int ox1 = offsets[FF_ARRAY_ELEMS(offsets) - 1 - o];
+
+                            randomize_buffers(src0, src1, BUF_SIZE);
+                            randomize_src2(src2, MAX_PB_SIZE * MAX_PB_SIZE);
+                            memset(dst0, 0, DST_SIZE);
+                            memset(dst1, 0, DST_SIZE);
+                            call_ref(dst0, stride, src0 + SRC_OFFSET, SRC_STRIDE, src2, width,
+                                     denoms[d], weights[w], wx1, offsets[o], ox1, mx, my, width);
+                            call_new(dst1, stride, src1 + SRC_OFFSET, SRC_STRIDE, src2, width,
+                                     denoms[d], weights[w], wx1, offsets[o], ox1, mx, my, width);
+                            if (memcmp(dst0, dst1, DST_SIZE))
+                                fail();
+                        }
+                    }
+                }
+                bench_new(dst1, stride, src1 + SRC_OFFSET, SRC_STRIDE, src2, width,
+                          denoms[1], weights[2], weights[1], offsets[2], offsets[1], mx, my, width);
+            }
+        }
+    }
+}
+
+void checkasm_check_hevc_pel(void)
+{
+    int bit_depth, qpel;
+
+    for (qpel = 0; qpel < 2; qpel++) {
+        for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+            HEVCDSPContext h;
+
+            ff_hevc_dsp_init(&h, bit_depth);
+            check_uni_w(&h, bit_depth, qpel);
+        }
+    }
+    report("uni_w");
+
+    for (qpel = 0; qpel < 2; qpel++) {
+        for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+            HEVCDSPContext h;
+
+            ff_hevc_dsp_init(&h, bit_depth);
+            check_bi_w(&h, bit_depth, qpel);
+        }
+    }
+    report("bi_w");
+}
@@ -65,6 +65,34 @@ static const uint32_t sao_size[5] = {8, 16, 32, 48, 64};
         }                                                   \
     } while (0)
 
+/* offsets as hls_sao_param() derives them: offset_val[0] is 0 and the edge
+ * offsets are positive for categories 1 and 2, negative for 3 and 4 */
+static void randomize_offsets(int16_t *offset_val, int bit_depth, int edge)
+{
+    int max   = (1 << (FFMIN(bit_depth, 10) - 5)) - 1;
+    int scale = rnd() % (FFMAX(bit_depth - 10, 0) + 1);
+    int k;
+
+    offset_val[0] = 0;
+    for (k = 1; k < OFFSET_LENGTH; k++) {
+        int v = rnd() % (max + 1);
+        if (edge ? k > 2 : rnd() & 1)
+            v = -v;
+        offset_val[k] = v * (1 << scale);
+    }
+}
+
+static int cmp_rect(const uint8_t *buf0, const uint8_t *buf1, ptrdiff_t stride,
+                    int width, int height)
+{
+    int y;
+
+    for (y = 0; y < height; y++)
+        if (memcmp(buf0 + y * stride, buf1 + y * stride, width))
+            return 1;
+    return 0;
+}
+
 static void check_sao_band(HEVCDSPContext h, int bit_depth)
 {
     int i;
@@ -77,7 +105,9 @@ static void check_sao_band(HEVCDSPContext h, int bit_depth)
 
     for (i = 0; i <= 4; i++) {
         int block_size = sao_size[i];
+        int prev_size = i ? sao_size[i - 1] : 0;
         ptrdiff_t stride = PIXEL_STRIDE*SIZEOF_PIXEL;
+        int w, height;
         declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, uint8_t *src, ptrdiff_t dst_stride, ptrdiff_t src_stride,
                           int16_t *sao_offset_val, int sao_left_class, int width, int height);
 
@@ -91,6 +121,18 @@ static void check_sao_band(HEVCDSPContext h, int bit_depth)
             call_new(dst1, src1, stride, stride, offset_val, left_class, block_size, block_size);
             if (memcmp(dst0, dst1, BUF_SIZE))
                 fail();
+
+            /* CTBs at the right and bottom picture edges are smaller, the
+             * function is picked by the width rounded up to 8 */
+            for (w = prev_size + 4; w <= block_size; w += 4) {
+                height     = 4 + rnd() % 16 * 4;
+                left_class = rnd() % 32;
+                randomize_offsets(offset_val, bit_depth, 0);
+                call_ref(dst0, src0, stride, stride, offset_val, left_class, w, height);
+                call_new(dst1, src1, stride, stride, offset_val, left_class, w, height);
+                if (cmp_rect(dst0, dst1, stride, w * SIZEOF_PIXEL, height))
+                    fail();
+            }
             bench_new(dst1, src1, stride, stride, offset_val, left_class, block_size, block_size);
         }
     }
@@ -110,6 +152,8 @@ static void check_sao_edge(HEVCDSPContext h, int bit_depth)
         int block_size = sao_size[i];
         ptrdiff_t stride = PIXEL_STRIDE*SIZEOF_PIXEL;
         int offset = (AV_INPUT_BUFFER_PADDING_SIZE + PIXEL_STRIDE)*SIZEOF_PIXEL;
+        int prev_size = i ? sao_size[i - 1] : 0;
+        int w, height;
         declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, uint8_t *src, ptrdiff_t stride_dst,
                           int16_t *sao_offset_val, int eo, int width, int height);
 
@@ -123,6 +167,24 @@ static void check_sao_edge(HEVCDSPContext h, int bit_depth)
             call_new(dst1, src1 + offset, stride, offset_val, eo, block_size, block_size);
             if (memcmp(dst0, dst1, BUF_SIZE))
                 fail();
+
+            for (eo = 0; eo < 4; eo++) {
+                randomize_offsets(offset_val, bit_depth, 1);
+                call_ref(dst0, src0 + offset, stride, offset_val, eo, block_size, block_size);
+                call_new(dst1, src1 + offset, stride, offset_val, eo, block_size, block_size);
+                if (cmp_rect(dst0, dst1, stride, block_size * SIZEOF_PIXEL, block_size))
+                    fail();
+            }
+
+            for (w = prev_size + 4; w <= block_size; w += 4) {
+                height = 4 + rnd() % 16 * 4;
+                eo     = rnd() % 4;
+                randomize_offsets(offset_val, bit_depth, 1);
+                call_ref(dst0, src0 + offset, stride, offset_val, eo, w, height);
+                call_new(dst1, src1 + offset, stride, offset_val, eo, w, height);
+                if (cmp_rect(dst0, dst1, stride, w * SIZEOF_PIXEL, height))
+                    fail();
+            }
             bench_new(dst1, src1 + offset, stride, offset_val, eo, block_size, block_size);
         }
     }
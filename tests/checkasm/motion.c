@@ -0,0 +1,129 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavcodec/me_cmp.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+#include "libavutil/intreadwrite.h"
+
+#define WIDTH    64
+#define HEIGHT   17
+#define BUF_SIZE (WIDTH * (HEIGHT + 1))
+
+static const char *const pix_abs_names[4] = { "", "_x2", "_y2", "_xy2" };
+
+static void fill_random(uint8_t *buf, int size)
+{
+    int i;
+    for (i = 0; i < size; i += 4)
+        AV_WN32A(buf + i, rnd());
+}
+
+static void check_pix_abs(MECmpContext *c, uint8_t *pix1, uint8_t *pix2)
+{
+    static const int heights[2][2] = { { 16, 8 }, { 8, 8 } };
+    int size, type, i, j;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, int, struct MpegEncContext *v, uint8_t *pix1,
+                      uint8_t *pix2, ptrdiff_t stride, int h);
+
+    for (size = 0; size < 2; size++) {
+        for (type = 0; type < 4; type++) {
+            if (!check_func(c->pix_abs[size][type], "pix_abs%d%s",
+                            16 >> size, pix_abs_names[type]))
+                continue;
+
+            for (i = 0; i < 2; i++) {
+                /* pix1 is the block being coded and is always aligned,
+                 * the reference block in pix2 may start anywhere */
+                for (j = 0; j < 4; j++) {
+                    int h      = heights[size][i];
+                    int offset = rnd() % (WIDTH - 16 - 1);
+                    int res0, res1;
+
+                    fill_random(pix1, BUF_SIZE);
+                    fill_random(pix2, BUF_SIZE);
+                    res0 = call_ref(NULL, pix1, pix2 + offset, WIDTH, h);
+                    res1 = call_new(NULL, pix1, pix2 + offset, WIDTH, h);
+                    if (res0 != res1)
+                        fail();
+                }
+            }
+            bench_new(NULL, pix1, pix2 + 1, WIDTH, heights[size][0]);
+        }
+    }
+}
+
+/* full-pel block comparisons, hadamard8_diff is the SATD used by
+ * cmp=satd; the 16 wide versions are also called with h = 8 for fields */
+static void check_me_cmp(me_cmp_func *funcs, const char *name,
+                         uint8_t *pix1, uint8_t *pix2)
+{
+    static const int heights[2][2] = { { 16, 8 }, { 8, 8 } };
+    int size, i, j;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, int, struct MpegEncContext *v, uint8_t *pix1,
+                      uint8_t *pix2, ptrdiff_t stride, int h);
+
+    for (size = 0; size < 2; size++) {
+        if (!check_func(funcs[size], "%s%d", name, 16 >> size))
+            continue;
+
+        for (i = 0; i < 2; i++) {
+            for (j = 0; j < 4; j++) {
+                int h      = heights[size][i];
+                int offset = rnd() % (WIDTH - 16);
+                int res0, res1;
+
+                fill_random(pix1, BUF_SIZE);
+                fill_random(pix2, BUF_SIZE);
+                res0 = call_ref(NULL, pix1, pix2 + offset, WIDTH, h);
+                res1 = call_new(NULL, pix1, pix2 + offset, WIDTH, h);
+                if (res0 != res1)
+                    fail();
+            }
+        }
+        bench_new(NULL, pix1, pix2 + 1, WIDTH, heights[size][0]);
+    }
+}
+
+void checkasm_check_motion(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, pix1, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, pix2, [BUF_SIZE]);
+    AVCodecContext avctx = {
+        .flags = AV_CODEC_FLAG_BITEXACT,
+    };
+    MECmpContext c;
+
+    ff_me_cmp_init(&c, &avctx);
+
+    check_pix_abs(&c, pix1, pix2);
+    report("pix_abs");
+
+    check_me_cmp(c.sad, "sad", pix1, pix2);
+    report("sad");
+
+    check_me_cmp(c.sse, "sse", pix1, pix2);
+    report("sse");
+
+    check_me_cmp(c.hadamard8_diff, "hadamard8_diff", pix1, pix2);
+    report("hadamard8_diff");
+}
@@ -0,0 +1,82 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/psnr.h"
+#include "libavutil/intreadwrite.h"
+
+#define WIDTH 256
+#define WIDTH_PADDED (WIDTH + 32)
+
+static void randomize_line(uint8_t *buf, uint8_t *ref, int bpp)
+{
+    int mask = (1 << bpp) - 1;
+    int i;
+
+    for (i = 0; i < WIDTH_PADDED; i++) {
+        int a = rnd() & mask, b;
+
+        /* mix small and maximal differences */
+        switch (rnd() % 3) {
+        case 0:  b = rnd() & mask;       break;
+        case 1:  b = mask - a;           break;
+        default: b = av_clip(a + (int)(rnd() % 9) - 4, 0, mask);
+        }
+        if (bpp > 8) {
+            AV_WN16A(buf + 2 * i, a);
+            AV_WN16A(ref + 2 * i, b);
+        } else {
+            buf[i] = a;
+            ref[i] = b;
+        }
+    }
+}
+
+static void check_sse_line(int bpp)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf, [2 * WIDTH_PADDED]);
+    LOCAL_ALIGNED_32(uint8_t, ref, [2 * WIDTH_PADDED]);
+    PSNRDSPContext dsp;
+    int w;
+
+    declare_func(uint64_t, const uint8_t *buf, const uint8_t *ref, int w);
+
+    ff_psnr_init(&dsp, bpp);
+
+    if (check_func(dsp.sse_line, "sse_line_%dbit", bpp)) {
+        randomize_line(buf, ref, bpp);
+        for (w = 1; w <= WIDTH; w++) {
+            if (call_ref(buf, ref, w) != call_new(buf, ref, w))
+                fail();
+        }
+        bench_new(buf, ref, WIDTH);
+    }
+}
+
+void checkasm_check_vf_psnr(void)
+{
+    check_sse_line(8);
+    report("sse_line_8bit");
+
+    check_sse_line(10);
+    report("sse_line_10bit");
+
+    check_sse_line(15);
+    report("sse_line_15bit");
+}
@@ -0,0 +1,131 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/ssim.h"
+#include "libavutil/intreadwrite.h"
+
+#define WIDTH 256
+#define STRIDE (WIDTH + 32)
+#define NB_BLOCKS (WIDTH / 4)
+
+/* rows of ref close to, equal to or unrelated to buf, like real frames */
+static void randomize_rows(uint8_t *buf, uint8_t *ref)
+{
+    int i;
+
+    for (i = 0; i < 4 * STRIDE; i++) {
+        buf[i] = rnd();
+        switch (rnd() % 3) {
+        case 0:  ref[i] = rnd();                                 break;
+        case 1:  ref[i] = buf[i];                                break;
+        default: ref[i] = av_clip_uint8(buf[i] + (int)(rnd() % 17) - 8);
+        }
+    }
+}
+
+static void check_ssim_4x4_line(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf, [4 * STRIDE]);
+    LOCAL_ALIGNED_32(uint8_t, ref, [4 * STRIDE]);
+    LOCAL_ALIGNED_32(int, sums0, [NB_BLOCKS + 2], [4]);
+    LOCAL_ALIGNED_32(int, sums1, [NB_BLOCKS + 2], [4]);
+    SSIMDSPContext dsp;
+    int w;
+
+    declare_func(void, const uint8_t *buf, ptrdiff_t buf_stride,
+                 const uint8_t *ref, ptrdiff_t ref_stride,
+                 int (*sums)[4], int w);
+
+    ff_ssim_init(&dsp);
+
+    if (check_func(dsp.ssim_4x4_line, "ssim_4x4_line")) {
+        randomize_rows(buf, ref);
+        for (w = 1; w <= NB_BLOCKS; w++) {
+            memset(sums0, 0, sizeof(*sums0) * (NB_BLOCKS + 2));
+            memset(sums1, 0, sizeof(*sums1) * (NB_BLOCKS + 2));
+            call_ref(buf, STRIDE, ref, STRIDE, sums0, w);
+            call_new(buf, STRIDE, ref, STRIDE, sums1, w);
+            if (memcmp(sums0, sums1, sizeof(*sums0) * w))
+                fail();
+        }
+        bench_new(buf, STRIDE, ref, STRIDE, sums1, NB_BLOCKS);
+    }
+}
+
+/* the sums of one 4x4 block as ssim_4x4_line computes them */
+static void block_sums(int sums[4], const uint8_t *buf, const uint8_t *ref)
+{
+    int x, y;
+
+    memset(sums, 0, 4 * sizeof(*sums));
+    for (y = 0; y < 4; y++) {
+        for (x = 0; x < 4; x++) {
+            int a = buf[y * STRIDE + x];
+            int b = ref[y * STRIDE + x];
+
+            sums[0] += a;
+            sums[1] += b;
+            sums[2] += a * a + b * b;
+            sums[3] += a * b;
+        }
+    }
+}
+
+static void check_ssim_end_line(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf, [4 * STRIDE]);
+    LOCAL_ALIGNED_32(uint8_t, ref, [4 * STRIDE]);
+    LOCAL_ALIGNED_32(int, sum0, [NB_BLOCKS + 2], [4]);
+    LOCAL_ALIGNED_32(int, sum1, [NB_BLOCKS + 2], [4]);
+    SSIMDSPContext dsp;
+    int i, w;
+
+    declare_func_float(float, const int (*sum0)[4], const int (*sum1)[4], int w);
+
+    ff_ssim_init(&dsp);
+
+    if (check_func(dsp.ssim_end_line, "ssim_end_line")) {
+        randomize_rows(buf, ref);
+        for (i = 0; i < NB_BLOCKS; i++)
+            block_sums(sum0[i], buf + 4 * i, ref + 4 * i);
+        randomize_rows(buf, ref);
+        for (i = 0; i < NB_BLOCKS; i++)
+            block_sums(sum1[i], buf + 4 * i, ref + 4 * i);
+
+        for (w = 1; w < NB_BLOCKS; w++) {
+            float res0 = call_ref((const int (*)[4])sum0, (const int (*)[4])sum1, w);
+            float res1 = call_new((const int (*)[4])sum0, (const int (*)[4])sum1, w);
+
+            /* the SIMD versions sum the per-block terms in another order */
+            if (!float_near_abs_eps(res0, res1, 1e-5 * w))
+                fail();
+        }
+        bench_new((const int (*)[4])sum0, (const int (*)[4])sum1, NB_BLOCKS - 1);
+    }
+}
+
+void checkasm_check_vf_ssim(void)
+{
+    check_ssim_4x4_line();
+    report("ssim_4x4_line");
+
+    check_ssim_end_line();
+    report("ssim_end_line");
+}
@@ -742,6 +742,11 @@ FATE_METADATA_FILTER-$(call ALLYES, $(CROPDETECT_DEPS)) += fate-filter-metadata-
 fate-filter-metadata-cropdetect: SRC = $(TARGET_SAMPLES)/filter/cropdetect.mp4
 fate-filter-metadata-cropdetect: CMD = run $(FILTER_METADATA_COMMAND) "sws_flags=+accurate_rnd+bitexact;movie='$(SRC)',cropdetect=max_outliers=3"
 
+QCSTATS_DEPS = FFPROBE LAVFI_INDEV TESTSRC2_FILTER COLOR_FILTER PAD_FILTER \
+               CONCAT_FILTER FORMAT_FILTER QCSTATS_FILTER
+FATE_METADATA_FILTER_LAVFI-$(call ALLYES, $(QCSTATS_DEPS)) += fate-filter-qcstats
+fate-filter-qcstats: CMD = run $(FILTER_METADATA_COMMAND) "testsrc2=s=160x120:r=5:d=1,pad=192:160:16:20[a];color=black:s=192x160:r=5:d=1[b];testsrc2=s=160x120:r=5:d=1,pad=192:160:16:20[c];[a][b][c]concat=n=3,format=yuv420p,qcstats=black_d=0.5:freeze_d=0.5"
+
 SILENCEDETECT_DEPS = FFPROBE AVDEVICE LAVFI_INDEV AMOVIE_FILTER TTA_DEMUXER TTA_DECODER SILENCEDETECT_FILTER
 FATE_METADATA_FILTER-$(call ALLYES, $(SILENCEDETECT_DEPS)) += fate-filter-metadata-silencedetect
 fate-filter-metadata-silencedetect: SRC = $(TARGET_SAMPLES)/lossless-audio/inside.tta
@@ -793,7 +798,11 @@ fate-filter-refcmp-ssim-rgb: CMD = refcmp_metadata ssim rgb24 0.015
 FATE_FILTER_SAMPLES-$(call ALLYES, $(REFCMP_DEPS) SSIM_FILTER) += fate-filter-refcmp-ssim-yuv
 fate-filter-refcmp-ssim-yuv: CMD = refcmp_metadata ssim yuv422p 0.015
 
+FATE_FILTER-$(call ALLYES, $(REFCMP_DEPS) VMAFFEATURES_FILTER) += fate-filter-refcmp-vmaffeatures-yuv
+fate-filter-refcmp-vmaffeatures-yuv: CMD = refcmp_metadata vmaffeatures yuv420p 0.001
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
+FATE_FFPROBE += $(FATE_METADATA_FILTER_LAVFI-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
 